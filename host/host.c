@@ -26,6 +26,13 @@
 #include <assert.h>
 #include <stdbool.h>
 #include <locale.h>
+#include <errno.h>
+#include <limits.h>
+#include <math.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+#include <time.h>
 #include <lv2.h>
 
 #include "../lv2dynparam.h"
@@ -44,31 +51,60 @@
 
 #define SERIALIZE_SEPARATOR_CHAR          '/'
 #define SERIALIZE_ESCAPE_CHAR             '^'
-#define SERIALIZE_BUFFER_INITIAL_SIZE     1024
-#define SERIALIZE_BUFFER_INCREMENT_SIZE   1024
 
 #define SERIALIZE_TYPE_CHAR_BOOLEAN 'b'
 #define SERIALIZE_TYPE_CHAR_FLOAT   'f'
 #define SERIALIZE_TYPE_CHAR_INT     'i'
 #define SERIALIZE_TYPE_CHAR_STRING  's'
+#define SERIALIZE_TYPE_CHAR_NOTE    'n'
+
+/* decimal digits needed for any float value to survive text round-trip */
+#define SERIALIZE_FLOAT_MIN_DIGITS   6
+#define SERIALIZE_FLOAT_MAX_DIGITS   9
+
+/* size of buffer that fits any serialized value, except strings */
+#define SERIALIZE_VALUE_BUFFER_SIZE  100
+
+static locale_t g_numeric_locale;
+static pthread_once_t g_numeric_locale_once = PTHREAD_ONCE_INIT;
 
 void
 lv2dynparam_host_parameter_free(
   struct lv2dynparam_host_instance * instance_ptr,
   struct lv2dynparam_host_parameter * parameter_ptr)
 {
+  if (parameter_ptr->borrowed)
+  {
+    /* still in the list, unless plugin storage was dropped */
+    list_del_init(&parameter_ptr->borrowed_siblings);
+  }
+
   switch (parameter_ptr->type)
   {
   case LV2DYNPARAM_PARAMETER_TYPE_ENUM:
+    if (parameter_ptr->borrowed)
+    {
+      break;
+    }
+
     lv2dynparam_enum_free(
       instance_ptr->memory,
       parameter_ptr->range.enumeration.values,
       parameter_ptr->range.enumeration.values_count);
-    return;
+    break;
+  case LV2DYNPARAM_PARAMETER_TYPE_STRING:
+  case LV2DYNPARAM_PARAMETER_TYPE_FILENAME:
+    rtsafe_memory_deallocate(parameter_ptr->value.string);
+    break;
   }
 
+  free(parameter_ptr->path);
   lv2dynparam_hints_clear(&parameter_ptr->hints);
   rtsafe_memory_pool_deallocate(instance_ptr->parameters_pool, parameter_ptr);
+
+  assert(instance_ptr->parameters_count > 0);
+  instance_ptr->parameters_count--;
+  instance_ptr->removal_generation++;
 }
 
 void
@@ -76,1046 +112,3401 @@ lv2dynparam_host_group_free(
   struct lv2dynparam_host_instance * instance_ptr,
   struct lv2dynparam_host_group * group_ptr)
 {
+  free(group_ptr->path);
   lv2dynparam_hints_clear(&group_ptr->hints);
   rtsafe_memory_pool_deallocate(instance_ptr->groups_pool, group_ptr);
 }
 
-bool
-lv2dynparam_host_map_type_uri(
-  struct lv2dynparam_host_parameter * parameter_ptr)
+static
+void
+command_free(
+  struct lv2dynparam_host_instance * instance_ptr,
+  struct lv2dynparam_host_command * command_ptr)
 {
-  if (strcmp(parameter_ptr->type_uri, LV2DYNPARAM_PARAMETER_TYPE_BOOLEAN_URI) == 0)
-  {
-    parameter_ptr->type = LV2DYNPARAM_PARAMETER_TYPE_BOOLEAN;
-    return true;
-  }
-
-  if (strcmp(parameter_ptr->type_uri, LV2DYNPARAM_PARAMETER_TYPE_FLOAT_URI) == 0)
-  {
-    parameter_ptr->type = LV2DYNPARAM_PARAMETER_TYPE_FLOAT;
-    return true;
-  }
+  lv2dynparam_hints_clear(&command_ptr->hints);
+  rtsafe_memory_pool_deallocate(instance_ptr->commands_pool, command_ptr);
+}
 
-  if (strcmp(parameter_ptr->type_uri, LV2DYNPARAM_PARAMETER_TYPE_ENUM_URI) == 0)
+/* Whether plugin removed the group, directly or together with one of its parents */
+static
+bool
+group_removed(
+  const struct lv2dynparam_host_group * group_ptr)
+{
+  while (group_ptr != NULL)
   {
-    parameter_ptr->type = LV2DYNPARAM_PARAMETER_TYPE_ENUM;
-    return true;
-  }
+    if (group_ptr->pending_state == LV2DYNPARAM_PENDING_DISAPPEAR)
+    {
+      return true;
+    }
 
-  if (strcmp(parameter_ptr->type_uri, LV2DYNPARAM_PARAMETER_TYPE_INT_URI) == 0)
-  {
-    parameter_ptr->type = LV2DYNPARAM_PARAMETER_TYPE_INT;
-    return true;
+    group_ptr = group_ptr->parent_group_ptr;
   }
 
   return false;
 }
 
-static struct lv2dynparam_host_callbacks g_lv2dynparam_host_callbacks =
+static
+bool
+parameter_removed(
+  const struct lv2dynparam_host_parameter * parameter_ptr)
 {
-  .group_appear = lv2dynparam_host_group_appear,
-  .group_disappear = lv2dynparam_host_group_disappear,
-
-  .parameter_appear = lv2dynparam_host_parameter_appear,
-  .parameter_disappear = lv2dynparam_host_parameter_disappear,
-  .parameter_change = lv2dynparam_host_parameter_change,
-
-  .command_appear = lv2dynparam_host_command_appear,
-  .command_disappear = lv2dynparam_host_command_disappear
-};
+  return
+    parameter_ptr->pending_state == LV2DYNPARAM_PENDING_DISAPPEAR ||
+    group_removed(parameter_ptr->group_ptr);
+}
 
-bool
-lv2dynparam_host_attach(
-  const LV2_Descriptor * lv2descriptor,
-  LV2_Handle lv2instance,
-  struct lv2_rtsafe_memory_pool_provider * rtmempool_ptr,
-  void * instance_context,
-  lv2dynparam_parameter_created parameter_created_callback,
-  lv2dynparam_parameter_destroying parameter_destroying_callback,
-  lv2dynparam_parameter_value_change_context parameter_value_change_context,
-  lv2dynparam_host_instance * instance_handle_ptr)
+/* Called from plugin context when plugin is going to free the parameter
+ * before its hints and enum values were copied */
+void
+lv2dynparam_host_parameter_drop_borrowed(
+  struct lv2dynparam_host_parameter * parameter_ptr)
 {
-  struct lv2dynparam_host_instance * instance_ptr;
+  assert(parameter_ptr->borrowed);
 
-  if ((parameter_created_callback == NULL && parameter_destroying_callback != NULL) ||
-      (parameter_created_callback != NULL && parameter_destroying_callback == NULL))
-  {
-    LOG_ERROR("parameter lifecycle callbacks should either not be supplied or should be supplied both");
-    goto fail;
-  }
+  list_del_init(&parameter_ptr->borrowed_siblings);
+  parameter_ptr->plugin_hints_ptr = NULL;
 
-  instance_ptr = malloc(sizeof(struct lv2dynparam_host_instance));
-  if (instance_ptr == NULL)
+  if (parameter_ptr->type == LV2DYNPARAM_PARAMETER_TYPE_ENUM)
   {
-    LOG_ERROR("Failed to allocate struct lv2dynparam_host_instance");
-    goto fail;
+    parameter_ptr->range.enumeration.values = NULL;
+    parameter_ptr->range.enumeration.values_count = 0;
   }
+}
 
-  instance_ptr->parameter_created_callback = parameter_created_callback;
-  instance_ptr->parameter_destroying_callback = parameter_destroying_callback;
-  instance_ptr->parameter_value_change_context = parameter_value_change_context;
-
-  instance_ptr->instance_context = instance_context;
+/* Called from plugin context when group is removed, only parameters
+ * that appeared since last lv2dynparam_host_ui_run() are checked */
+void
+lv2dynparam_host_group_drop_borrowed(
+  struct lv2dynparam_host_instance * instance_ptr)
+{
+  struct list_head * node_ptr;
+  struct list_head * temp_node_ptr;
+  struct lv2dynparam_host_parameter * parameter_ptr;
 
-  instance_ptr->lock = audiolock_create_slow();
-  if (instance_ptr->lock == AUDIOLOCK_HANDLE_INVALID_VALUE)
+  list_for_each_safe(node_ptr, temp_node_ptr, &instance_ptr->borrowed_parameters)
   {
-    goto fail_free;
+    parameter_ptr = list_entry(node_ptr, struct lv2dynparam_host_parameter, borrowed_siblings);
+    if (group_removed(parameter_ptr->group_ptr))
+    {
+      lv2dynparam_host_parameter_drop_borrowed(parameter_ptr);
+    }
   }
+}
 
-  if (!rtsafe_memory_pool_create(
-        rtmempool_ptr,
-        "host groups",
-        sizeof(struct lv2dynparam_host_group),
-        10,
-        100,
-        &instance_ptr->groups_pool))
-  {
-    goto fail_destroy_lock;
-  }
+/* Called from UI thread with the lock held. Copies hints and enum values of
+ * appeared parameters, so appear in plugin context does not allocate for them. */
+static
+void
+parameters_copy_borrowed(
+  struct lv2dynparam_host_instance * instance_ptr)
+{
+  struct list_head * node_ptr;
+  struct list_head * temp_node_ptr;
+  struct lv2dynparam_host_parameter * parameter_ptr;
+  char ** values;
 
-  if (!rtsafe_memory_pool_create(
-        rtmempool_ptr,
-        "host parameters",
-        sizeof(struct lv2dynparam_host_parameter),
-        10,
-        100,
-        &instance_ptr->parameters_pool))
+  list_for_each_safe(node_ptr, temp_node_ptr, &instance_ptr->borrowed_parameters)
   {
-    goto fail_destroy_groups_pool;
-  }
+    parameter_ptr = list_entry(node_ptr, struct lv2dynparam_host_parameter, borrowed_siblings);
 
-  if (!rtsafe_memory_pool_create(
-        rtmempool_ptr,
-        "host messages",
-        sizeof(struct lv2dynparam_host_message),
-        10,
-        100,
-        &instance_ptr->messages_pool))
-  {
-    goto fail_destroy_parameters_pool;
-  }
+    if (!lv2dynparam_hints_init_copy(
+          instance_ptr->memory,
+          parameter_ptr->plugin_hints_ptr,
+          &parameter_ptr->hints))
+    {
+      /* try again in next lv2dynparam_host_ui_run() */
+      LOG_ERROR("failed to copy hints of parameter '%s'", parameter_ptr->name);
+      continue;
+    }
 
-  if (!rtsafe_memory_pool_create(
-        rtmempool_ptr,
-        "host pending parameter value changes",
-        sizeof(struct lv2dynparam_host_parameter_pending_value_change),
-        10,
-        100,
-        &instance_ptr->pending_parameter_value_changes_pool))
-  {
-    goto fail_destroy_messages_pool;
-  }
+    if (parameter_ptr->type == LV2DYNPARAM_PARAMETER_TYPE_ENUM)
+    {
+      values = lv2dynparam_enum_duplicate(
+        instance_ptr->memory,
+        (const char * const *)parameter_ptr->range.enumeration.values,
+        parameter_ptr->range.enumeration.values_count);
+      if (values == NULL)
+      {
+        LOG_ERROR("failed to copy enum values of parameter '%s'", parameter_ptr->name);
+        lv2dynparam_hints_clear(&parameter_ptr->hints);
+        continue;
+      }
 
-  if (!rtsafe_memory_init(
-        rtmempool_ptr,
-        4 * 1024,
-        10,
-        100,
-        &instance_ptr->memory))
-  {
-    goto fail_destroy_pending_parameter_value_changes_pool;
-  }
+      parameter_ptr->range.enumeration.values = values;
+    }
 
-  instance_ptr->callbacks_ptr = lv2descriptor->extension_data(LV2DYNPARAM_URI);
-  if (instance_ptr->callbacks_ptr == NULL)
-  {
-    /* Oh my! plugin does not support dynparam extension! This should be pre-checked by caller! */
-    goto fail_uninit_memory;
+    list_del_init(node_ptr);
+    parameter_ptr->plugin_hints_ptr = NULL;
+    parameter_ptr->borrowed = false;
   }
+}
 
-  INIT_LIST_HEAD(&instance_ptr->realtime_to_ui_queue);
-  INIT_LIST_HEAD(&instance_ptr->ui_to_realtime_queue);
-  INIT_LIST_HEAD(&instance_ptr->pending_parameter_value_changes);
-  instance_ptr->lv2instance = lv2instance;
-  instance_ptr->root_group_ptr = NULL;
-  instance_ptr->ui = false;
-
-  if (!instance_ptr->callbacks_ptr->host_attach(
-        lv2instance,
-        &g_lv2dynparam_host_callbacks,
-        instance_ptr))
+static
+bool
+parameter_boolean_assign(
+  struct lv2dynparam_host_parameter * parameter_ptr,
+  unsigned int value_type,
+  const union lv2dynparam_host_parameter_value * value_ptr)
+{
+  if (value_type != parameter_ptr->type)
   {
-    LOG_ERROR("lv2dynparam host_attach() failed.");
-    goto fail_uninit_memory;
+    LOG_ERROR("Value of type %u for boolean parameter '%s'", value_type, parameter_ptr->name);
+    return false;
   }
 
-  /* switch to atomic memory mode */
-  rtsafe_memory_atomic(instance_ptr->memory);
-  rtsafe_memory_pool_atomic(instance_ptr->groups_pool);
-  rtsafe_memory_pool_atomic(instance_ptr->parameters_pool);
-  rtsafe_memory_pool_atomic(instance_ptr->messages_pool);
-
-  *instance_handle_ptr = (lv2dynparam_host_instance)instance_ptr;
-
-  return 1;
-
-fail_uninit_memory:
-  rtsafe_memory_uninit(instance_ptr->memory);
-
-fail_destroy_pending_parameter_value_changes_pool:
-  rtsafe_memory_pool_destroy(instance_ptr->pending_parameter_value_changes_pool);
-
-fail_destroy_messages_pool:
-  rtsafe_memory_pool_destroy(instance_ptr->messages_pool);
-
-fail_destroy_parameters_pool:
-  rtsafe_memory_pool_destroy(instance_ptr->parameters_pool);
-
-fail_destroy_groups_pool:
-  rtsafe_memory_pool_destroy(instance_ptr->groups_pool);
-
-fail_destroy_lock:
-  audiolock_destroy(instance_ptr->lock);
-
-fail_free:
-  free(instance_ptr);
+  parameter_ptr->value.boolean = value_ptr->boolean;
+  return true;
+}
 
-fail:
-  return 0;
+static
+void
+parameter_boolean_write(
+  struct lv2dynparam_host_parameter * parameter_ptr)
+{
+  *((unsigned char *)parameter_ptr->value_ptr) = parameter_ptr->value.boolean ? 1 : 0;
+  LOG_DEBUG("\"%s\" changed to \"%s\"", parameter_ptr->name, parameter_ptr->value.boolean ? "TRUE" : "FALSE");
 }
 
+static
 void
-lv2dynparam_host_group_pending_children_count_increment(
-  struct lv2dynparam_host_group * group_ptr)
+parameter_boolean_read(
+  struct lv2dynparam_host_parameter * parameter_ptr)
 {
-  group_ptr->pending_childern_count++;
+  parameter_ptr->value.boolean = *(unsigned char *)(parameter_ptr->value_ptr);
+  LOG_DEBUG("Boolean parameter with value %s", parameter_ptr->value.boolean ? "TRUE" : "FALSE");
+}
 
-  if (group_ptr->parent_group_ptr != NULL)
+static
+bool
+parameter_float_assign(
+  struct lv2dynparam_host_parameter * parameter_ptr,
+  unsigned int value_type,
+  const union lv2dynparam_host_parameter_value * value_ptr)
+{
+  if (value_type != parameter_ptr->type)
   {
-    lv2dynparam_host_group_pending_children_count_increment(group_ptr->parent_group_ptr);
+    LOG_ERROR("Value of type %u for float parameter '%s'", value_type, parameter_ptr->name);
+    return false;
   }
+
+  parameter_ptr->value.fpoint = value_ptr->fpoint;
+  return true;
 }
 
+static
 void
-lv2dynparam_host_group_pending_children_count_decrement(
-  struct lv2dynparam_host_group * group_ptr)
+parameter_float_write(
+  struct lv2dynparam_host_parameter * parameter_ptr)
 {
-  assert(group_ptr->pending_childern_count != 0);
+  *((float *)parameter_ptr->value_ptr) = parameter_ptr->value.fpoint;
+  LOG_DEBUG("\"%s\" changed to %f", parameter_ptr->name, parameter_ptr->value.fpoint);
+}
 
-  group_ptr->pending_childern_count--;
+static
+void
+parameter_float_read(
+  struct lv2dynparam_host_parameter * parameter_ptr)
+{
+  parameter_ptr->value.fpoint = *(float *)(parameter_ptr->value_ptr);
+  LOG_DEBUG("Float parameter with value %f", parameter_ptr->value.fpoint);
+}
 
-  if (group_ptr->parent_group_ptr != NULL)
+static
+bool
+parameter_int_assign(
+  struct lv2dynparam_host_parameter * parameter_ptr,
+  unsigned int value_type,
+  const union lv2dynparam_host_parameter_value * value_ptr)
+{
+  if (value_type != parameter_ptr->type)
   {
-    lv2dynparam_host_group_pending_children_count_decrement(group_ptr->parent_group_ptr);
+    LOG_ERROR("Value of type %u for integer parameter '%s'", value_type, parameter_ptr->name);
+    return false;
+  }
+
+  parameter_ptr->value.integer = value_ptr->integer;
+  return true;
+}
+
+static
+void
+parameter_int_write(
+  struct lv2dynparam_host_parameter * parameter_ptr)
+{
+  *((signed int *)parameter_ptr->value_ptr) = parameter_ptr->value.integer;
+  LOG_DEBUG("\"%s\" changed to %d", parameter_ptr->name, parameter_ptr->value.integer);
+}
+
+static
+void
+parameter_int_read(
+  struct lv2dynparam_host_parameter * parameter_ptr)
+{
+  parameter_ptr->value.integer = *(signed int *)(parameter_ptr->value_ptr);
+  LOG_DEBUG("Integer parameter with value %d", parameter_ptr->value.integer);
+}
+
+/* integer values are accepted too, so notes can be restored from int state values */
+static
+bool
+parameter_note_assign(
+  struct lv2dynparam_host_parameter * parameter_ptr,
+  unsigned int value_type,
+  const union lv2dynparam_host_parameter_value * value_ptr)
+{
+  signed int value;
+
+  if (value_type == LV2DYNPARAM_PARAMETER_TYPE_INT)
+  {
+    value = value_ptr->integer;
+  }
+  else
+  {
+    value = value_ptr->note;
+  }
+
+  if (value < parameter_ptr->range.note.min || value > parameter_ptr->range.note.max)
+  {
+    LOG_ERROR("Value %d for note parameter '%s' is out of range", value, parameter_ptr->name);
+    return false;
+  }
+
+  parameter_ptr->value.note = value;
+  return true;
+}
+
+static
+void
+parameter_note_write(
+  struct lv2dynparam_host_parameter * parameter_ptr)
+{
+  *((unsigned char *)parameter_ptr->value_ptr) = parameter_ptr->value.note;
+  LOG_DEBUG("\"%s\" changed to note %u", parameter_ptr->name, parameter_ptr->value.note);
+}
+
+static
+void
+parameter_note_read(
+  struct lv2dynparam_host_parameter * parameter_ptr)
+{
+  parameter_ptr->value.note = *(unsigned char *)(parameter_ptr->value_ptr);
+  LOG_DEBUG("Note parameter with value %u", parameter_ptr->value.note);
+}
+
+static
+bool
+parameter_enum_assign(
+  struct lv2dynparam_host_parameter * parameter_ptr,
+  unsigned int value_type,
+  const union lv2dynparam_host_parameter_value * value_ptr)
+{
+  unsigned int i;
+
+  if (value_type != LV2DYNPARAM_PARAMETER_TYPE_STRING)
+  {
+    if (value_ptr->enum_selected_index >= parameter_ptr->range.enumeration.values_count)
+    {
+      LOG_ERROR("Value index %u for enum parameter '%s' is out of range", value_ptr->enum_selected_index, parameter_ptr->name);
+      return false;
+    }
+
+    parameter_ptr->value.enum_selected_index = value_ptr->enum_selected_index;
+    return true;
+  }
+
+  LOG_DEBUG("searching for enum value '%s'", value_ptr->string);
+  for (i = 0 ; i < parameter_ptr->range.enumeration.values_count ; i++)
+  {
+    if (strcmp(parameter_ptr->range.enumeration.values[i], value_ptr->string) == 0)
+    {
+      parameter_ptr->value.enum_selected_index = i;
+      return true;
+    }
+  }
+
+  LOG_ERROR("Wrong value '%s' for enum parameter '%s'", value_ptr->string, parameter_ptr->name);
+  return false;
+}
+
+static
+void
+parameter_enum_write(
+  struct lv2dynparam_host_parameter * parameter_ptr)
+{
+  *((unsigned int *)parameter_ptr->value_ptr) = parameter_ptr->value.enum_selected_index;
+  LOG_DEBUG("\"%s\" changed to \"%s\" (index %u)", parameter_ptr->name, parameter_ptr->range.enumeration.values[parameter_ptr->value.enum_selected_index], parameter_ptr->value.enum_selected_index);
+}
+
+static
+void
+parameter_enum_read(
+  struct lv2dynparam_host_parameter * parameter_ptr)
+{
+  parameter_ptr->value.enum_selected_index = *(unsigned int *)(parameter_ptr->value_ptr);
+  LOG_DEBUG("Enum parameter with selected value index %u", parameter_ptr->value.enum_selected_index);
+}
+
+static
+bool
+parameter_string_assign(
+  struct lv2dynparam_host_parameter * parameter_ptr,
+  unsigned int value_type,
+  const union lv2dynparam_host_parameter_value * value_ptr)
+{
+  size_t size;
+
+  /* string values are accepted for filename parameters too */
+  if (value_type != LV2DYNPARAM_PARAMETER_TYPE_STRING &&
+      value_type != parameter_ptr->type)
+  {
+    LOG_ERROR("Value of type %u for string parameter '%s'", value_type, parameter_ptr->name);
+    return false;
+  }
+
+  size = strlen(value_ptr->string) + 1;
+  if (size > parameter_ptr->range.string.size)
+  {
+    LOG_ERROR("Value for string parameter '%s' is too long", parameter_ptr->name);
+    return false;
+  }
+
+  /* value may be the one UI got from us */
+  memmove(parameter_ptr->value.string, value_ptr->string, size);
+  return true;
+}
+
+static
+void
+parameter_string_write(
+  struct lv2dynparam_host_parameter * parameter_ptr)
+{
+  strcpy(((struct lv2dynparam_string_value *)(parameter_ptr->value_ptr))->pending, parameter_ptr->value.string);
+  LOG_DEBUG("\"%s\" changed to \"%s\"", parameter_ptr->name, parameter_ptr->value.string);
+}
+
+static
+void
+parameter_string_read(
+  struct lv2dynparam_host_parameter * parameter_ptr)
+{
+  const char * value;
+  size_t len;
+
+  value = ((struct lv2dynparam_string_value *)(parameter_ptr->value_ptr))->value;
+  len = strnlen(value, parameter_ptr->range.string.size - 1);
+  memcpy(parameter_ptr->value.string, value, len);
+  parameter_ptr->value.string[len] = 0;
+  LOG_DEBUG("String parameter with value \"%s\"", parameter_ptr->value.string);
+}
+
+static const struct lv2dynparam_host_parameter_type g_lv2dynparam_host_parameter_types[] =
+{
+  {
+    .uri = LV2DYNPARAM_PARAMETER_TYPE_BOOLEAN_URI,
+    .type = LV2DYNPARAM_PARAMETER_TYPE_BOOLEAN,
+    .assign = parameter_boolean_assign,
+    .write = parameter_boolean_write,
+    .read = parameter_boolean_read
+  },
+  {
+    .uri = LV2DYNPARAM_PARAMETER_TYPE_FLOAT_URI,
+    .type = LV2DYNPARAM_PARAMETER_TYPE_FLOAT,
+    .assign = parameter_float_assign,
+    .write = parameter_float_write,
+    .read = parameter_float_read
+  },
+  {
+    .uri = LV2DYNPARAM_PARAMETER_TYPE_ENUM_URI,
+    .type = LV2DYNPARAM_PARAMETER_TYPE_ENUM,
+    .assign = parameter_enum_assign,
+    .write = parameter_enum_write,
+    .read = parameter_enum_read
+  },
+  {
+    .uri = LV2DYNPARAM_PARAMETER_TYPE_INT_URI,
+    .type = LV2DYNPARAM_PARAMETER_TYPE_INT,
+    .assign = parameter_int_assign,
+    .write = parameter_int_write,
+    .read = parameter_int_read
+  },
+  {
+    .uri = LV2DYNPARAM_PARAMETER_TYPE_NOTE_URI,
+    .type = LV2DYNPARAM_PARAMETER_TYPE_NOTE,
+    .assign = parameter_note_assign,
+    .write = parameter_note_write,
+    .read = parameter_note_read
+  },
+  {
+    .uri = LV2DYNPARAM_PARAMETER_TYPE_STRING_URI,
+    .type = LV2DYNPARAM_PARAMETER_TYPE_STRING,
+    .assign = parameter_string_assign,
+    .write = parameter_string_write,
+    .read = parameter_string_read
+  },
+  {
+    .uri = LV2DYNPARAM_PARAMETER_TYPE_FILENAME_URI,
+    .type = LV2DYNPARAM_PARAMETER_TYPE_FILENAME,
+    .assign = parameter_string_assign,
+    .write = parameter_string_write,
+    .read = parameter_string_read
+  },
+};
+
+bool
+lv2dynparam_host_map_type_uri(
+  struct lv2dynparam_host_parameter * parameter_ptr)
+{
+  unsigned int i;
+
+  for (i = 0 ; i < sizeof(g_lv2dynparam_host_parameter_types) / sizeof(g_lv2dynparam_host_parameter_types[0]) ; i++)
+  {
+    if (strcmp(parameter_ptr->type_uri, g_lv2dynparam_host_parameter_types[i].uri) == 0)
+    {
+      parameter_ptr->type = g_lv2dynparam_host_parameter_types[i].type;
+      parameter_ptr->type_ops = g_lv2dynparam_host_parameter_types + i;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+static struct lv2dynparam_host_callbacks g_lv2dynparam_host_callbacks =
+{
+  .group_appear = lv2dynparam_host_group_appear,
+  .group_disappear = lv2dynparam_host_group_disappear,
+
+  .parameter_appear = lv2dynparam_host_parameter_appear,
+  .parameter_disappear = lv2dynparam_host_parameter_disappear,
+  .parameter_change = lv2dynparam_host_parameter_change,
+
+  .command_appear = lv2dynparam_host_command_appear,
+  .command_disappear = lv2dynparam_host_command_disappear
+};
+
+bool
+lv2dynparam_host_attach(
+  const LV2_Descriptor * lv2descriptor,
+  LV2_Handle lv2instance,
+  struct lv2_rtsafe_memory_pool_provider * rtmempool_ptr,
+  void * instance_context,
+  lv2dynparam_parameter_created parameter_created_callback,
+  lv2dynparam_parameter_destroying parameter_destroying_callback,
+  lv2dynparam_parameter_value_change_context parameter_value_change_context,
+  lv2dynparam_host_instance * instance_handle_ptr)
+{
+  struct lv2dynparam_host_instance * instance_ptr;
+  unsigned int i;
+
+  if ((parameter_created_callback == NULL && parameter_destroying_callback != NULL) ||
+      (parameter_created_callback != NULL && parameter_destroying_callback == NULL))
+  {
+    LOG_ERROR("parameter lifecycle callbacks should either not be supplied or should be supplied both");
+    goto fail;
+  }
+
+  instance_ptr = malloc(sizeof(struct lv2dynparam_host_instance));
+  if (instance_ptr == NULL)
+  {
+    LOG_ERROR("Failed to allocate struct lv2dynparam_host_instance");
+    goto fail;
+  }
+
+  instance_ptr->parameter_created_callback = parameter_created_callback;
+  instance_ptr->parameter_destroying_callback = parameter_destroying_callback;
+  instance_ptr->parameter_value_change_context = parameter_value_change_context;
+
+  instance_ptr->instance_context = instance_context;
+
+  instance_ptr->lock = audiolock_create_slow();
+  if (instance_ptr->lock == AUDIOLOCK_HANDLE_INVALID_VALUE)
+  {
+    goto fail_free;
+  }
+
+  if (!rtsafe_memory_pool_create(
+        rtmempool_ptr,
+        "host groups",
+        sizeof(struct lv2dynparam_host_group),
+        10,
+        100,
+        &instance_ptr->groups_pool))
+  {
+    goto fail_destroy_lock;
+  }
+
+  if (!rtsafe_memory_pool_create(
+        rtmempool_ptr,
+        "host parameters",
+        sizeof(struct lv2dynparam_host_parameter),
+        10,
+        100,
+        &instance_ptr->parameters_pool))
+  {
+    goto fail_destroy_groups_pool;
+  }
+
+  if (!rtsafe_memory_pool_create(
+        rtmempool_ptr,
+        "host commands",
+        sizeof(struct lv2dynparam_host_command),
+        10,
+        100,
+        &instance_ptr->commands_pool))
+  {
+    goto fail_destroy_parameters_pool;
+  }
+
+  if (!rtsafe_memory_pool_create(
+        rtmempool_ptr,
+        "host messages",
+        sizeof(struct lv2dynparam_host_message),
+        10,
+        100,
+        &instance_ptr->messages_pool))
+  {
+    goto fail_destroy_commands_pool;
+  }
+
+  if (!rtsafe_memory_pool_create(
+        rtmempool_ptr,
+        "host pending parameter value changes",
+        sizeof(struct lv2dynparam_host_parameter_pending_value_change),
+        10,
+        100,
+        &instance_ptr->pending_parameter_value_changes_pool))
+  {
+    goto fail_destroy_messages_pool;
+  }
+
+  if (!rtsafe_memory_init(
+        rtmempool_ptr,
+        4 * 1024,
+        10,
+        100,
+        &instance_ptr->memory))
+  {
+    goto fail_destroy_pending_parameter_value_changes_pool;
+  }
+
+  instance_ptr->callbacks_ptr = lv2descriptor->extension_data(LV2DYNPARAM_URI);
+  if (instance_ptr->callbacks_ptr == NULL)
+  {
+    /* Oh my! plugin does not support dynparam extension! This should be pre-checked by caller! */
+    goto fail_uninit_memory;
+  }
+
+  INIT_LIST_HEAD(&instance_ptr->realtime_to_ui_queue);
+  INIT_LIST_HEAD(&instance_ptr->ui_to_realtime_queue);
+  instance_ptr->ui_to_realtime_changes = 0;
+  instance_ptr->plugin_changes = NULL;
+  INIT_LIST_HEAD(&instance_ptr->resolved_parameter_value_changes);
+  INIT_LIST_HEAD(&instance_ptr->borrowed_parameters);
+  for (i = 0 ; i < LV2DYNPARAM_HOST_PENDING_VALUE_CHANGES_HASH_SIZE ; i++)
+  {
+    INIT_LIST_HEAD(instance_ptr->pending_parameter_value_changes + i);
+  }
+  instance_ptr->lv2instance = lv2instance;
+  instance_ptr->root_group_ptr = NULL;
+  instance_ptr->parameters_count = 0;
+  instance_ptr->structure_generation = 0;
+  instance_ptr->values_generation = 0;
+  instance_ptr->removal_generation = 0;
+
+  for (i = 0 ; i < LV2DYNPARAM_HOST_PRESETS_COUNT ; i++)
+  {
+    instance_ptr->presets[i] = NULL;
+  }
+
+  instance_ptr->presets_version = 0;
+  instance_ptr->morph_active = false;
+  instance_ptr->morph_ptr = NULL;
+  instance_ptr->ui = false;
+
+  if (!instance_ptr->callbacks_ptr->host_attach(
+        lv2instance,
+        &g_lv2dynparam_host_callbacks,
+        instance_ptr))
+  {
+    LOG_ERROR("lv2dynparam host_attach() failed.");
+    goto fail_uninit_memory;
+  }
+
+  /* switch to atomic memory mode */
+  rtsafe_memory_atomic(instance_ptr->memory);
+  rtsafe_memory_pool_atomic(instance_ptr->groups_pool);
+  rtsafe_memory_pool_atomic(instance_ptr->parameters_pool);
+  rtsafe_memory_pool_atomic(instance_ptr->commands_pool);
+  rtsafe_memory_pool_atomic(instance_ptr->messages_pool);
+
+  *instance_handle_ptr = (lv2dynparam_host_instance)instance_ptr;
+
+  return 1;
+
+fail_uninit_memory:
+  rtsafe_memory_uninit(instance_ptr->memory);
+
+fail_destroy_pending_parameter_value_changes_pool:
+  rtsafe_memory_pool_destroy(instance_ptr->pending_parameter_value_changes_pool);
+
+fail_destroy_messages_pool:
+  rtsafe_memory_pool_destroy(instance_ptr->messages_pool);
+
+fail_destroy_commands_pool:
+  rtsafe_memory_pool_destroy(instance_ptr->commands_pool);
+
+fail_destroy_parameters_pool:
+  rtsafe_memory_pool_destroy(instance_ptr->parameters_pool);
+
+fail_destroy_groups_pool:
+  rtsafe_memory_pool_destroy(instance_ptr->groups_pool);
+
+fail_destroy_lock:
+  audiolock_destroy(instance_ptr->lock);
+
+fail_free:
+  free(instance_ptr);
+
+fail:
+  return 0;
+}
+
+void
+lv2dynparam_host_group_pending_children_count_increment(
+  struct lv2dynparam_host_group * group_ptr)
+{
+  group_ptr->pending_childern_count++;
+
+  if (group_ptr->parent_group_ptr != NULL)
+  {
+    lv2dynparam_host_group_pending_children_count_increment(group_ptr->parent_group_ptr);
+  }
+}
+
+void
+lv2dynparam_host_group_pending_children_count_decrement(
+  struct lv2dynparam_host_group * group_ptr)
+{
+  assert(group_ptr->pending_childern_count != 0);
+
+  group_ptr->pending_childern_count--;
+
+  if (group_ptr->parent_group_ptr != NULL)
+  {
+    lv2dynparam_host_group_pending_children_count_decrement(group_ptr->parent_group_ptr);
   }
 }
 
 void
 lv2dynparam_host_notify_group_appeared(
   struct lv2dynparam_host_instance * instance_ptr,
-  struct lv2dynparam_host_group * group_ptr)
+  struct lv2dynparam_host_group * group_ptr)
+{
+  void * parent_group_ui_context;
+
+  LOG_DEBUG("lv2dynparam_host_notify_group_appeared() called for '%s'.", group_ptr->name);
+
+  if (group_ptr->parent_group_ptr)
+  {
+    parent_group_ui_context = group_ptr->parent_group_ptr->ui_context;
+  }
+  else
+  {
+    /* Master Yoda says: The root group it is */
+    parent_group_ui_context = NULL;
+  }
+
+  dynparam_ui_group_appeared(
+    group_ptr,
+    instance_ptr->instance_context,
+    parent_group_ui_context,
+    group_ptr->name,
+    &group_ptr->hints,
+    &group_ptr->ui_context);
+}
+
+void
+lv2dynparam_host_notify_group_disappeared(
+  struct lv2dynparam_host_instance * instance_ptr,
+  struct lv2dynparam_host_group * group_ptr)
+{
+  void * parent_group_ui_context;
+
+  LOG_DEBUG("lv2dynparam_host_notify_group_disappeared() called for '%s'.", group_ptr->name);
+
+  if (group_ptr->parent_group_ptr)
+  {
+    parent_group_ui_context = group_ptr->parent_group_ptr->ui_context;
+  }
+  else
+  {
+    /* Master Yoda says: The root group it is */
+    parent_group_ui_context = NULL;
+  }
+
+  dynparam_ui_group_disappeared(
+    instance_ptr->instance_context,
+    parent_group_ui_context,
+    group_ptr->ui_context);
+}
+
+unsigned int
+lv2dynparam_host_path_hash_component(
+  unsigned int hash,
+  const char * name)
+{
+  /* FNV-1a, the terminating zero char is hashed too, to separate the components */
+  do
+  {
+    hash ^= (unsigned char)*name;
+    hash *= 16777619u;
+  }
+  while (*name++ != 0);
+
+  return hash;
+}
+
+static
+unsigned int
+path_hash_asciizz(
+  const char * asciizz)
+{
+  unsigned int hash;
+
+  hash = LV2DYNPARAM_HOST_PATH_HASH_INITIAL;
+
+  while (*asciizz != 0)
+  {
+    hash = lv2dynparam_host_path_hash_component(hash, asciizz);
+    asciizz += strlen(asciizz) + 1;
+  }
+
+  return hash;
+}
+
+/* size of asciizz, including both terminating zero chars */
+static
+size_t
+asciizz_size(
+  const char * asciizz)
+{
+  const char * char_ptr;
+
+  char_ptr = asciizz;
+
+  while (*char_ptr != 0)
+  {
+    char_ptr += strlen(char_ptr) + 1;
+  }
+
+  return char_ptr - asciizz + 1;
+}
+
+static
+const char *
+get_prev_component(
+  const char * begining_ptr,
+  const char * char_ptr)
+{
+  if (char_ptr == begining_ptr)
+  {
+    return NULL;
+  }
+
+  char_ptr--;
+
+loop:
+  if (char_ptr == begining_ptr || char_ptr[-1] == 0)
+  {
+    return char_ptr;
+  }
+
+  char_ptr--;
+  goto loop;
+}
+
+static
+bool
+parameter_asciizz_match(
+  struct lv2dynparam_host_instance * instance_ptr,
+  struct lv2dynparam_host_parameter * parameter_ptr,
+  const char * asciizz)
+{
+  const char * component;
+  const char * name;
+  struct lv2dynparam_host_group * group_ptr;
+
+  component = asciizz;
+
+  do
+  {
+    component = component + strlen(component) + 1;
+  }
+  while (*component != 0);
+
+  group_ptr = NULL;
+  name = parameter_ptr->name;
+
+loop:
+  component = get_prev_component(asciizz, component);
+  if (!component)
+  {
+    return group_ptr == instance_ptr->root_group_ptr;
+  }
+
+  if (group_ptr == instance_ptr->root_group_ptr)
+  {
+    return false;
+  }
+
+  if (strcmp(component, name) != 0)
+  {
+    return false;
+  }
+
+  if (group_ptr == NULL)
+  {
+    group_ptr = parameter_ptr->group_ptr;
+  }
+  else
+  {
+    group_ptr = group_ptr->parent_group_ptr;
+  }
+
+  name = group_ptr->name;
+
+  goto loop;
+}
+
+static
+void
+free_parameter_pending_value_change(
+  struct lv2dynparam_host_instance * instance_ptr,
+  struct lv2dynparam_host_parameter_pending_value_change * value_ptr,
+  bool free_data_pointers)
+{
+  rtsafe_memory_deallocate(value_ptr->name_asciizz);
+
+  if (free_data_pointers)
+  {
+    if (value_ptr->type == LV2DYNPARAM_PARAMETER_TYPE_STRING)
+    {
+      rtsafe_memory_deallocate(value_ptr->data.string);
+    }
+  }
+
+  rtsafe_memory_pool_deallocate(instance_ptr->pending_parameter_value_changes_pool, value_ptr);
+}
+
+/* Called from plugin context (usually the realtime thread) when parameter appears.
+ * The matched value change is only moved to the resolved list here, it will be
+ * applied from realtime_run, so the plugin is not reentered from within its own
+ * parameter_appear call. */
+void
+lv2dynparam_host_parameter_resolve_pending_value_change(
+  struct lv2dynparam_host_instance * instance_ptr,
+  struct lv2dynparam_host_parameter * parameter_ptr)
+{
+  struct list_head * bucket_ptr;
+  struct list_head * node_ptr;
+  struct lv2dynparam_host_parameter_pending_value_change * value_ptr;
+
+  bucket_ptr = instance_ptr->pending_parameter_value_changes +
+    (parameter_ptr->path_hash & (LV2DYNPARAM_HOST_PENDING_VALUE_CHANGES_HASH_SIZE - 1));
+
+  list_for_each(node_ptr, bucket_ptr)
+  {
+    value_ptr = list_entry(node_ptr, struct lv2dynparam_host_parameter_pending_value_change, siblings);
+
+    if (value_ptr->path_hash == parameter_ptr->path_hash &&
+        parameter_asciizz_match(instance_ptr, parameter_ptr, value_ptr->name_asciizz))
+    {
+      LOG_DEBUG("Found value for parameter '%s'", parameter_ptr->name);
+      list_del(node_ptr);
+      value_ptr->parameter_ptr = parameter_ptr;
+      list_add_tail(node_ptr, &instance_ptr->resolved_parameter_value_changes);
+      return;
+    }
+  }
+}
+
+/* Called from UI thread when parameter is freed, drops resolved but not yet applied value change */
+static
+void
+parameter_drop_resolved_value_change(
+  struct lv2dynparam_host_instance * instance_ptr,
+  struct lv2dynparam_host_parameter * parameter_ptr)
+{
+  struct list_head * node_ptr;
+  struct list_head * temp_node_ptr;
+  struct lv2dynparam_host_parameter_pending_value_change * value_ptr;
+
+  list_for_each_safe(node_ptr, temp_node_ptr, &instance_ptr->resolved_parameter_value_changes)
+  {
+    value_ptr = list_entry(node_ptr, struct lv2dynparam_host_parameter_pending_value_change, siblings);
+    if (value_ptr->parameter_ptr == parameter_ptr)
+    {
+      list_del(node_ptr);
+      free_parameter_pending_value_change(instance_ptr, value_ptr, true);
+    }
+  }
+}
+
+static
+void
+postpone_parameter_value_change(
+  struct lv2dynparam_host_instance * instance_ptr,
+  struct lv2dynparam_host_parameter_pending_value_change * value_ptr)
+{
+  struct list_head * bucket_ptr;
+  struct list_head * node_ptr;
+  struct lv2dynparam_host_parameter_pending_value_change * old_value_ptr;
+  size_t size;
+
+  value_ptr->path_hash = path_hash_asciizz(value_ptr->name_asciizz);
+
+  bucket_ptr = instance_ptr->pending_parameter_value_changes +
+    (value_ptr->path_hash & (LV2DYNPARAM_HOST_PENDING_VALUE_CHANGES_HASH_SIZE - 1));
+
+  /* newer value for same path replaces the older one */
+  size = asciizz_size(value_ptr->name_asciizz);
+  list_for_each(node_ptr, bucket_ptr)
+  {
+    old_value_ptr = list_entry(node_ptr, struct lv2dynparam_host_parameter_pending_value_change, siblings);
+    if (old_value_ptr->path_hash == value_ptr->path_hash &&
+        asciizz_size(old_value_ptr->name_asciizz) == size &&
+        memcmp(old_value_ptr->name_asciizz, value_ptr->name_asciizz, size) == 0)
+    {
+      list_del(node_ptr);
+      free_parameter_pending_value_change(instance_ptr, old_value_ptr, true);
+      break;
+    }
+  }
+
+  list_add_tail(&value_ptr->siblings, bucket_ptr);
+}
+
+/* Called from UI thread with the lock held */
+static
+void
+group_free_subtree(
+  struct lv2dynparam_host_instance * instance_ptr,
+  struct lv2dynparam_host_group * group_ptr)
+{
+  struct lv2dynparam_host_group * child_group_ptr;
+  struct lv2dynparam_host_parameter * parameter_ptr;
+  struct lv2dynparam_host_command * command_ptr;
+
+  while (!list_empty(&group_ptr->child_groups))
+  {
+    child_group_ptr = list_entry(group_ptr->child_groups.next, struct lv2dynparam_host_group, siblings);
+    list_del(&child_group_ptr->siblings);
+    group_free_subtree(instance_ptr, child_group_ptr);
+  }
+
+  while (!list_empty(&group_ptr->child_params))
+  {
+    parameter_ptr = list_entry(group_ptr->child_params.next, struct lv2dynparam_host_parameter, siblings);
+    list_del(&parameter_ptr->siblings);
+
+    if (parameter_ptr->ui_appeared)
+    {
+      dynparam_ui_parameter_disappeared(
+        instance_ptr->instance_context,
+        group_ptr->ui_context,
+        parameter_ptr->type,
+        parameter_ptr->context,
+        parameter_ptr->ui_context);
+    }
+
+    if (parameter_ptr->context_set &&
+        instance_ptr->parameter_destroying_callback != NULL)
+    {
+      instance_ptr->parameter_destroying_callback(
+        instance_ptr->instance_context,
+        parameter_ptr->context);
+    }
+
+    parameter_drop_resolved_value_change(instance_ptr, parameter_ptr);
+    lv2dynparam_host_parameter_free(instance_ptr, parameter_ptr);
+  }
+
+  while (!list_empty(&group_ptr->child_commands))
+  {
+    command_ptr = list_entry(group_ptr->child_commands.next, struct lv2dynparam_host_command, siblings);
+    list_del(&command_ptr->siblings);
+
+    if (command_ptr->ui_appeared)
+    {
+      dynparam_ui_command_disappeared(
+        instance_ptr->instance_context,
+        group_ptr->ui_context,
+        command_ptr->ui_context);
+    }
+
+    command_free(instance_ptr, command_ptr);
+  }
+
+  if (group_ptr->ui_appeared)
+  {
+    lv2dynparam_host_notify_group_disappeared(
+      instance_ptr,
+      group_ptr);
+  }
+
+  lv2dynparam_host_group_free(instance_ptr, group_ptr);
+}
+
+/* Called from UI thread with the lock held, when group removed by plugin
+ * is not referenced by queued value changes anymore */
+static
+void
+group_remove(
+  struct lv2dynparam_host_instance * instance_ptr,
+  struct lv2dynparam_host_group * group_ptr)
+{
+  struct lv2dynparam_host_group * parent_group_ptr;
+  unsigned int count;
+
+  LOG_DEBUG("Freeing removed group \"%s\"", group_ptr->name);
+
+  /* the group itself and everything pending in its subtree */
+  count = group_ptr->pending_childern_count + 1;
+
+  for (parent_group_ptr = group_ptr->parent_group_ptr ;
+       parent_group_ptr != NULL ;
+       parent_group_ptr = parent_group_ptr->parent_group_ptr)
+  {
+    assert(parent_group_ptr->pending_childern_count >= count);
+    parent_group_ptr->pending_childern_count -= count;
+  }
+
+  list_del(&group_ptr->siblings);
+  group_free_subtree(instance_ptr, group_ptr);
+}
+
+void
+lv2dynparam_host_notify(
+  struct lv2dynparam_host_instance * instance_ptr,
+  struct lv2dynparam_host_group * group_ptr)
+{
+  struct list_head * node_ptr;
+  struct list_head * temp_node_ptr;
+  struct lv2dynparam_host_group * child_group_ptr;
+  struct lv2dynparam_host_parameter * parameter_ptr;
+  struct lv2dynparam_host_command * command_ptr;
+
+  //LOG_DEBUG("Iterating \"%s\" groups begin", group_ptr->name);
+
+  list_for_each_safe(node_ptr, temp_node_ptr, &group_ptr->child_groups)
+  {
+    if (group_ptr->pending_childern_count == 0)
+    {
+      break;
+    }
+
+    child_group_ptr = list_entry(node_ptr, struct lv2dynparam_host_group, siblings);
+    //LOG_DEBUG("host notify - group \"%s\"", child_group_ptr->name);
+
+    switch (child_group_ptr->pending_state)
+    {
+    case LV2DYNPARAM_PENDING_APPEAR:
+      if (instance_ptr->ui)
+      {
+        /* UI knows nothing about this group - notify it */
+        lv2dynparam_host_notify_group_appeared(
+          instance_ptr,
+          child_group_ptr);
+        child_group_ptr->ui_appeared = true;
+        child_group_ptr->pending_state = LV2DYNPARAM_PENDING_NOTHING;
+        lv2dynparam_host_group_pending_children_count_decrement(group_ptr);
+      }
+      break;
+    case LV2DYNPARAM_PENDING_NOTHING:
+      break;
+    case LV2DYNPARAM_PENDING_DISAPPEAR:
+      /* children of removed group are not notified individually */
+      if (list_empty(&instance_ptr->ui_to_realtime_queue) &&
+          instance_ptr->plugin_changes == NULL)
+      {
+        group_remove(instance_ptr, child_group_ptr);
+      }
+
+      /* else queued value changes may still reference parameters of this group */
+      continue;
+    default:
+      LOG_ERROR("unknown pending_state %u of group \"%s\"", child_group_ptr->pending_state, child_group_ptr->name);
+      assert(0);
+    }
+
+    lv2dynparam_host_notify(
+      instance_ptr,
+      child_group_ptr);
+  }
+
+  //LOG_DEBUG("Iterating \"%s\" groups end", group_ptr->name);
+  //LOG_DEBUG("Iterating \"%s\" params begin", group_ptr->name);
+
+  list_for_each_safe(node_ptr, temp_node_ptr, &group_ptr->child_params)
+  {
+    if (group_ptr->pending_childern_count == 0)
+    {
+      break;
+    }
+
+    parameter_ptr = list_entry(node_ptr, struct lv2dynparam_host_parameter, siblings);
+    //LOG_DEBUG("host notify - parameter \"%s\"", parameter_ptr->name);
+
+    switch (parameter_ptr->pending_state)
+    {
+    case LV2DYNPARAM_PENDING_APPEAR:
+      if (parameter_ptr->borrowed)
+      {
+        /* hints are not copied yet */
+        break;
+      }
+
+      if (!parameter_ptr->context_set)
+      {
+        instance_ptr->parameter_created_callback(
+          instance_ptr->instance_context,
+          parameter_ptr,
+          parameter_ptr->type,
+          parameter_ptr->name,
+          &parameter_ptr->context);
+
+        parameter_ptr->context_set = true;
+      }
+
+      if (parameter_ptr->context_pending_value_change != NULL)
+      {
+        if (instance_ptr->parameter_value_change_context != NULL)
+        {
+          instance_ptr->parameter_value_change_context(
+            instance_ptr->instance_context,
+            parameter_ptr->context,
+            parameter_ptr->context_pending_value_change);
+        }
+
+        lv2dynparam_host_group_pending_children_count_decrement(parameter_ptr->group_ptr);
+        parameter_ptr->context_pending_value_change = NULL;
+      }
+
+      if (instance_ptr->ui)
+      {
+        dynparam_ui_parameter_appeared(
+          parameter_ptr,
+          instance_ptr->instance_context,
+          parameter_ptr->group_ptr->ui_context,
+          parameter_ptr->type,
+          parameter_ptr->name,
+          &parameter_ptr->hints,
+          parameter_ptr->value,
+          parameter_ptr->range,
+          parameter_ptr->context,
+          &parameter_ptr->ui_context);
+
+        parameter_ptr->ui_appeared = true;
+        parameter_ptr->pending_state = LV2DYNPARAM_PENDING_NOTHING;
+        lv2dynparam_host_group_pending_children_count_decrement(group_ptr);
+      }
+      break;
+    case LV2DYNPARAM_PENDING_NOTHING:
+      break;
+    case LV2DYNPARAM_PENDING_DISAPPEAR:
+      if (!list_empty(&instance_ptr->ui_to_realtime_queue) ||
+          parameter_ptr->plugin_change_queued)
+      {
+        /* queued value changes may still reference this parameter */
+        break;
+      }
+
+      if (parameter_ptr->ui_appeared)
+      {
+        dynparam_ui_parameter_disappeared(
+          instance_ptr->instance_context,
+          parameter_ptr->group_ptr->ui_context,
+          parameter_ptr->type,
+          parameter_ptr->context,
+          parameter_ptr->ui_context);
+      }
+
+      if (parameter_ptr->context_set &&
+          instance_ptr->parameter_destroying_callback != NULL)
+      {
+        instance_ptr->parameter_destroying_callback(
+          instance_ptr->instance_context,
+          parameter_ptr->context);
+        parameter_ptr->context_set = false;
+      }
+
+      if (parameter_ptr->context_pending_value_change != NULL)
+      {
+        /* parameter removed before it appeared, value change context is not reported */
+        lv2dynparam_host_group_pending_children_count_decrement(group_ptr);
+      }
+
+      parameter_ptr->pending_state = LV2DYNPARAM_PENDING_NOTHING;
+      lv2dynparam_host_group_pending_children_count_decrement(group_ptr);
+      list_del(&parameter_ptr->siblings);
+      parameter_drop_resolved_value_change(instance_ptr, parameter_ptr);
+
+      if (parameter_ptr->pending_value_change)
+      {
+        /* value change of disappeared parameter is not reported */
+        lv2dynparam_host_group_pending_children_count_decrement(group_ptr);
+      }
+
+      lv2dynparam_host_parameter_free(instance_ptr, parameter_ptr);
+      continue;
+    default:
+      LOG_ERROR("unknown pending_state %u of parameter \"%s\"", parameter_ptr->pending_state, parameter_ptr->name);
+      assert(0);
+    }
+
+    if (parameter_ptr->pending_value_change)
+    {
+      if (instance_ptr->ui)
+      {
+        LOG_DEBUG("notifying host about value change");
+
+        dynparam_ui_parameter_value_changed(
+          instance_ptr->instance_context,
+          parameter_ptr->context,
+          parameter_ptr->ui_context,
+          parameter_ptr->value);
+      }
+      else
+      {
+        LOG_DEBUG("ignoring value change because UI is off");
+      }
+
+      parameter_ptr->pending_value_change = false;
+      lv2dynparam_host_group_pending_children_count_decrement(parameter_ptr->group_ptr);
+    }
+  }
+
+  //LOG_DEBUG("Iterating \"%s\" params end", group_ptr->name);
+
+  list_for_each_safe(node_ptr, temp_node_ptr, &group_ptr->child_commands)
+  {
+    if (group_ptr->pending_childern_count == 0)
+    {
+      break;
+    }
+
+    command_ptr = list_entry(node_ptr, struct lv2dynparam_host_command, siblings);
+
+    switch (command_ptr->pending_state)
+    {
+    case LV2DYNPARAM_PENDING_APPEAR:
+      if (instance_ptr->ui)
+      {
+        dynparam_ui_command_appeared(
+          command_ptr,
+          instance_ptr->instance_context,
+          command_ptr->group_ptr->ui_context,
+          command_ptr->name,
+          &command_ptr->hints,
+          &command_ptr->ui_context);
+
+        command_ptr->ui_appeared = true;
+        command_ptr->pending_state = LV2DYNPARAM_PENDING_NOTHING;
+        lv2dynparam_host_group_pending_children_count_decrement(group_ptr);
+      }
+      break;
+    case LV2DYNPARAM_PENDING_NOTHING:
+      break;
+    case LV2DYNPARAM_PENDING_DISAPPEAR:
+      if (!list_empty(&instance_ptr->ui_to_realtime_queue))
+      {
+        /* queued executions may still reference this command */
+        break;
+      }
+
+      if (command_ptr->ui_appeared)
+      {
+        dynparam_ui_command_disappeared(
+          instance_ptr->instance_context,
+          command_ptr->group_ptr->ui_context,
+          command_ptr->ui_context);
+      }
+
+      lv2dynparam_host_group_pending_children_count_decrement(group_ptr);
+      list_del(&command_ptr->siblings);
+      command_free(instance_ptr, command_ptr);
+      break;
+    default:
+      LOG_ERROR("unknown pending_state %u of command \"%s\"", command_ptr->pending_state, command_ptr->name);
+      assert(0);
+    }
+  }
+}
+
+/* called when ui going off */
+void
+lv2dynparam_host_group_hide(
+  struct lv2dynparam_host_instance * instance_ptr,
+  struct lv2dynparam_host_group * group_ptr)
+{
+  struct list_head * node_ptr;
+  struct lv2dynparam_host_group * child_group_ptr;
+  struct lv2dynparam_host_parameter * parameter_ptr;
+  struct lv2dynparam_host_command * command_ptr;
+
+  assert(!instance_ptr->ui);
+
+  if (!group_ptr->ui_appeared)
+  {
+    /* UI does not know about this group and thus cannot know about its childred too */
+    return;
+  }
+
+  //LOG_DEBUG("Hidding group \"%s\" group", group_ptr->name);
+
+  list_for_each(node_ptr, &group_ptr->child_params)
+  {
+    parameter_ptr = list_entry(node_ptr, struct lv2dynparam_host_parameter, siblings);
+
+    if (!parameter_ptr->ui_appeared)
+    {
+      continue;
+    }
+
+    //LOG_DEBUG("Hidding parameter \"%s\" group", parameter_ptr->name);
+
+    dynparam_ui_parameter_disappeared(
+      instance_ptr->instance_context,
+      parameter_ptr->group_ptr->ui_context,
+      parameter_ptr->type,
+      parameter_ptr->context,
+      parameter_ptr->ui_context);
+
+    parameter_ptr->ui_appeared = false;
+
+    if (parameter_ptr->pending_state == LV2DYNPARAM_PENDING_NOTHING)
+    {
+      parameter_ptr->pending_state = LV2DYNPARAM_PENDING_APPEAR;
+      lv2dynparam_host_group_pending_children_count_increment(group_ptr);
+    }
+  }
+
+  list_for_each(node_ptr, &group_ptr->child_commands)
+  {
+    command_ptr = list_entry(node_ptr, struct lv2dynparam_host_command, siblings);
+
+    if (!command_ptr->ui_appeared)
+    {
+      continue;
+    }
+
+    dynparam_ui_command_disappeared(
+      instance_ptr->instance_context,
+      command_ptr->group_ptr->ui_context,
+      command_ptr->ui_context);
+
+    command_ptr->ui_appeared = false;
+
+    if (command_ptr->pending_state == LV2DYNPARAM_PENDING_NOTHING)
+    {
+      command_ptr->pending_state = LV2DYNPARAM_PENDING_APPEAR;
+      lv2dynparam_host_group_pending_children_count_increment(group_ptr);
+    }
+  }
+
+  list_for_each(node_ptr, &group_ptr->child_groups)
+  {
+    child_group_ptr = list_entry(node_ptr, struct lv2dynparam_host_group, siblings);
+
+    if (child_group_ptr->pending_state == LV2DYNPARAM_PENDING_NOTHING)
+    {
+      /* groups pending appear or disappear are already counted */
+      lv2dynparam_host_group_pending_children_count_increment(group_ptr);
+    }
+
+    lv2dynparam_host_group_hide(
+      instance_ptr,
+      child_group_ptr);
+  }
+
+  lv2dynparam_host_notify_group_disappeared(
+    instance_ptr,
+    group_ptr);
+
+  group_ptr->ui_appeared = false;
+
+  if (group_ptr->pending_state == LV2DYNPARAM_PENDING_NOTHING)
+  {
+    group_ptr->pending_state = LV2DYNPARAM_PENDING_APPEAR;
+  }
+}
+
+static
+size_t
+escaped_len(
+  const char * string)
+{
+  size_t len;
+
+  len = 0;
+  for ( ; *string ; string++)
+  {
+    len++;
+
+    if (*string == SERIALIZE_SEPARATOR_CHAR ||
+        *string == SERIALIZE_ESCAPE_CHAR)
+    {
+      len++;
+    }
+  }
+
+  return len;
+}
+
+static
+char *
+escape_copy(
+  char * dest_ptr,
+  const char * string)
+{
+  for ( ; *string ; string++)
+  {
+    if (*string == SERIALIZE_SEPARATOR_CHAR ||
+        *string == SERIALIZE_ESCAPE_CHAR)
+    {
+      *dest_ptr++ = SERIALIZE_ESCAPE_CHAR;
+    }
+
+    *dest_ptr++ = *string;
+  }
+
+  return dest_ptr;
+}
+
+static
+const char *
+group_get_path(
+  struct lv2dynparam_host_group * group_ptr);
+
+/* Compose the escaped path of object with supplied name, child of group_ptr.
+ * The cached path of the parent group is used as prefix. */
+static
+char *
+compose_path(
+  struct lv2dynparam_host_group * group_ptr,
+  const char * name,
+  size_t * len_ptr)
+{
+  size_t len;
+  char * path;
+  char * dest_ptr;
+
+  if (group_get_path(group_ptr) == NULL)
+  {
+    return NULL;
+  }
+
+  len = group_ptr->path_len;
+  if (len != 0)
+  {
+    len++;                      /* separator */
+  }
+
+  len += escaped_len(name);
+
+  path = malloc(len + 1);
+  if (path == NULL)
+  {
+    LOG_ERROR("malloc() failed to allocate %zu bytes", len + 1);
+    return NULL;
+  }
+
+  dest_ptr = path;
+
+  if (group_ptr->path_len != 0)
+  {
+    memcpy(dest_ptr, group_ptr->path, group_ptr->path_len);
+    dest_ptr += group_ptr->path_len;
+    *dest_ptr++ = SERIALIZE_SEPARATOR_CHAR;
+  }
+
+  dest_ptr = escape_copy(dest_ptr, name);
+  *dest_ptr = 0;
+
+  assert(dest_ptr - path == len);
+
+  *len_ptr = len;
+  return path;
+}
+
+/* Paths are cached until the object is freed. Groups and parameters
+ * cannot be renamed or moved, so only their removal invalidates the cache. */
+static
+const char *
+group_get_path(
+  struct lv2dynparam_host_group * group_ptr)
+{
+  if (group_ptr->path != NULL)
+  {
+    return group_ptr->path;
+  }
+
+  if (group_ptr->parent_group_ptr == NULL)
+  {
+    /* root group is not part of the path */
+    group_ptr->path = strdup("");
+    if (group_ptr->path == NULL)
+    {
+      LOG_ERROR("strdup() failed");
+      return NULL;
+    }
+
+    group_ptr->path_len = 0;
+    return group_ptr->path;
+  }
+
+  group_ptr->path = compose_path(group_ptr->parent_group_ptr, group_ptr->name, &group_ptr->path_len);
+  return group_ptr->path;
+}
+
+static
+const char *
+parameter_get_path(
+  struct lv2dynparam_host_parameter * parameter_ptr)
+{
+  size_t len;
+
+  if (parameter_ptr->path == NULL)
+  {
+    parameter_ptr->path = compose_path(parameter_ptr->group_ptr, parameter_ptr->name, &len);
+  }
+
+  return parameter_ptr->path;
+}
+
+static
+void
+numeric_locale_create(void)
+{
+  g_numeric_locale = newlocale(LC_NUMERIC_MASK, "C", (locale_t)0);
+  if (g_numeric_locale == (locale_t)0)
+  {
+    LOG_ERROR("newlocale() failed");
+  }
+}
+
+/* Switch numeric locale of the calling thread to "C", without touching
+ * the process global locale. Returns the locale to be passed to
+ * numeric_locale_leave() */
+static
+locale_t
+numeric_locale_enter(void)
+{
+  pthread_once(&g_numeric_locale_once, numeric_locale_create);
+
+  if (g_numeric_locale == (locale_t)0)
+  {
+    return (locale_t)0;
+  }
+
+  return uselocale(g_numeric_locale);
+}
+
+static
+void
+numeric_locale_leave(
+  locale_t locale)
+{
+  if (locale != (locale_t)0)
+  {
+    uselocale(locale);
+  }
+}
+
+/* Shortest representation that parses back to the same float */
+static
+void
+format_float(
+  char * buffer,
+  size_t buffer_size,
+  float value)
+{
+  int digits;
+
+  for (digits = SERIALIZE_FLOAT_MIN_DIGITS ; digits < SERIALIZE_FLOAT_MAX_DIGITS ; digits++)
+  {
+    snprintf(buffer, buffer_size, "%.*g", digits, value);
+    if (strtof(buffer, NULL) == value)
+    {
+      return;
+    }
+  }
+
+  snprintf(buffer, buffer_size, "%.*g", SERIALIZE_FLOAT_MAX_DIGITS, value);
+}
+
+static
+bool
+parse_float(
+  const char * string,
+  float * value_ptr)
+{
+  char * end_ptr;
+  float value;
+
+  errno = 0;
+  value = strtof(string, &end_ptr);
+  if (end_ptr == string || *end_ptr != 0)
+  {
+    return false;
+  }
+
+  /* ERANGE is set for subnormal results too, those are exact values written
+   * by format_float(). Only overflow, not explicit infinity, is rejected. */
+  if (errno == ERANGE && isinf(value))
+  {
+    return false;
+  }
+
+  *value_ptr = value;
+  return true;
+}
+
+static
+bool
+parse_int(
+  const char * string,
+  signed int * value_ptr)
+{
+  char * end_ptr;
+  long value;
+
+  errno = 0;
+  value = strtol(string, &end_ptr, 10);
+  if (end_ptr == string || *end_ptr != 0 || errno == ERANGE || value < INT_MIN || value > INT_MAX)
+  {
+    return false;
+  }
+
+  *value_ptr = value;
+  return true;
+}
+
+/* Formats parameter value, prefixed with type char. The numeric locale
+ * must be entered by caller. Returns buffer, or malloc()-ed memory when
+ * value does not fit in buffer, NULL on failure. */
+static
+char *
+parameter_format_value(
+  struct lv2dynparam_host_parameter * parameter_ptr,
+  const union lv2dynparam_host_parameter_value * value_ptr,
+  char * buffer,
+  size_t buffer_size)
+{
+  const char * value_string;
+  size_t size;
+
+  assert(buffer_size >= SERIALIZE_VALUE_BUFFER_SIZE);
+
+  switch (parameter_ptr->type)
+  {
+  case LV2DYNPARAM_PARAMETER_TYPE_BOOLEAN:
+    buffer[0] = SERIALIZE_TYPE_CHAR_BOOLEAN;
+    strcpy(buffer + 1, value_ptr->boolean ? "true" : "false");
+    return buffer;
+  case LV2DYNPARAM_PARAMETER_TYPE_FLOAT:
+    buffer[0] = SERIALIZE_TYPE_CHAR_FLOAT;
+    format_float(buffer + 1, buffer_size - 1, value_ptr->fpoint);
+    return buffer;
+  case LV2DYNPARAM_PARAMETER_TYPE_ENUM:
+    value_string = parameter_ptr->range.enumeration.values[value_ptr->enum_selected_index];
+    goto format_string;
+  case LV2DYNPARAM_PARAMETER_TYPE_STRING:
+  case LV2DYNPARAM_PARAMETER_TYPE_FILENAME:
+    value_string = value_ptr->string;
+  format_string:
+    size = strlen(value_string) + 2;
+    if (size > buffer_size)
+    {
+      buffer = malloc(size);
+      if (buffer == NULL)
+      {
+        LOG_ERROR("failed to allocate memory for string value buffer");
+        return NULL;
+      }
+    }
+
+    buffer[0] = SERIALIZE_TYPE_CHAR_STRING;
+    memcpy(buffer + 1, value_string, size - 1);
+    return buffer;
+  case LV2DYNPARAM_PARAMETER_TYPE_INT:
+    snprintf(buffer, buffer_size, "%c%d", SERIALIZE_TYPE_CHAR_INT, value_ptr->integer);
+    return buffer;
+  case LV2DYNPARAM_PARAMETER_TYPE_NOTE:
+    snprintf(buffer, buffer_size, "%c%u", SERIALIZE_TYPE_CHAR_NOTE, value_ptr->note);
+    return buffer;
+  }
+
+  assert(0);                    /* unknown parameter type, should be ignored in host callback */
+  return NULL;
+}
+
+/* Number of parameter values copied per lock hold by lv2dynparam_get_parameters() */
+#define GET_PARAMETERS_CHUNK_SIZE 64
+
+/* Number of restarts, caused by concurrent structure changes, before the tree is walked in single lock hold */
+#define GET_PARAMETERS_MAX_RESTARTS 4
+
+struct parameter_value_copy
+{
+  struct lv2dynparam_host_parameter * parameter_ptr;
+  union lv2dynparam_host_parameter_value value; /* string values point to malloc()-ed copy */
+  unsigned int generation;      /* generation of parameter value when it was copied */
+};
+
+/* Walks the tree in same order as group recursion would, groups before
+ * parameters, but keeps its position so the walk can be resumed after
+ * the lock is released. Parameters and groups are freed only on the UI
+ * thread, so the position stays valid between chunks. */
+struct parameters_iterator
+{
+  struct lv2dynparam_host_group * root_group_ptr;
+  struct lv2dynparam_host_group * group_ptr;
+  struct list_head * node_ptr;
+  bool done;
+
+  unsigned int structure_generation;
+  unsigned int values_generation;
+
+  bool since;                   /* whether to collect only parameters changed after since_generation */
+  unsigned int since_generation;
+
+  struct parameter_value_copy * values;
+  unsigned int count;
+  unsigned int capacity;
+};
+
+/* Called with the lock held. String values are copied, so they can be
+ * formatted after the lock is released. On failure string copy is NULL
+ * and the parameter is not delivered. */
+static
+void
+parameter_value_copy(
+  struct parameter_value_copy * copy_ptr,
+  struct lv2dynparam_host_parameter * parameter_ptr)
+{
+  copy_ptr->parameter_ptr = parameter_ptr;
+  copy_ptr->generation = parameter_ptr->generation;
+
+  if (parameter_ptr->type != LV2DYNPARAM_PARAMETER_TYPE_STRING &&
+      parameter_ptr->type != LV2DYNPARAM_PARAMETER_TYPE_FILENAME)
+  {
+    copy_ptr->value = parameter_ptr->value;
+    return;
+  }
+
+  copy_ptr->value.string = strdup(parameter_ptr->value.string != NULL ? parameter_ptr->value.string : "");
+  if (copy_ptr->value.string == NULL)
+  {
+    LOG_ERROR("strdup() failed");
+  }
+}
+
+/* Frees string value copies */
+static
+void
+parameters_iterator_clear(
+  struct parameters_iterator * iterator_ptr)
+{
+  struct parameter_value_copy * copy_ptr;
+  unsigned int i;
+
+  for (i = 0 ; i < iterator_ptr->count ; i++)
+  {
+    copy_ptr = iterator_ptr->values + i;
+    if (copy_ptr->parameter_ptr->type == LV2DYNPARAM_PARAMETER_TYPE_STRING ||
+        copy_ptr->parameter_ptr->type == LV2DYNPARAM_PARAMETER_TYPE_FILENAME)
+    {
+      free(copy_ptr->value.string);
+    }
+  }
+
+  iterator_ptr->count = 0;
+}
+
+/* Called with the lock held. Copies again values of parameters
+ * that changed after they were collected. */
+static
+void
+parameters_iterator_refresh(
+  struct parameters_iterator * iterator_ptr)
+{
+  struct parameter_value_copy * copy_ptr;
+  unsigned int i;
+
+  for (i = 0 ; i < iterator_ptr->count ; i++)
+  {
+    copy_ptr = iterator_ptr->values + i;
+    if (copy_ptr->generation == copy_ptr->parameter_ptr->generation)
+    {
+      continue;
+    }
+
+    if (copy_ptr->parameter_ptr->type == LV2DYNPARAM_PARAMETER_TYPE_STRING ||
+        copy_ptr->parameter_ptr->type == LV2DYNPARAM_PARAMETER_TYPE_FILENAME)
+    {
+      free(copy_ptr->value.string);
+    }
+
+    parameter_value_copy(copy_ptr, copy_ptr->parameter_ptr);
+  }
+}
+
+static
+void
+parameters_iterator_descend(
+  struct parameters_iterator * iterator_ptr,
+  struct lv2dynparam_host_group * group_ptr)
+{
+  while (!list_empty(&group_ptr->child_groups))
+  {
+    group_ptr = list_entry(group_ptr->child_groups.next, struct lv2dynparam_host_group, siblings);
+  }
+
+  iterator_ptr->group_ptr = group_ptr;
+  iterator_ptr->node_ptr = group_ptr->child_params.next;
+}
+
+/* Called with the lock held */
+static
+void
+parameters_iterator_start(
+  struct lv2dynparam_host_instance * instance_ptr,
+  struct parameters_iterator * iterator_ptr)
+{
+  iterator_ptr->structure_generation = instance_ptr->structure_generation;
+  iterator_ptr->values_generation = instance_ptr->values_generation;
+  assert(iterator_ptr->count == 0);
+  iterator_ptr->root_group_ptr = instance_ptr->root_group_ptr;
+  iterator_ptr->done = iterator_ptr->root_group_ptr == NULL;
+
+  if (!iterator_ptr->done)
+  {
+    parameters_iterator_descend(iterator_ptr, iterator_ptr->root_group_ptr);
+  }
+}
+
+/* Called with the lock held. Copies values of up to max_count parameters.
+ * Returns false if there is more parameters than space for their values. */
+static
+bool
+parameters_iterator_collect(
+  struct parameters_iterator * iterator_ptr,
+  unsigned int max_count)
+{
+  struct lv2dynparam_host_parameter * parameter_ptr;
+  struct lv2dynparam_host_group * parent_group_ptr;
+  struct parameter_value_copy * copy_ptr;
+
+  while (max_count > 0 && !iterator_ptr->done)
+  {
+    if (iterator_ptr->node_ptr != &iterator_ptr->group_ptr->child_params)
+    {
+      if (iterator_ptr->count == iterator_ptr->capacity)
+      {
+        return false;
+      }
+
+      parameter_ptr = list_entry(iterator_ptr->node_ptr, struct lv2dynparam_host_parameter, siblings);
+      iterator_ptr->node_ptr = iterator_ptr->node_ptr->next;
+      max_count--;
+
+      if (parameter_removed(parameter_ptr))
+      {
+        /* plugin storage of the parameter is freed already */
+        continue;
+      }
+
+      /* wraparound safe "changed after" */
+      if (iterator_ptr->since &&
+          (int)(parameter_ptr->generation - iterator_ptr->since_generation) <= 0)
+      {
+        continue;
+      }
+
+      copy_ptr = iterator_ptr->values + iterator_ptr->count;
+      parameter_value_copy(copy_ptr, parameter_ptr);
+      iterator_ptr->count++;
+      continue;
+    }
+
+    /* parameters of current group are done */
+
+    if (iterator_ptr->group_ptr == iterator_ptr->root_group_ptr)
+    {
+      iterator_ptr->done = true;
+      break;
+    }
+
+    parent_group_ptr = iterator_ptr->group_ptr->parent_group_ptr;
+
+    if (iterator_ptr->group_ptr->siblings.next != &parent_group_ptr->child_groups)
+    {
+      parameters_iterator_descend(
+        iterator_ptr,
+        list_entry(iterator_ptr->group_ptr->siblings.next, struct lv2dynparam_host_group, siblings));
+    }
+    else
+    {
+      iterator_ptr->group_ptr = parent_group_ptr;
+      iterator_ptr->node_ptr = parent_group_ptr->child_params.next;
+    }
+  }
+
+  return true;
+}
+
+/* Called without the lock held */
+static
+bool
+parameters_iterator_reserve(
+  struct parameters_iterator * iterator_ptr,
+  unsigned int capacity)
+{
+  struct parameter_value_copy * values;
+
+  values = realloc(iterator_ptr->values, capacity * sizeof(struct parameter_value_copy));
+  if (values == NULL && capacity != 0)
+  {
+    LOG_ERROR("failed to allocate memory for %u parameter values", capacity);
+    return false;
+  }
+
+  iterator_ptr->values = values;
+  iterator_ptr->capacity = capacity;
+
+  return true;
+}
+
+/* Collects consistent copy of all parameter values. The lock is released
+ * every GET_PARAMETERS_CHUNK_SIZE parameters. The walk is restarted if
+ * parameters appeared or disappeared meanwhile. Values changed meanwhile
+ * are found through parameter generation and copied again at the end. */
+static
+bool
+parameters_iterator_run(
+  struct lv2dynparam_host_instance * instance_ptr,
+  struct parameters_iterator * iterator_ptr)
 {
-  void * parent_group_ui_context;
+  unsigned int restarts;
+  unsigned int capacity;
+  bool consistent;
 
-  LOG_DEBUG("lv2dynparam_host_notify_group_appeared() called for '%s'.", group_ptr->name);
+  for (restarts = 0 ; ; restarts++)
+  {
+    parameters_iterator_clear(iterator_ptr);
 
-  if (group_ptr->parent_group_ptr)
+    audiolock_enter_ui(instance_ptr->lock);
+
+    while (instance_ptr->parameters_count > iterator_ptr->capacity)
+    {
+      capacity = instance_ptr->parameters_count;
+      audiolock_leave_ui(instance_ptr->lock);
+
+      if (!parameters_iterator_reserve(iterator_ptr, capacity))
+      {
+        return false;
+      }
+
+      audiolock_enter_ui(instance_ptr->lock);
+    }
+
+    parameters_iterator_start(instance_ptr, iterator_ptr);
+
+    if (restarts == GET_PARAMETERS_MAX_RESTARTS)
+    {
+      /* the tree keeps changing, walk it in single lock hold */
+      consistent = parameters_iterator_collect(iterator_ptr, UINT_MAX);
+      audiolock_leave_ui(instance_ptr->lock);
+      assert(consistent);
+      return true;
+    }
+
+    for (;;)
+    {
+      consistent = parameters_iterator_collect(iterator_ptr, GET_PARAMETERS_CHUNK_SIZE);
+      if (!consistent || iterator_ptr->done)
+      {
+        break;
+      }
+
+      /* let the realtime thread in */
+      audiolock_leave_ui(instance_ptr->lock);
+      sched_yield();
+      audiolock_enter_ui(instance_ptr->lock);
+
+      if (iterator_ptr->structure_generation != instance_ptr->structure_generation)
+      {
+        consistent = false;
+        break;
+      }
+    }
+
+    if (consistent && iterator_ptr->values_generation != instance_ptr->values_generation)
+    {
+      parameters_iterator_refresh(iterator_ptr);
+
+      /* parameters skipped as unchanged may have changed after they were
+       * passed, so the delta is reported since the start generation */
+      if (!iterator_ptr->since)
+      {
+        iterator_ptr->values_generation = instance_ptr->values_generation;
+      }
+    }
+
+    audiolock_leave_ui(instance_ptr->lock);
+
+    if (consistent)
+    {
+      return true;
+    }
+
+    LOG_DEBUG("Parameters changed while being collected, restarting");
+  }
+}
+
+/* Called without the lock held. Parameters cannot be freed meanwhile,
+ * it happens on the UI thread only. */
+static
+void
+parameters_iterator_deliver(
+  struct lv2dynparam_host_instance * instance_ptr,
+  struct parameters_iterator * iterator_ptr,
+  lv2dynparam_parameter_get_callback callback,
+  void * context)
+{
+  struct parameter_value_copy * copy_ptr;
+  const char * path;
+  char value_str[SERIALIZE_VALUE_BUFFER_SIZE];
+  char * value;
+  locale_t locale;
+  unsigned int i;
+
+  for (i = 0 ; i < iterator_ptr->count ; i++)
   {
-    parent_group_ui_context = group_ptr->parent_group_ptr->ui_context;
+    copy_ptr = iterator_ptr->values + i;
+
+    path = parameter_get_path(copy_ptr->parameter_ptr);
+    if (path == NULL)
+    {
+      continue;
+    }
+
+    if ((copy_ptr->parameter_ptr->type == LV2DYNPARAM_PARAMETER_TYPE_STRING ||
+         copy_ptr->parameter_ptr->type == LV2DYNPARAM_PARAMETER_TYPE_FILENAME) &&
+        copy_ptr->value.string == NULL)
+    {
+      continue;
+    }
+
+    locale = numeric_locale_enter();
+    value = parameter_format_value(copy_ptr->parameter_ptr, &copy_ptr->value, value_str, sizeof(value_str));
+    numeric_locale_leave(locale);
+
+    if (value == NULL)
+    {
+      continue;
+    }
+
+    LOG_DEBUG("Parameter '%s' with value '%s'", path, value);
+    callback(context, copy_ptr->parameter_ptr->context, path, value);
+
+    if (value != value_str)
+    {
+      free(value);
+    }
   }
-  else
+}
+
+/* Initial guess for size of path and value strings of one parameter,
+ * used when library allocates the snapshot */
+#define SNAPSHOT_ENTRY_STRINGS_SIZE_GUESS 64
+
+struct snapshot_writer
+{
+  char * buffer;
+  size_t buffer_size;
+  bool grow;                    /* whether buffer is allocated by us */
+  size_t used;
+  unsigned int index;
+  bool overflow;
+  bool failed;
+};
+
+/* Appends string to snapshot and returns its offset. When buffer
+ * is too small and cannot grow, only required size is tracked. */
+static
+unsigned int
+snapshot_append(
+  struct snapshot_writer * writer_ptr,
+  const char * string)
+{
+  size_t size;
+  size_t new_size;
+  char * new_buffer;
+  unsigned int offset;
+
+  size = strlen(string) + 1;
+
+  if (writer_ptr->used + size > writer_ptr->buffer_size && !writer_ptr->overflow)
   {
-    /* Master Yoda says: The root group it is */
-    parent_group_ui_context = NULL;
+    if (!writer_ptr->grow)
+    {
+      writer_ptr->overflow = true;
+    }
+    else
+    {
+      new_size = writer_ptr->buffer_size * 2;
+      if (new_size < writer_ptr->used + size)
+      {
+        new_size = writer_ptr->used + size;
+      }
+
+      new_buffer = realloc(writer_ptr->buffer, new_size);
+      if (new_buffer == NULL)
+      {
+        LOG_ERROR("failed to grow snapshot to %zu bytes", new_size);
+        writer_ptr->failed = true;
+        return 0;
+      }
+
+      writer_ptr->buffer = new_buffer;
+      writer_ptr->buffer_size = new_size;
+    }
   }
 
-  dynparam_ui_group_appeared(
-    group_ptr,
-    instance_ptr->instance_context,
-    parent_group_ui_context,
-    group_ptr->name,
-    &group_ptr->hints,
-    &group_ptr->ui_context);
+  offset = writer_ptr->used;
+  writer_ptr->used += size;
+
+  if (!writer_ptr->overflow)
+  {
+    memcpy(writer_ptr->buffer + offset, string, size);
+  }
+
+  return offset;
 }
 
+static
 void
-lv2dynparam_host_notify_group_disappeared(
+snapshot_group(
+  struct lv2dynparam_host_group * group_ptr,
+  struct snapshot_writer * writer_ptr)
+{
+  struct list_head * node_ptr;
+  struct lv2dynparam_host_group * child_group_ptr;
+  struct lv2dynparam_host_parameter * parameter_ptr;
+  struct lv2dynparam_host_snapshot_entry entry;
+  const char * path;
+  char value_str[SERIALIZE_VALUE_BUFFER_SIZE];
+  char * value;
+
+  list_for_each(node_ptr, &group_ptr->child_groups)
+  {
+    child_group_ptr = list_entry(node_ptr, struct lv2dynparam_host_group, siblings);
+    if (child_group_ptr->pending_state == LV2DYNPARAM_PENDING_DISAPPEAR)
+    {
+      /* removed by plugin, freed on next lv2dynparam_host_ui_run() */
+      continue;
+    }
+
+    snapshot_group(child_group_ptr, writer_ptr);
+    if (writer_ptr->failed)
+    {
+      return;
+    }
+  }
+
+  list_for_each(node_ptr, &group_ptr->child_params)
+  {
+    parameter_ptr = list_entry(node_ptr, struct lv2dynparam_host_parameter, siblings);
+    if (parameter_ptr->pending_state == LV2DYNPARAM_PENDING_DISAPPEAR)
+    {
+      continue;
+    }
+
+    path = parameter_get_path(parameter_ptr);
+    if (path == NULL)
+    {
+      writer_ptr->failed = true;
+      return;
+    }
+
+    value = parameter_format_value(parameter_ptr, &parameter_ptr->value, value_str, sizeof(value_str));
+    if (value == NULL)
+    {
+      writer_ptr->failed = true;
+      return;
+    }
+
+    entry.path_offset = snapshot_append(writer_ptr, path);
+    entry.value_offset = snapshot_append(writer_ptr, value);
+
+    if (value != value_str)
+    {
+      free(value);
+    }
+
+    if (writer_ptr->failed)
+    {
+      return;
+    }
+
+    if (!writer_ptr->overflow)
+    {
+      ((struct lv2dynparam_host_snapshot *)writer_ptr->buffer)->entries[writer_ptr->index] = entry;
+    }
+
+    writer_ptr->index++;
+  }
+}
+
+static
+struct lv2dynparam_host_parameter *
+find_parameter_asciizz(
   struct lv2dynparam_host_instance * instance_ptr,
-  struct lv2dynparam_host_group * group_ptr)
+  const char * asciizz)
 {
-  void * parent_group_ui_context;
+  const char * component;
+  const char * next_component;
+  size_t len;
+  struct lv2dynparam_host_group * group_ptr;
+  struct lv2dynparam_host_group * child_group_ptr;
+  struct lv2dynparam_host_parameter * parameter_ptr;
+  struct list_head * node_ptr;
 
-  LOG_DEBUG("lv2dynparam_host_notify_group_disappeared() called for '%s'.", group_ptr->name);
+  component = asciizz;
+  group_ptr = instance_ptr->root_group_ptr;
 
-  if (group_ptr->parent_group_ptr)
+next_component:
+  if (*component == 0)
   {
-    parent_group_ui_context = group_ptr->parent_group_ptr->ui_context;
+    return NULL;
+  }
+
+  len = strlen(component);
+  next_component = component + len + 1;
+
+  if (*next_component != 0)
+  {
+    /* if this is not last component, we are searching for a group */
+
+    list_for_each(node_ptr, &group_ptr->child_groups)
+    {
+      child_group_ptr = list_entry(node_ptr, struct lv2dynparam_host_group, siblings);
+
+      /* removed group may still be in the tree next to one re-added with same name */
+      if (child_group_ptr->pending_state == LV2DYNPARAM_PENDING_DISAPPEAR)
+      {
+        continue;
+      }
+
+      if (strcmp(component, child_group_ptr->name) == 0)
+      {
+        group_ptr = child_group_ptr;
+        component += len + 1;
+        goto next_component;
+      }
+    }
   }
   else
   {
-    /* Master Yoda says: The root group it is */
-    parent_group_ui_context = NULL;
+    /* if this is the last component, we are searching for a parameter  */
+
+    list_for_each(node_ptr, &group_ptr->child_params)
+    {
+      parameter_ptr = list_entry(node_ptr, struct lv2dynparam_host_parameter, siblings);
+
+      if (parameter_ptr->pending_state == LV2DYNPARAM_PENDING_DISAPPEAR)
+      {
+        continue;
+      }
+
+      if (strcmp(component, parameter_ptr->name) == 0)
+      {
+        return parameter_ptr;
+      }
+    }
   }
 
-  dynparam_ui_group_disappeared(
-    instance_ptr->instance_context,
-    parent_group_ui_context,
-    group_ptr->ui_context);
+  return NULL;
 }
 
-/* TODO: this should be moved to when parameter appeares in realtime thread, lv2dynparam_host_parameter_appear() */
-/* we dont really have test case for this yet */
-#if 0
 static
-const char *
-get_prev_component(
-  const char * begining_ptr,
-  const char * char_ptr)
+void
+parameter_value_change(
+  struct lv2dynparam_host_instance * instance_ptr,
+  struct lv2dynparam_host_parameter * parameter_ptr,
+  unsigned int value_type,
+  union lv2dynparam_host_parameter_value * value_ptr)
 {
-  if (char_ptr == begining_ptr)
+  if (parameter_removed(parameter_ptr))
   {
-    return NULL;
+    /* plugin already freed the parameter */
+    return;
   }
 
-  char_ptr--;
-
-loop:
-  if (char_ptr == begining_ptr || char_ptr[-1] == 0)
+  if (value_ptr != &parameter_ptr->value &&
+      !parameter_ptr->type_ops->assign(parameter_ptr, value_type, value_ptr))
   {
-    return char_ptr;
+    return;
   }
 
-  char_ptr--;
-  goto loop;
+  parameter_ptr->type_ops->write(parameter_ptr);
+
+  parameter_ptr->generation = ++instance_ptr->values_generation;
+
+  instance_ptr->callbacks_ptr->parameter_change(parameter_ptr->param_handle);
 }
 
 static
-bool
-parameter_asciizz_match(
+void
+apply_value_change(
   struct lv2dynparam_host_instance * instance_ptr,
   struct lv2dynparam_host_parameter * parameter_ptr,
-  const char * asciizz)
+  struct lv2dynparam_host_parameter_pending_value_change * value_ptr)
 {
-  const char * component;
-  const char * name;
-  struct lv2dynparam_host_group * group_ptr;
+  LOG_DEBUG("Applying pending parameter '%s' value change", parameter_ptr->name);
 
-  component = asciizz;
+  parameter_value_change(instance_ptr, parameter_ptr, value_ptr->type, &value_ptr->data);
 
-  do
+  parameter_ptr->context_pending_value_change = value_ptr->context;
+  if (value_ptr->context != NULL)
   {
-    component = component + strlen(component) + 1;
+    lv2dynparam_host_group_pending_children_count_increment(parameter_ptr->group_ptr);
   }
-  while (*component != 0);
-
-  group_ptr = NULL;
-  name = parameter_ptr->name;
+}
 
-loop:
-  component = get_prev_component(asciizz, component);
-  if (!component)
-  {
-    return group_ptr == instance_ptr->root_group_ptr;
-  }
+static
+void
+apply_pending_value_change(
+  struct lv2dynparam_host_instance * instance_ptr,
+  struct lv2dynparam_host_parameter * parameter_ptr,
+  struct lv2dynparam_host_parameter_pending_value_change * value_ptr)
+{
+  apply_value_change(instance_ptr, parameter_ptr, value_ptr);
 
-  if (group_ptr == instance_ptr->root_group_ptr)
-  {
-    return false;
-  }
+  /* string values are copied when applied */
+  free_parameter_pending_value_change(
+    instance_ptr,
+    value_ptr,
+    value_ptr->type == LV2DYNPARAM_PARAMETER_TYPE_STRING);
+}
 
-  //LOG_DEBUG("'%s' ?= '%s'", component, name);
+static
+void
+apply_resolved_value_changes(
+  struct lv2dynparam_host_instance * instance_ptr)
+{
+  struct list_head * node_ptr;
+  struct lv2dynparam_host_parameter_pending_value_change * value_ptr;
 
-  if (strcmp(component, name) != 0)
+  /* applying a value may cause more parameters to appear and resolve */
+  while (!list_empty(&instance_ptr->resolved_parameter_value_changes))
   {
-    return false;
+    node_ptr = instance_ptr->resolved_parameter_value_changes.next;
+    list_del(node_ptr);
+    value_ptr = list_entry(node_ptr, struct lv2dynparam_host_parameter_pending_value_change, siblings);
+    apply_pending_value_change(instance_ptr, value_ptr->parameter_ptr, value_ptr);
   }
+}
 
-  if (group_ptr == NULL)
+/* Called from realtime thread for value change of parameter that was not found on the UI thread */
+static
+void
+dispatch_unresolved_value_change(
+  struct lv2dynparam_host_instance * instance_ptr,
+  struct lv2dynparam_host_parameter_pending_value_change * value_ptr)
+{
+  struct lv2dynparam_host_parameter * parameter_ptr;
+
+  parameter_ptr = find_parameter_asciizz(instance_ptr, value_ptr->name_asciizz);
+  if (parameter_ptr != NULL)
   {
-    group_ptr = parameter_ptr->group_ptr;
+    apply_pending_value_change(instance_ptr, parameter_ptr, value_ptr);
   }
   else
   {
-    group_ptr = group_ptr->parent_group_ptr;
+    /* will be resolved when parameter appears, lv2dynparam_host_parameter_appear() */
+    LOG_DEBUG("Postponing pending parameter value change");
+    postpone_parameter_value_change(instance_ptr, value_ptr);
   }
-
-  name = group_ptr->name;
-
-  goto loop;
 }
 
-  struct list_head * node_ptr;
-  struct lv2dynparam_host_parameter_pending_value_change * value_ptr;
+/* Called from realtime thread */
+static
+void
+apply_batch(
+  struct lv2dynparam_host_instance * instance_ptr,
+  struct lv2dynparam_host_batch * batch_ptr)
+{
+  unsigned int i;
+  struct lv2dynparam_host_batch_entry * entry_ptr;
 
-  value_ptr = NULL;
-  list_for_each(node_ptr, &instance_ptr->pending_parameter_value_changes)
+  for (i = 0 ; i < batch_ptr->count ; i++)
   {
-    value_ptr = list_entry(node_ptr, struct lv2dynparam_host_parameter_pending_value_change, siblings);
-    if (parameter_asciizz_match(instance_ptr, parameter_ptr, value_ptr->name_asciizz))
+    entry_ptr = batch_ptr->entries + i;
+
+    if (entry_ptr->parameter_ptr == NULL)
     {
-      list_del(node_ptr);
-      break;
+      /* ownership of the value change goes to the realtime side */
+      dispatch_unresolved_value_change(instance_ptr, entry_ptr->value_ptr);
+    }
+    else if (entry_ptr->parameter_ptr->pending_state == LV2DYNPARAM_PENDING_DISAPPEAR)
+    {
+      LOG_DEBUG("Ignoring value change of disappeared parameter '%s'", entry_ptr->parameter_ptr->name);
+    }
+    else
+    {
+      apply_value_change(instance_ptr, entry_ptr->parameter_ptr, entry_ptr->value_ptr);
     }
 
-    value_ptr = NULL;
+    /* keep order with values that were postponed before this batch */
+    apply_resolved_value_changes(instance_ptr);
   }
+}
+
+struct lv2dynparam_host_batch *
+lv2dynparam_host_batch_create(
+  struct lv2dynparam_host_instance * instance_ptr,
+  unsigned int max_count)
+{
+  struct lv2dynparam_host_batch * batch_ptr;
 
-  if (value_ptr)
+  batch_ptr = malloc(sizeof(struct lv2dynparam_host_batch) + max_count * sizeof(struct lv2dynparam_host_batch_entry));
+  if (batch_ptr == NULL)
   {
-    LOG_ERROR("Found value for parameter '%s'", parameter_ptr->name);
+    LOG_ERROR("failed to allocate memory for batch of %u value changes", max_count);
+    goto fail;
   }
 
-  if (value_ptr != NULL)
+  batch_ptr->message_ptr = rtsafe_memory_pool_allocate_sleepy(instance_ptr->messages_pool);
+  if (batch_ptr->message_ptr == NULL)
   {
-    if (value_ptr->type == LV2DYNPARAM_PARAMETER_TYPE_STRING)
-    {
-      rtsafe_memory_deallocate(value_ptr->data.string);
-    }
-
-    rtsafe_memory_deallocate(value_ptr->name_asciizz);
-    rtsafe_memory_pool_deallocate(instance_ptr->pending_parameter_value_changes_pool, value_ptr);
+    LOG_ERROR("failed to allocate memory for host message");
+    goto fail_free;
   }
 
-#endif
+  batch_ptr->message_ptr->message_type = LV2DYNPARAM_HOST_MESSAGE_TYPE_BATCH;
+  batch_ptr->message_ptr->context.batch = batch_ptr;
+  batch_ptr->submitted = false;
+  batch_ptr->count = 0;
+  batch_ptr->max_count = max_count;
 
-void
-lv2dynparam_host_notify(
+  return batch_ptr;
+
+fail_free:
+  free(batch_ptr);
+
+fail:
+  return NULL;
+}
+
+bool
+lv2dynparam_host_batch_add(
   struct lv2dynparam_host_instance * instance_ptr,
-  struct lv2dynparam_host_group * group_ptr)
+  struct lv2dynparam_host_batch * batch_ptr,
+  char * name_asciizz,
+  unsigned int type,
+  const union lv2dynparam_host_parameter_value * value_ptr,
+  void * context)
 {
-  struct list_head * node_ptr;
-  struct list_head * temp_node_ptr;
-  struct lv2dynparam_host_group * child_group_ptr;
-  struct lv2dynparam_host_parameter * parameter_ptr;
+  struct lv2dynparam_host_parameter_pending_value_change * pending_ptr;
 
-  //LOG_DEBUG("Iterating \"%s\" groups begin", group_ptr->name);
+  assert(!batch_ptr->submitted);
+  assert(batch_ptr->count < batch_ptr->max_count);
 
-  list_for_each(node_ptr, &group_ptr->child_groups)
+  pending_ptr = rtsafe_memory_pool_allocate_sleepy(instance_ptr->pending_parameter_value_changes_pool);
+  if (pending_ptr == NULL)
   {
-    if (group_ptr->pending_childern_count == 0)
-    {
-      break;
-    }
+    LOG_ERROR("failed to allocate memory for pending parameter value change");
+    return false;
+  }
 
-    child_group_ptr = list_entry(node_ptr, struct lv2dynparam_host_group, siblings);
-    //LOG_DEBUG("host notify - group \"%s\"", child_group_ptr->name);
+  pending_ptr->name_asciizz = name_asciizz;
+  pending_ptr->type = type;
+  pending_ptr->data = *value_ptr;
+  pending_ptr->context = context;
 
-    switch (child_group_ptr->pending_state)
-    {
-    case LV2DYNPARAM_PENDING_APPEAR:
-      if (instance_ptr->ui)
-      {
-        /* UI knows nothing about this group - notify it */
-        lv2dynparam_host_notify_group_appeared(
-          instance_ptr,
-          child_group_ptr);
-        child_group_ptr->pending_state = LV2DYNPARAM_PENDING_NOTHING;
-        lv2dynparam_host_group_pending_children_count_decrement(group_ptr);
-      }
-      break;
-    case LV2DYNPARAM_PENDING_NOTHING:
-      break;
-    case LV2DYNPARAM_PENDING_DISAPPEAR:
-      lv2dynparam_host_notify_group_disappeared(
-        instance_ptr,
-        child_group_ptr);
-      lv2dynparam_host_group_pending_children_count_decrement(group_ptr);
-      list_del(&child_group_ptr->siblings);
-      lv2dynparam_host_group_free(instance_ptr, child_group_ptr);
-      break;
-    default:
-      LOG_ERROR("unknown pending_state %u of group \"%s\"", child_group_ptr->pending_state, child_group_ptr->name);
-      assert(0);
-    }
+  batch_ptr->entries[batch_ptr->count].parameter_ptr = NULL;
+  batch_ptr->entries[batch_ptr->count].value_ptr = pending_ptr;
+  batch_ptr->count++;
 
-    lv2dynparam_host_notify(
-      instance_ptr,
-      child_group_ptr);
-  }
+  return true;
+}
 
-  //LOG_DEBUG("Iterating \"%s\" groups end", group_ptr->name);
-  //LOG_DEBUG("Iterating \"%s\" params begin", group_ptr->name);
+/* Resolves value change of enum parameter, given as string, to value index */
+static
+void
+batch_resolve_enum(
+  struct lv2dynparam_host_parameter * parameter_ptr,
+  struct lv2dynparam_host_parameter_pending_value_change * value_ptr)
+{
+  unsigned int i;
 
-  list_for_each_safe(node_ptr, temp_node_ptr, &group_ptr->child_params)
+  for (i = 0 ; i < parameter_ptr->range.enumeration.values_count ; i++)
   {
-    if (group_ptr->pending_childern_count == 0)
+    if (strcmp(parameter_ptr->range.enumeration.values[i], value_ptr->data.string) == 0)
     {
-      break;
+      rtsafe_memory_deallocate(value_ptr->data.string);
+      value_ptr->type = LV2DYNPARAM_PARAMETER_TYPE_ENUM;
+      value_ptr->data.enum_selected_index = i;
+      return;
     }
+  }
 
-    parameter_ptr = list_entry(node_ptr, struct lv2dynparam_host_parameter, siblings);
-    //LOG_DEBUG("host notify - parameter \"%s\"", parameter_ptr->name);
-
-    switch (parameter_ptr->pending_state)
-    {
-    case LV2DYNPARAM_PENDING_APPEAR:
-      if (!parameter_ptr->context_set)
-      {
-        instance_ptr->parameter_created_callback(
-          instance_ptr->instance_context,
-          parameter_ptr,
-          parameter_ptr->type,
-          parameter_ptr->name,
-          &parameter_ptr->context);
-
-        parameter_ptr->context_set = true;
-      }
+  /* leave it as string, error will be logged when applied */
+}
 
-      if (parameter_ptr->context_pending_value_change != NULL)
-      {
-        if (instance_ptr->parameter_value_change_context != NULL)
-        {
-          instance_ptr->parameter_value_change_context(
-            instance_ptr->instance_context,
-            parameter_ptr->context,
-            parameter_ptr->context_pending_value_change);
-        }
+void
+lv2dynparam_host_batch_submit(
+  struct lv2dynparam_host_instance * instance_ptr,
+  struct lv2dynparam_host_batch * batch_ptr)
+{
+  unsigned int i;
+  struct lv2dynparam_host_batch_entry * entry_ptr;
+  struct lv2dynparam_host_parameter * parameter_ptr;
 
-        lv2dynparam_host_group_pending_children_count_decrement(parameter_ptr->group_ptr);
-        parameter_ptr->context_pending_value_change = NULL;
-      }
+  if (batch_ptr->count == 0)
+  {
+    lv2dynparam_host_batch_free(instance_ptr, batch_ptr);
+    return;
+  }
 
-      if (instance_ptr->ui)
-      {
-        dynparam_ui_parameter_appeared(
-          parameter_ptr,
-          instance_ptr->instance_context,
-          parameter_ptr->group_ptr->ui_context,
-          parameter_ptr->type,
-          parameter_ptr->name,
-          &parameter_ptr->hints,
-          parameter_ptr->value,
-          parameter_ptr->range,
-          parameter_ptr->context,
-          &parameter_ptr->ui_context);
+  audiolock_enter_ui(instance_ptr->lock);
 
-        parameter_ptr->pending_state = LV2DYNPARAM_PENDING_NOTHING;
-        lv2dynparam_host_group_pending_children_count_decrement(group_ptr);
-      }
-      break;
-    case LV2DYNPARAM_PENDING_NOTHING:
-      break;
-    case LV2DYNPARAM_PENDING_DISAPPEAR:
-      if (instance_ptr->ui)
-      {
-        dynparam_ui_parameter_disappeared(
-          instance_ptr->instance_context,
-          parameter_ptr->group_ptr->ui_context,
-          parameter_ptr->type,
-          parameter_ptr->context,
-          parameter_ptr->ui_context);
-      }
+  for (i = 0 ; i < batch_ptr->count ; i++)
+  {
+    entry_ptr = batch_ptr->entries + i;
 
-      if (instance_ptr->parameter_destroying_callback != NULL)
-      {
-        assert(parameter_ptr->context_set);
-        instance_ptr->parameter_destroying_callback(
-          instance_ptr->instance_context,
-          parameter_ptr->context);
-        parameter_ptr->context_set = false;
-      }
+    parameter_ptr = find_parameter_asciizz(instance_ptr, entry_ptr->value_ptr->name_asciizz);
+    if (parameter_ptr == NULL ||
+        parameter_ptr->pending_state == LV2DYNPARAM_PENDING_DISAPPEAR)
+    {
+      continue;
+    }
 
-      parameter_ptr->pending_state = LV2DYNPARAM_PENDING_NOTHING;
-      lv2dynparam_host_group_pending_children_count_decrement(group_ptr);
-      list_del(&parameter_ptr->siblings);
-      lv2dynparam_host_parameter_free(instance_ptr, parameter_ptr);
-      break;
-    default:
-      LOG_ERROR("unknown pending_state %u of parameter \"%s\"", parameter_ptr->pending_state, parameter_ptr->name);
-      assert(0);
+    if (parameter_ptr->type == LV2DYNPARAM_PARAMETER_TYPE_ENUM &&
+        entry_ptr->value_ptr->type == LV2DYNPARAM_PARAMETER_TYPE_STRING)
+    {
+      batch_resolve_enum(parameter_ptr, entry_ptr->value_ptr);
     }
 
-    if (parameter_ptr->pending_value_change)
+    if (entry_ptr->value_ptr->type != parameter_ptr->type &&
+        !((parameter_ptr->type == LV2DYNPARAM_PARAMETER_TYPE_ENUM ||
+           parameter_ptr->type == LV2DYNPARAM_PARAMETER_TYPE_FILENAME) &&
+          entry_ptr->value_ptr->type == LV2DYNPARAM_PARAMETER_TYPE_STRING) &&
+        !(parameter_ptr->type == LV2DYNPARAM_PARAMETER_TYPE_NOTE &&
+          entry_ptr->value_ptr->type == LV2DYNPARAM_PARAMETER_TYPE_INT))
     {
-      if (instance_ptr->ui)
-      {
-        LOG_DEBUG("notifying host about value change");
+      LOG_ERROR("Batch value of type %u does not match parameter '%s' of type %u", entry_ptr->value_ptr->type, parameter_ptr->name, parameter_ptr->type);
+      continue;
+    }
 
-        dynparam_ui_parameter_value_changed(
-          instance_ptr->instance_context,
-          parameter_ptr->context,
-          parameter_ptr->ui_context,
-          parameter_ptr->value);
-      }
-      else
-      {
-        LOG_DEBUG("ignoring value change because UI is off");
-      }
+    entry_ptr->parameter_ptr = parameter_ptr;
+  }
 
-      parameter_ptr->pending_value_change = false;
-      lv2dynparam_host_group_pending_children_count_decrement(parameter_ptr->group_ptr);
+  batch_ptr->submitted = true;
+  list_add_tail(&batch_ptr->message_ptr->siblings, &instance_ptr->ui_to_realtime_queue);
+  instance_ptr->ui_to_realtime_changes += batch_ptr->count;
+
+  audiolock_leave_ui(instance_ptr->lock);
+}
+
+void
+lv2dynparam_host_batch_free(
+  struct lv2dynparam_host_instance * instance_ptr,
+  struct lv2dynparam_host_batch * batch_ptr)
+{
+  unsigned int i;
+
+  for (i = 0 ; i < batch_ptr->count ; i++)
+  {
+    /* value changes of unresolved entries are owned by the realtime side once submitted */
+    if (!batch_ptr->submitted || batch_ptr->entries[i].parameter_ptr != NULL)
+    {
+      free_parameter_pending_value_change(instance_ptr, batch_ptr->entries[i].value_ptr, true);
     }
   }
 
-  //LOG_DEBUG("Iterating \"%s\" params end", group_ptr->name);
+  rtsafe_memory_pool_deallocate(instance_ptr->messages_pool, batch_ptr->message_ptr);
+  free(batch_ptr);
 }
 
-/* called when ui going off */
+/* Called from UI thread, with the lock held, to free batches already applied by the realtime thread */
+static
 void
-lv2dynparam_host_group_hide(
-  struct lv2dynparam_host_instance * instance_ptr,
-  struct lv2dynparam_host_group * group_ptr)
+free_applied_batches(
+  struct lv2dynparam_host_instance * instance_ptr)
 {
   struct list_head * node_ptr;
-  struct lv2dynparam_host_group * child_group_ptr;
-  struct lv2dynparam_host_parameter * parameter_ptr;
+  struct lv2dynparam_host_message * message_ptr;
 
-  assert(!instance_ptr->ui);
+  while (!list_empty(&instance_ptr->realtime_to_ui_queue))
+  {
+    node_ptr = instance_ptr->realtime_to_ui_queue.next;
+    list_del(node_ptr);
+    message_ptr = list_entry(node_ptr, struct lv2dynparam_host_message, siblings);
+    assert(message_ptr->message_type == LV2DYNPARAM_HOST_MESSAGE_TYPE_BATCH);
+    lv2dynparam_host_batch_free(instance_ptr, message_ptr->context.batch);
+  }
+}
 
-  if (group_ptr->pending_state == LV2DYNPARAM_PENDING_APPEAR)
+/* schedule call to dynparam_parameter_value_changed() */
+static
+void
+parameter_schedule_ui_value_change(
+  struct lv2dynparam_host_parameter * parameter_ptr)
+{
+  if (parameter_ptr->pending_state != LV2DYNPARAM_PENDING_NOTHING ||
+      parameter_ptr->pending_value_change)
   {
-    /* UI does not know about this group and thus cannot know about its childred too */
+    /* no need to do this if parameter has not yet appeared or is going to disappear or we already scheduled it */
     return;
   }
 
-  //LOG_DEBUG("Hidding group \"%s\" group", group_ptr->name);
+  parameter_ptr->pending_value_change = true;
+  lv2dynparam_host_group_pending_children_count_increment(parameter_ptr->group_ptr);
+}
 
-  list_for_each(node_ptr, &group_ptr->child_params)
-  {
-    parameter_ptr = list_entry(node_ptr, struct lv2dynparam_host_parameter, siblings);
+/* Called from realtime thread with the lock held */
+static
+void
+apply_plugin_value_changes(
+  struct lv2dynparam_host_instance * instance_ptr)
+{
+  struct lv2dynparam_host_parameter * parameter_ptr;
+  struct lv2dynparam_host_parameter * next_ptr;
 
-    if (parameter_ptr->pending_state != LV2DYNPARAM_PENDING_APPEAR)
-    {
-      //LOG_DEBUG("Hidding parameter \"%s\" group", parameter_ptr->name);
+  parameter_ptr = __sync_lock_test_and_set(&instance_ptr->plugin_changes, NULL);
+  while (parameter_ptr != NULL)
+  {
+    next_ptr = parameter_ptr->plugin_change_next;
 
-      dynparam_ui_parameter_disappeared(
-        instance_ptr->instance_context,
-        parameter_ptr->group_ptr->ui_context,
-        parameter_ptr->type,
-        parameter_ptr->context,
-        parameter_ptr->ui_context);
+    /* full barrier, change made while reading the value below queues the parameter again */
+    __sync_bool_compare_and_swap(&parameter_ptr->plugin_change_queued, 1, 0);
 
-      parameter_ptr->pending_state = LV2DYNPARAM_PENDING_APPEAR;
-      lv2dynparam_host_group_pending_children_count_increment(group_ptr);
+    if (!parameter_removed(parameter_ptr))
+    {
+      parameter_ptr->type_ops->read(parameter_ptr);
+      parameter_ptr->generation = ++instance_ptr->values_generation;
+      parameter_schedule_ui_value_change(parameter_ptr);
     }
+
+    parameter_ptr = next_ptr;
   }
+}
 
-  list_for_each(node_ptr, &group_ptr->child_groups)
-  {
-    child_group_ptr = list_entry(node_ptr, struct lv2dynparam_host_group, siblings);
+static
+void
+preset_free(
+  struct lv2dynparam_host_preset * preset_ptr)
+{
+  unsigned int i;
 
-    lv2dynparam_host_group_hide(
-      instance_ptr,
-      child_group_ptr);
+  for (i = 0 ; i < preset_ptr->count ; i++)
+  {
+    rtsafe_memory_deallocate(preset_ptr->entries[i].name_asciizz);
 
-    lv2dynparam_host_group_pending_children_count_increment(group_ptr);
+    if (preset_ptr->entries[i].source_type == LV2DYNPARAM_PARAMETER_TYPE_STRING)
+    {
+      rtsafe_memory_deallocate(preset_ptr->entries[i].source_value.string);
+    }
   }
 
-  lv2dynparam_host_notify_group_disappeared(
-    instance_ptr,
-    group_ptr);
-
-  group_ptr->pending_state = LV2DYNPARAM_PENDING_APPEAR;
+  free(preset_ptr);
 }
 
+/* Called from UI thread with the lock held */
 static
-bool
-prepend_string(
-  char ** buffer_ptr_ptr,
-  size_t * buffer_size_ptr,
-  char ** last_ptr_ptr,
-  const char * string)
+void
+preset_resolve(
+  struct lv2dynparam_host_instance * instance_ptr,
+  struct lv2dynparam_host_preset * preset_ptr)
 {
-  size_t len;
-  char * new_buffer_ptr;
-  size_t new_buffer_size;
-  char * new_last_ptr;
+  unsigned int i;
+  unsigned int j;
+  struct lv2dynparam_host_preset_entry * entry_ptr;
+  struct lv2dynparam_host_parameter * parameter_ptr;
 
-  len = strlen(string);
+  preset_ptr->unresolved_count = 0;
 
-  if (len > *last_ptr_ptr - *buffer_ptr_ptr)
+  for (i = 0 ; i < preset_ptr->count ; i++)
   {
-    new_buffer_size = *buffer_size_ptr + len + SERIALIZE_BUFFER_INCREMENT_SIZE;
+    entry_ptr = preset_ptr->entries + i;
+    entry_ptr->parameter_ptr = NULL;
 
-    new_buffer_ptr = malloc(new_buffer_size);
-    if (new_buffer_ptr == NULL)
+    parameter_ptr = find_parameter_asciizz(instance_ptr, entry_ptr->name_asciizz);
+    if (parameter_ptr == NULL ||
+        parameter_ptr->pending_state == LV2DYNPARAM_PENDING_DISAPPEAR)
     {
-      LOG_ERROR("malloc() failed to allocate %zu bytes", new_buffer_size);
-      return false;
+      preset_ptr->unresolved_count++;
+      continue;
     }
 
-    new_last_ptr = new_buffer_ptr + (new_buffer_size - *buffer_size_ptr) + (*last_ptr_ptr - *buffer_ptr_ptr);
-    assert(*last_ptr_ptr - *buffer_ptr_ptr + len + SERIALIZE_BUFFER_INCREMENT_SIZE == new_last_ptr - new_buffer_ptr);
+    entry_ptr->type = entry_ptr->source_type;
+    entry_ptr->value = entry_ptr->source_value;
 
-    strcpy(new_last_ptr, *last_ptr_ptr);
+    if (parameter_ptr->type == LV2DYNPARAM_PARAMETER_TYPE_ENUM &&
+        entry_ptr->source_type == LV2DYNPARAM_PARAMETER_TYPE_STRING)
+    {
+      for (j = 0 ; j < parameter_ptr->range.enumeration.values_count ; j++)
+      {
+        if (strcmp(parameter_ptr->range.enumeration.values[j], entry_ptr->source_value.string) == 0)
+        {
+          entry_ptr->type = LV2DYNPARAM_PARAMETER_TYPE_ENUM;
+          entry_ptr->value.enum_selected_index = j;
+          break;
+        }
+      }
+    }
+    else if (parameter_ptr->type == LV2DYNPARAM_PARAMETER_TYPE_FILENAME &&
+             entry_ptr->source_type == LV2DYNPARAM_PARAMETER_TYPE_STRING)
+    {
+      entry_ptr->type = LV2DYNPARAM_PARAMETER_TYPE_FILENAME;
+    }
+    else if (parameter_ptr->type == LV2DYNPARAM_PARAMETER_TYPE_NOTE &&
+             entry_ptr->source_type == LV2DYNPARAM_PARAMETER_TYPE_INT &&
+             entry_ptr->source_value.integer >= 0 &&
+             entry_ptr->source_value.integer <= 127)
+    {
+      entry_ptr->type = LV2DYNPARAM_PARAMETER_TYPE_NOTE;
+      entry_ptr->value.note = entry_ptr->source_value.integer;
+    }
 
-    free(*buffer_ptr_ptr);
+    if (entry_ptr->type != parameter_ptr->type)
+    {
+      LOG_ERROR("Preset value of type %u does not match parameter '%s' of type %u", entry_ptr->type, parameter_ptr->name, parameter_ptr->type);
+      continue;
+    }
 
-    *buffer_ptr_ptr = new_buffer_ptr;
-    *buffer_size_ptr = new_buffer_size;
-    *last_ptr_ptr = new_last_ptr;
+    entry_ptr->parameter_ptr = parameter_ptr;
   }
 
-  assert(len <= *last_ptr_ptr - *buffer_ptr_ptr);
+  preset_ptr->version = ++instance_ptr->presets_version;
+  preset_ptr->structure_generation = instance_ptr->structure_generation;
+  preset_ptr->removal_generation = instance_ptr->removal_generation;
+}
+
+/* Called from UI thread with the lock held, after parameters may have appeared or been freed */
+static
+void
+presets_refresh(
+  struct lv2dynparam_host_instance * instance_ptr)
+{
+  unsigned int i;
+  struct lv2dynparam_host_preset * preset_ptr;
 
-  *last_ptr_ptr -= len;
-  memcpy(*last_ptr_ptr, string, len);
+  for (i = 0 ; i < LV2DYNPARAM_HOST_PRESETS_COUNT ; i++)
+  {
+    preset_ptr = instance_ptr->presets[i];
+    if (preset_ptr == NULL)
+    {
+      continue;
+    }
 
-  return true;
+    if (preset_ptr->removal_generation != instance_ptr->removal_generation ||
+        (preset_ptr->unresolved_count != 0 &&
+         preset_ptr->structure_generation != instance_ptr->structure_generation))
+    {
+      preset_resolve(instance_ptr, preset_ptr);
+    }
+  }
 }
 
+/* Called from realtime thread with the lock held */
 static
-char *
-strdup_escape(
-  const char * string)
+void
+preset_apply(
+  struct lv2dynparam_host_instance * instance_ptr,
+  struct lv2dynparam_host_preset * preset_ptr)
 {
-  char * buffer;
-  const char * src_ptr;
-  char * dest_ptr;
-  size_t len;
+  unsigned int i;
+  unsigned int structure_generation;
+  struct lv2dynparam_host_preset_entry * entry_ptr;
+  struct lv2dynparam_host_parameter * parameter_ptr;
 
-  len = 0;
-  for (src_ptr = string ; *src_ptr ; src_ptr++)
+  structure_generation = instance_ptr->structure_generation;
+
+  for (i = 0 ; i < preset_ptr->count ; i++)
   {
-    len++;
+    entry_ptr = preset_ptr->entries + i;
+    parameter_ptr = entry_ptr->parameter_ptr;
 
-    if (*src_ptr == SERIALIZE_SEPARATOR_CHAR ||
-        *src_ptr == SERIALIZE_ESCAPE_CHAR)
+    if (parameter_ptr == NULL ||
+        parameter_ptr->pending_state == LV2DYNPARAM_PENDING_DISAPPEAR)
     {
-      len++;
+      continue;
     }
+
+    parameter_value_change(instance_ptr, parameter_ptr, entry_ptr->type, &entry_ptr->value);
+    parameter_schedule_ui_value_change(parameter_ptr);
+
+    /* values postponed before the preset must not override it */
+    apply_resolved_value_changes(instance_ptr);
   }
-  len++;                        /* terminating zero char */
 
-  buffer = malloc(len);
-  if (buffer == NULL)
+  if (preset_ptr->unresolved_count == 0 ||
+      structure_generation == instance_ptr->structure_generation)
   {
-    LOG_ERROR("malloc() failed to allocate %zu bytes", len);
-    return NULL;
+    return;
   }
 
-  dest_ptr = buffer;
-  for (src_ptr = string ; *src_ptr ; src_ptr++)
+  /* Applying the preset made parameters appear. Look them up now,
+   * preset will be resolved again in lv2dynparam_host_ui_run() */
+  for (i = 0 ; i < preset_ptr->count ; i++)
   {
-    if (*src_ptr == SERIALIZE_SEPARATOR_CHAR ||
-        *src_ptr == SERIALIZE_ESCAPE_CHAR)
+    entry_ptr = preset_ptr->entries + i;
+    if (entry_ptr->parameter_ptr != NULL)
     {
-      *dest_ptr++ = SERIALIZE_ESCAPE_CHAR;
+      continue;
     }
 
-    *dest_ptr++ = *src_ptr;
+    parameter_ptr = find_parameter_asciizz(instance_ptr, entry_ptr->name_asciizz);
+    if (parameter_ptr == NULL ||
+        parameter_ptr->pending_state == LV2DYNPARAM_PENDING_DISAPPEAR)
+    {
+      continue;
+    }
+
+    if (entry_ptr->source_type != parameter_ptr->type &&
+        !((parameter_ptr->type == LV2DYNPARAM_PARAMETER_TYPE_ENUM ||
+           parameter_ptr->type == LV2DYNPARAM_PARAMETER_TYPE_FILENAME) &&
+          entry_ptr->source_type == LV2DYNPARAM_PARAMETER_TYPE_STRING) &&
+        !(parameter_ptr->type == LV2DYNPARAM_PARAMETER_TYPE_NOTE &&
+          entry_ptr->source_type == LV2DYNPARAM_PARAMETER_TYPE_INT))
+    {
+      continue;
+    }
+
+    parameter_value_change(instance_ptr, parameter_ptr, entry_ptr->source_type, &entry_ptr->source_value);
+    parameter_schedule_ui_value_change(parameter_ptr);
+    apply_resolved_value_changes(instance_ptr);
   }
-  *dest_ptr = 0;
+}
 
-  return buffer;
+struct morph_match
+{
+  struct lv2dynparam_host_parameter * parameter_ptr;
+  struct lv2dynparam_host_preset_entry * entries[2];
+};
+
+static
+int
+morph_match_compare(
+  const void * a,
+  const void * b)
+{
+  uintptr_t parameter_a;
+  uintptr_t parameter_b;
+
+  parameter_a = (uintptr_t)((const struct morph_match *)a)->parameter_ptr;
+  parameter_b = (uintptr_t)((const struct morph_match *)b)->parameter_ptr;
+
+  return parameter_a < parameter_b ? -1 : parameter_a > parameter_b ? 1 : 0;
 }
 
+/* Called from UI thread. Presets are modified on UI thread only, so no lock is needed. */
 static
-void
-dynparam_get_parameter(
+struct lv2dynparam_host_morph *
+morph_build(
   struct lv2dynparam_host_instance * instance_ptr,
-  struct lv2dynparam_host_parameter * parameter_ptr,
-  lv2dynparam_parameter_get_callback callback,
-  void * context)
+  struct lv2dynparam_host_preset * presets[2])
 {
-  struct lv2dynparam_host_group * group_ptr;
-  char * buffer_ptr;
-  size_t buffer_size;
-  char * last_ptr;
-  char separator[2] = {SERIALIZE_SEPARATOR_CHAR, '\0'};
-  char * name;
-  bool success;
-  char value_str[100];
-  const char * value_enum;
-  char * value_buffer;
-  const char * value;
-  char * locale;
+  struct morph_match * lookup;
+  struct morph_match * matches;
+  struct morph_match * match_ptr;
+  struct morph_match key;
+  unsigned int lookup_count;
+  unsigned int matches_count;
+  unsigned int floats_count;
+  unsigned int ints_count;
+  unsigned int switches_count;
+  unsigned int i;
+  unsigned int k;
+  struct lv2dynparam_host_preset_entry * entry_ptr;
+  struct lv2dynparam_host_morph * morph_ptr;
+  char * ptr;
+
+  morph_ptr = NULL;
 
-  buffer_size = SERIALIZE_BUFFER_INITIAL_SIZE;
-  buffer_ptr = malloc(buffer_size);
-  if (buffer_ptr == NULL)
+  lookup = malloc((presets[1]->count + presets[0]->count) * sizeof(struct morph_match));
+  if (lookup == NULL)
   {
-      LOG_ERROR("malloc() failed to allocate %zu bytes", buffer_size);
+    LOG_ERROR("failed to allocate memory for morph lookup");
     goto exit;
   }
 
-  last_ptr = buffer_ptr + buffer_size - 1;
-  *last_ptr = 0;
+  matches = lookup + presets[1]->count;
 
-  name = strdup_escape(parameter_ptr->name);
-  if (name == NULL)
+  /* sorted resolved parameters of the second preset */
+  lookup_count = 0;
+  for (i = 0 ; i < presets[1]->count ; i++)
   {
-    goto free;
+    entry_ptr = presets[1]->entries + i;
+    if (entry_ptr->parameter_ptr != NULL)
+    {
+      lookup[lookup_count].parameter_ptr = entry_ptr->parameter_ptr;
+      lookup[lookup_count].entries[1] = entry_ptr;
+      lookup_count++;
+    }
+  }
+
+  qsort(lookup, lookup_count, sizeof(struct morph_match), morph_match_compare);
+
+  /* parameters resolved in both presets */
+  matches_count = 0;
+  floats_count = 0;
+  ints_count = 0;
+  switches_count = 0;
+  for (i = 0 ; i < presets[0]->count ; i++)
+  {
+    entry_ptr = presets[0]->entries + i;
+    if (entry_ptr->parameter_ptr == NULL)
+    {
+      continue;
+    }
+
+    key.parameter_ptr = entry_ptr->parameter_ptr;
+    match_ptr = bsearch(&key, lookup, lookup_count, sizeof(struct morph_match), morph_match_compare);
+    if (match_ptr == NULL)
+    {
+      continue;
+    }
+
+    switch (entry_ptr->parameter_ptr->type)
+    {
+    case LV2DYNPARAM_PARAMETER_TYPE_FLOAT:
+      floats_count++;
+      break;
+    case LV2DYNPARAM_PARAMETER_TYPE_INT:
+    case LV2DYNPARAM_PARAMETER_TYPE_NOTE:
+      ints_count++;
+      break;
+    case LV2DYNPARAM_PARAMETER_TYPE_ENUM:
+    case LV2DYNPARAM_PARAMETER_TYPE_BOOLEAN:
+      switches_count++;
+      break;
+    default:
+      continue;
+    }
+
+    matches[matches_count].parameter_ptr = entry_ptr->parameter_ptr;
+    matches[matches_count].entries[0] = entry_ptr;
+    matches[matches_count].entries[1] = match_ptr->entries[1];
+    matches_count++;
+  }
+
+  morph_ptr = malloc(
+    sizeof(struct lv2dynparam_host_morph) +
+    (floats_count + ints_count + switches_count) * sizeof(struct lv2dynparam_host_parameter *) +
+    switches_count * 2 * sizeof(union lv2dynparam_host_parameter_value) +
+    ints_count * 3 * sizeof(double) +
+    floats_count * 3 * sizeof(float));
+  if (morph_ptr == NULL)
+  {
+    LOG_ERROR("failed to allocate memory for morph");
+    goto free_lookup;
+  }
+
+  /* pointers first, then values, so all arrays are naturally aligned */
+  ptr = (char *)(morph_ptr + 1);
+
+  morph_ptr->float_parameters = (struct lv2dynparam_host_parameter **)ptr;
+  ptr += floats_count * sizeof(struct lv2dynparam_host_parameter *);
+  morph_ptr->int_parameters = (struct lv2dynparam_host_parameter **)ptr;
+  ptr += ints_count * sizeof(struct lv2dynparam_host_parameter *);
+  morph_ptr->switch_parameters = (struct lv2dynparam_host_parameter **)ptr;
+  ptr += switches_count * sizeof(struct lv2dynparam_host_parameter *);
+
+  for (k = 0 ; k < 2 ; k++)
+  {
+    morph_ptr->switch_values[k] = (union lv2dynparam_host_parameter_value *)ptr;
+    ptr += switches_count * sizeof(union lv2dynparam_host_parameter_value);
+  }
+
+  for (k = 0 ; k < 2 ; k++)
+  {
+    morph_ptr->int_values[k] = (double *)ptr;
+    ptr += ints_count * sizeof(double);
+  }
+
+  morph_ptr->int_results = (double *)ptr;
+  ptr += ints_count * sizeof(double);
+
+  for (k = 0 ; k < 2 ; k++)
+  {
+    morph_ptr->float_values[k] = (float *)ptr;
+    ptr += floats_count * sizeof(float);
+  }
+
+  morph_ptr->float_results = (float *)ptr;
+
+  morph_ptr->floats_count = 0;
+  morph_ptr->ints_count = 0;
+  morph_ptr->switches_count = 0;
+
+  for (i = 0 ; i < matches_count ; i++)
+  {
+    match_ptr = matches + i;
+
+    switch (match_ptr->parameter_ptr->type)
+    {
+    case LV2DYNPARAM_PARAMETER_TYPE_FLOAT:
+      morph_ptr->float_parameters[morph_ptr->floats_count] = match_ptr->parameter_ptr;
+      for (k = 0 ; k < 2 ; k++)
+      {
+        morph_ptr->float_values[k][morph_ptr->floats_count] = match_ptr->entries[k]->value.fpoint;
+      }
+      morph_ptr->floats_count++;
+      break;
+    case LV2DYNPARAM_PARAMETER_TYPE_INT:
+      morph_ptr->int_parameters[morph_ptr->ints_count] = match_ptr->parameter_ptr;
+      for (k = 0 ; k < 2 ; k++)
+      {
+        morph_ptr->int_values[k][morph_ptr->ints_count] = match_ptr->entries[k]->value.integer;
+      }
+      morph_ptr->ints_count++;
+      break;
+    case LV2DYNPARAM_PARAMETER_TYPE_NOTE:
+      morph_ptr->int_parameters[morph_ptr->ints_count] = match_ptr->parameter_ptr;
+      for (k = 0 ; k < 2 ; k++)
+      {
+        morph_ptr->int_values[k][morph_ptr->ints_count] = match_ptr->entries[k]->value.note;
+      }
+      morph_ptr->ints_count++;
+      break;
+    default:
+      morph_ptr->switch_parameters[morph_ptr->switches_count] = match_ptr->parameter_ptr;
+      for (k = 0 ; k < 2 ; k++)
+      {
+        morph_ptr->switch_values[k][morph_ptr->switches_count] = match_ptr->entries[k]->value;
+      }
+      morph_ptr->switches_count++;
+    }
   }
 
-  success = prepend_string(&buffer_ptr, &buffer_size, &last_ptr, name);
-  free(name);
-  if (!success)
+  for (k = 0 ; k < 2 ; k++)
   {
-    goto free;
+    morph_ptr->preset_versions[k] = presets[k]->version;
   }
 
-  for (group_ptr = parameter_ptr->group_ptr;
-       group_ptr != instance_ptr->root_group_ptr;
-       group_ptr = group_ptr->parent_group_ptr)
-  {
-    if (!prepend_string(&buffer_ptr, &buffer_size, &last_ptr, separator))
-    {
-      goto free;
-    }
+  morph_ptr->removal_generation = instance_ptr->removal_generation;
+  morph_ptr->position = -1.0f;
 
-    name = strdup_escape(group_ptr->name);
-    if (name == NULL)
-    {
-      goto free;
-    }
+free_lookup:
+  free(lookup);
 
-    success = prepend_string(&buffer_ptr, &buffer_size, &last_ptr, name);
-    free(name);
-    if (!success)
-    {
-      goto free;
-    }
-  }
+exit:
+  return morph_ptr;
+}
 
-  locale = strdup(setlocale(LC_NUMERIC, NULL));
-  setlocale(LC_NUMERIC, "POSIX");
+/* Called from UI thread, without the lock held. Builds morph for
+ * current state of its presets and replaces the active one. */
+static
+void
+morph_install(
+  struct lv2dynparam_host_instance * instance_ptr)
+{
+  struct lv2dynparam_host_morph * morph_ptr;
+  struct lv2dynparam_host_morph * old_morph_ptr;
+  struct lv2dynparam_host_preset * presets[2];
 
-  value_buffer = NULL;
+  morph_ptr = NULL;
 
-  switch (parameter_ptr->type)
+  if (instance_ptr->morph_active)
   {
-  case LV2DYNPARAM_PARAMETER_TYPE_BOOLEAN:
-    sprintf(value_str, "%c%s", SERIALIZE_TYPE_CHAR_BOOLEAN, parameter_ptr->value.boolean ? "true" : "false");
-    value = value_str;
-    break;
-  case LV2DYNPARAM_PARAMETER_TYPE_FLOAT:
-    sprintf(value_str, "%c%f", SERIALIZE_TYPE_CHAR_FLOAT, parameter_ptr->value.fpoint);
-    value = value_str;
-    break;
-  case LV2DYNPARAM_PARAMETER_TYPE_ENUM:
-    value_enum = parameter_ptr->range.enumeration.values[parameter_ptr->value.enum_selected_index];
+    presets[0] = instance_ptr->presets[instance_ptr->morph_presets[0]];
+    presets[1] = instance_ptr->presets[instance_ptr->morph_presets[1]];
 
-    value_buffer = malloc(strlen(value_enum) + 2);
-    if (value_buffer == NULL)
+    if (presets[0] != NULL && presets[1] != NULL)
     {
-      LOG_ERROR("failed to allocate memory for enum value buffer");
-      setlocale(LC_NUMERIC, locale);
-      free(locale);
-      goto free;
+      morph_ptr = morph_build(instance_ptr, presets);
     }
-
-    value_buffer[0] = SERIALIZE_TYPE_CHAR_STRING;
-    strcpy(value_buffer + 1, value_enum);
-    value = value_buffer;
-    break;
-  case LV2DYNPARAM_PARAMETER_TYPE_INT:
-    sprintf(value_str, "%c%i", SERIALIZE_TYPE_CHAR_INT, parameter_ptr->value.integer);
-    value = value_str;
-    break;
-  default:
-    assert(0);                  /* unknown parameter type, should be ignored in host callback */
-    setlocale(LC_NUMERIC, locale);
-    free(locale);
-    goto free;
-  }
-
-  setlocale(LC_NUMERIC, locale);
-  free(locale);
-
-  LOG_DEBUG("Parameter '%s' with value '%s'", last_ptr, value);
-  callback(context, parameter_ptr->context, last_ptr, value);
-
-  if (value_buffer != NULL)
-  {
-    free(value_buffer);
   }
 
-free:
-  free(buffer_ptr);
+  audiolock_enter_ui(instance_ptr->lock);
+  old_morph_ptr = instance_ptr->morph_ptr;
+  instance_ptr->morph_ptr = morph_ptr;
+  audiolock_leave_ui(instance_ptr->lock);
 
-exit:
-  return;
+  free(old_morph_ptr);
 }
 
+/* Called from UI thread, checks whether presets of the morph were changed or resolved again */
 static
-void
-dynparam_get_group_parameters(
-  struct lv2dynparam_host_instance * instance_ptr,
-  struct lv2dynparam_host_group * group_ptr,
-  lv2dynparam_parameter_get_callback callback,
-  void * context)
+bool
+morph_outdated(
+  struct lv2dynparam_host_instance * instance_ptr)
 {
-  struct list_head * node_ptr;
-  struct lv2dynparam_host_group * child_group_ptr;
-  struct lv2dynparam_host_parameter * parameter_ptr;
-
-  //LOG_DEBUG("Iterating \"%s\" groups begin", group_ptr->name);
+  unsigned int k;
+  struct lv2dynparam_host_preset * preset_ptr;
 
-  list_for_each(node_ptr, &group_ptr->child_groups)
+  if (!instance_ptr->morph_active)
   {
-    child_group_ptr = list_entry(node_ptr, struct lv2dynparam_host_group, siblings);
-
-    //LOG_DEBUG("host notify - group \"%s\"", child_group_ptr->name);
-
-    dynparam_get_group_parameters(instance_ptr, child_group_ptr, callback, context);
+    return false;
   }
 
-  //LOG_DEBUG("Iterating \"%s\" groups end", group_ptr->name);
-  //LOG_DEBUG("Iterating \"%s\" params begin", group_ptr->name);
-
-  list_for_each(node_ptr, &group_ptr->child_params)
+  for (k = 0 ; k < 2 ; k++)
   {
-    parameter_ptr = list_entry(node_ptr, struct lv2dynparam_host_parameter, siblings);
+    preset_ptr = instance_ptr->presets[instance_ptr->morph_presets[k]];
 
-    //LOG_DEBUG("host notify - parameter \"%s\"", parameter_ptr->name);
+    if (instance_ptr->morph_ptr == NULL)
+    {
+      if (preset_ptr == NULL)
+      {
+        return false;
+      }
+
+      continue;
+    }
 
-    dynparam_get_parameter(instance_ptr, parameter_ptr, callback, context);
+    if (preset_ptr == NULL ||
+        preset_ptr->version != instance_ptr->morph_ptr->preset_versions[k])
+    {
+      return true;
+    }
   }
 
-  //LOG_DEBUG("Iterating \"%s\" params end", group_ptr->name);
+  /* both presets present now, morph was not built because one of them was missing */
+  return instance_ptr->morph_ptr == NULL;
 }
 
 static
-struct lv2dynparam_host_parameter *
-find_parameter_asciizz(
+int
+morph_round(
+  double value)
+{
+  return value >= 0.0 ? (int)(value + 0.5) : -(int)(0.5 - value);
+}
+
+/* Called from realtime thread with the lock held */
+static
+void
+morph_evaluate(
   struct lv2dynparam_host_instance * instance_ptr,
-  const char * asciizz)
+  struct lv2dynparam_host_morph * morph_ptr,
+  float position)
 {
-  const char * component;
-  const char * next_component;
-  size_t len;
-  struct lv2dynparam_host_group * group_ptr;
-  struct lv2dynparam_host_group * child_group_ptr;
+  unsigned int i;
+  unsigned int k;
+  const float * a;
+  const float * b;
+  float * results;
+  const double * int_a;
+  const double * int_b;
+  double * int_results;
   struct lv2dynparam_host_parameter * parameter_ptr;
-  struct list_head * node_ptr;
+  union lv2dynparam_host_parameter_value value;
 
-  component = asciizz;
-  group_ptr = instance_ptr->root_group_ptr;
+  /* interpolate whole arrays first, these loops vectorize */
 
-next_component:
-  if (*component == 0)
+  a = morph_ptr->float_values[0];
+  b = morph_ptr->float_values[1];
+  results = morph_ptr->float_results;
+  for (i = 0 ; i < morph_ptr->floats_count ; i++)
   {
-    return NULL;
+    results[i] = a[i] + (b[i] - a[i]) * position;
   }
 
-  len = strlen(component);
-  next_component = component + len + 1;
+  int_a = morph_ptr->int_values[0];
+  int_b = morph_ptr->int_values[1];
+  int_results = morph_ptr->int_results;
+  for (i = 0 ; i < morph_ptr->ints_count ; i++)
+  {
+    int_results[i] = int_a[i] + (int_b[i] - int_a[i]) * (double)position;
+  }
 
-  if (*next_component != 0)
+  /* then push only the values that actually changed */
+
+  for (i = 0 ; i < morph_ptr->floats_count ; i++)
   {
-    /* if this is not last component, we are searching for a group */
+    parameter_ptr = morph_ptr->float_parameters[i];
+    if (parameter_ptr->value.fpoint == morph_ptr->float_results[i] ||
+        parameter_ptr->pending_state == LV2DYNPARAM_PENDING_DISAPPEAR)
+    {
+      continue;
+    }
 
-    list_for_each(node_ptr, &group_ptr->child_groups)
+    value.fpoint = morph_ptr->float_results[i];
+    parameter_value_change(instance_ptr, parameter_ptr, LV2DYNPARAM_PARAMETER_TYPE_FLOAT, &value);
+    parameter_schedule_ui_value_change(parameter_ptr);
+  }
+
+  for (i = 0 ; i < morph_ptr->ints_count ; i++)
+  {
+    parameter_ptr = morph_ptr->int_parameters[i];
+    value.integer = morph_round(morph_ptr->int_results[i]);
+    if ((parameter_ptr->type == LV2DYNPARAM_PARAMETER_TYPE_NOTE ?
+         parameter_ptr->value.note == value.integer :
+         parameter_ptr->value.integer == value.integer) ||
+        parameter_ptr->pending_state == LV2DYNPARAM_PENDING_DISAPPEAR)
     {
-      child_group_ptr = list_entry(node_ptr, struct lv2dynparam_host_group, siblings);
-      if (strcmp(component, child_group_ptr->name) == 0)
-      {
-        group_ptr = child_group_ptr;
-        component += len + 1;
-        goto next_component;
-      }
+      continue;
     }
+
+    /* note parameters convert the interpolated integer in their assign handler */
+    parameter_value_change(instance_ptr, parameter_ptr, LV2DYNPARAM_PARAMETER_TYPE_INT, &value);
+    parameter_schedule_ui_value_change(parameter_ptr);
   }
-  else
+
+  k = position < LV2DYNPARAM_HOST_MORPH_SWITCH_POSITION ? 0 : 1;
+  for (i = 0 ; i < morph_ptr->switches_count ; i++)
   {
-    /* if this is the last component, we are searching for a parameter  */
+    parameter_ptr = morph_ptr->switch_parameters[i];
+    value = morph_ptr->switch_values[k][i];
 
-    list_for_each(node_ptr, &group_ptr->child_params)
+    if (parameter_ptr->pending_state == LV2DYNPARAM_PENDING_DISAPPEAR ||
+        (parameter_ptr->type == LV2DYNPARAM_PARAMETER_TYPE_BOOLEAN ?
+         parameter_ptr->value.boolean == value.boolean :
+         parameter_ptr->value.enum_selected_index == value.enum_selected_index))
     {
-      parameter_ptr = list_entry(node_ptr, struct lv2dynparam_host_parameter, siblings);
-      if (strcmp(component, parameter_ptr->name) == 0)
-      {
-        return parameter_ptr;
-      }
+      continue;
     }
+
+    parameter_value_change(instance_ptr, parameter_ptr, parameter_ptr->type, &value);
+    parameter_schedule_ui_value_change(parameter_ptr);
   }
 
-  return NULL;
+  morph_ptr->position = position;
 }
 
+/* Called from realtime thread with the lock held */
 static
 void
-parameter_value_change(
+realtime_process_message(
   struct lv2dynparam_host_instance * instance_ptr,
-  struct lv2dynparam_host_parameter * parameter_ptr,
-  unsigned int value_type,
-  union lv2dynparam_host_parameter_value * value_ptr)
+  struct lv2dynparam_host_message * message_ptr)
 {
-  unsigned int i;
+  struct lv2dynparam_host_parameter * parameter_ptr;
+  struct lv2dynparam_host_command * command_ptr;
 
-  if (value_ptr != &parameter_ptr->value)
+  switch (message_ptr->message_type)
   {
-    if (parameter_ptr->type == LV2DYNPARAM_PARAMETER_TYPE_ENUM)
-    {
-      if (value_type == LV2DYNPARAM_PARAMETER_TYPE_STRING)
-      {
-        LOG_DEBUG("searching for enum value '%s'", value_ptr->string);
-        for (i = 0 ; i < parameter_ptr->range.enumeration.values_count ; i++)
-        {
-          if (strcmp(parameter_ptr->range.enumeration.values[i], value_ptr->string) == 0)
-          {
-            parameter_ptr->value.enum_selected_index = i;
-            goto push;
-          }
-        }
-      }
-      else
-      {
-        parameter_ptr->value.enum_selected_index = value_ptr->enum_selected_index;
-        goto push;
-      }
+  case LV2DYNPARAM_HOST_MESSAGE_TYPE_PARAMETER_CHANGE:
+    parameter_ptr = message_ptr->context.parameter;
+    parameter_value_change(instance_ptr, parameter_ptr, parameter_ptr->type, &parameter_ptr->value);
+    break;
 
-      LOG_ERROR("Wrong value '%s' for enum parameter '%s'", value_ptr->string, parameter_ptr->name);
-      return;
+  case LV2DYNPARAM_HOST_MESSAGE_TYPE_COMMAND_EXECUTE:
+    command_ptr = message_ptr->context.command;
+    if (command_ptr->pending_state == LV2DYNPARAM_PENDING_DISAPPEAR ||
+        group_removed(command_ptr->group_ptr))
+    {
+      /* plugin removed it after execution was queued, its handle is not valid anymore */
+      LOG_DEBUG("Not executing disappeared command \"%s\"", command_ptr->name);
     }
-
-    switch (parameter_ptr->type)
+    else if (!instance_ptr->callbacks_ptr->command_execute(command_ptr->command_handle))
     {
-    case LV2DYNPARAM_PARAMETER_TYPE_BOOLEAN:
-      parameter_ptr->value.boolean = value_ptr->boolean;
-      break;
-    case LV2DYNPARAM_PARAMETER_TYPE_FLOAT:
-      parameter_ptr->value.fpoint = value_ptr->fpoint;
-      break;
-    case LV2DYNPARAM_PARAMETER_TYPE_INT:
-      parameter_ptr->value.integer = value_ptr->integer;
-      break;
-    case LV2DYNPARAM_PARAMETER_TYPE_ENUM:
-      /* whoa? we should enter the "if type is enum" statement above */
-      assert(0);
-    default:
-      LOG_ERROR("Parameter change for parameter of unknown type %u received", parameter_ptr->type);
-      return;
+      LOG_ERROR("Execution of command \"%s\" failed", command_ptr->name);
     }
-  }
-
-push:
-  switch (parameter_ptr->type)
-  {
-  case LV2DYNPARAM_PARAMETER_TYPE_BOOLEAN:
-    *((unsigned char *)parameter_ptr->value_ptr) = parameter_ptr->value.boolean ? 1 : 0;
-    LOG_DEBUG("\"%s\" changed to \"%s\"", parameter_ptr->name, parameter_ptr->value.boolean ? "TRUE" : "FALSE");
-    break;
-  case LV2DYNPARAM_PARAMETER_TYPE_FLOAT:
-    *((float *)parameter_ptr->value_ptr) = parameter_ptr->value.fpoint;
-    LOG_DEBUG("\"%s\" changed to %f", parameter_ptr->name, parameter_ptr->value.fpoint);
     break;
-  case LV2DYNPARAM_PARAMETER_TYPE_ENUM:
-    *((unsigned int *)parameter_ptr->value_ptr) = parameter_ptr->value.enum_selected_index;
-    LOG_DEBUG("\"%s\" changed to \"%s\" (index %u)", parameter_ptr->name, parameter_ptr->range.enumeration.values[parameter_ptr->value.enum_selected_index], parameter_ptr->value.enum_selected_index);
-    break;
-  case LV2DYNPARAM_PARAMETER_TYPE_INT:
-    *((signed int *)parameter_ptr->value_ptr) = parameter_ptr->value.integer;
-    LOG_DEBUG("\"%s\" changed to %d", parameter_ptr->name, parameter_ptr->value.integer);
+
+  case LV2DYNPARAM_HOST_MESSAGE_TYPE_BATCH:
+    apply_batch(instance_ptr, message_ptr->context.batch);
     break;
+
   default:
-    LOG_ERROR("Parameter change for parameter of unknown type %u received", parameter_ptr->type);
-    return;
+    LOG_ERROR("Message of unknown type %u received", message_ptr->message_type);
   }
 
-  instance_ptr->callbacks_ptr->parameter_change(parameter_ptr->param_handle);
+  list_del(&message_ptr->siblings);
+
+  if (message_ptr->message_type == LV2DYNPARAM_HOST_MESSAGE_TYPE_BATCH)
+  {
+    /* batch memory is not rt-safe, it is freed in lv2dynparam_host_ui_run() */
+    list_add_tail(&message_ptr->siblings, &instance_ptr->realtime_to_ui_queue);
+  }
+  else
+  {
+    rtsafe_memory_pool_deallocate(instance_ptr->messages_pool, message_ptr);
+  }
+
+  apply_resolved_value_changes(instance_ptr);
+}
+
+static
+unsigned int
+elapsed_usecs(
+  const struct timespec * start_ptr)
+{
+  struct timespec now;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+
+  return
+    (now.tv_sec - start_ptr->tv_sec) * 1000000 +
+    (now.tv_nsec - start_ptr->tv_nsec) / 1000;
 }
 
+/* Called from realtime thread with the lock held. Issues queued changes
+ * within the budget, message is the unit of work so batches are not split. */
 static
 void
-free_parameter_pending_value_change(
+realtime_run(
   struct lv2dynparam_host_instance * instance_ptr,
-  struct lv2dynparam_host_parameter_pending_value_change * value_ptr,
-  bool free_data_pointers)
+  unsigned int max_changes,
+  unsigned int max_usecs)
 {
-  rtsafe_memory_deallocate(value_ptr->name_asciizz);
+  struct lv2dynparam_host_message * message_ptr;
+  struct timespec start;
+  unsigned int changes;
+  unsigned int done;
+  bool first;
 
-  if (free_data_pointers)
+  /* parameters may have appeared since last run */
+  apply_resolved_value_changes(instance_ptr);
+
+  if (max_usecs != 0)
   {
-    if (value_ptr->type == LV2DYNPARAM_PARAMETER_TYPE_STRING)
+    clock_gettime(CLOCK_MONOTONIC, &start);
+  }
+
+  done = 0;
+  first = true;
+
+  while (!list_empty(&instance_ptr->ui_to_realtime_queue))
+  {
+    message_ptr = list_entry(instance_ptr->ui_to_realtime_queue.next, struct lv2dynparam_host_message, siblings);
+
+    if (message_ptr->message_type == LV2DYNPARAM_HOST_MESSAGE_TYPE_BATCH)
     {
-      rtsafe_memory_deallocate(value_ptr->data.string);
+      changes = message_ptr->context.batch->count;
+    }
+    else
+    {
+      changes = 1;
     }
+
+    /* always make progress, even if the first message alone exceeds the budget */
+    if (!first &&
+        (done >= max_changes ||
+         changes > max_changes - done ||
+         (max_usecs != 0 && elapsed_usecs(&start) >= max_usecs)))
+    {
+      break;
+    }
+
+    realtime_process_message(instance_ptr, message_ptr);
+
+    assert(instance_ptr->ui_to_realtime_changes >= changes);
+    instance_ptr->ui_to_realtime_changes -= changes;
+    done += changes;
+    first = false;
   }
 
-  rtsafe_memory_pool_deallocate(instance_ptr->pending_parameter_value_changes_pool, value_ptr);
+  /* after messages, so plugin changes made from their callbacks are picked up too */
+  apply_plugin_value_changes(instance_ptr);
 }
 
 #define instance_ptr ((struct lv2dynparam_host_instance *)instance)
@@ -1128,18 +3519,7 @@ lv2dynparam_parameter_change_rt(
   union lv2dynparam_host_parameter_value value)
 {
   parameter_value_change(instance_ptr, parameter_ptr, parameter_ptr->type, &value);
-
-  /* schedule call to dynparam_parameter_value_changed() */
-
-  if (parameter_ptr->pending_state != LV2DYNPARAM_PENDING_NOTHING ||
-      parameter_ptr->pending_value_change)
-  {
-    /* no need to do this if parameter has not yet appeared or is going to disappear or we already scheduled it */
-    return;
-  }
-
-  parameter_ptr->pending_value_change = true;
-  lv2dynparam_host_group_pending_children_count_increment(parameter_ptr->group_ptr);
+  parameter_schedule_ui_value_change(parameter_ptr);
 }
 
 #undef parameter_ptr
@@ -1148,70 +3528,40 @@ void
 lv2dynparam_host_realtime_run(
   lv2dynparam_host_instance instance)
 {
-  struct list_head * node_ptr;
-  struct lv2dynparam_host_message * message_ptr;
-  struct lv2dynparam_host_parameter * parameter_ptr;
-  struct lv2dynparam_host_parameter_pending_value_change * value_ptr;
-
   if (!audiolock_enter_audio(instance_ptr->lock))
   {
     /* we are not lucky enough - ui thread, is accessing the protected data */
     return;
   }
 
-  while (!list_empty(&instance_ptr->ui_to_realtime_queue))
-  {
-    node_ptr = instance_ptr->ui_to_realtime_queue.next;
-    message_ptr = list_entry(node_ptr, struct lv2dynparam_host_message, siblings);
-
-    switch (message_ptr->message_type)
-    {
-    case LV2DYNPARAM_HOST_MESSAGE_TYPE_PARAMETER_CHANGE:
-      parameter_ptr = message_ptr->context.parameter;
-      parameter_value_change(instance_ptr, parameter_ptr, parameter_ptr->type, &parameter_ptr->value);
-      break;
-
-    case LV2DYNPARAM_HOST_MESSAGE_TYPE_UNKNOWN_PARAMETER_CHANGE:
-      value_ptr = message_ptr->context.value_change;
-
-      parameter_ptr = find_parameter_asciizz(instance_ptr, value_ptr->name_asciizz);
-      if (parameter_ptr != NULL)
-      {
-        LOG_DEBUG("Applying pending parameter '%s' value change", parameter_ptr->name);
-
-        parameter_value_change(instance_ptr, parameter_ptr, value_ptr->type, &value_ptr->data);
-
-        parameter_ptr->context_pending_value_change = value_ptr->context;
-        if (value_ptr->context != NULL)
-        {
-          lv2dynparam_host_group_pending_children_count_increment(parameter_ptr->group_ptr);
-        }
+  realtime_run(instance_ptr, UINT_MAX, 0);
 
-        free_parameter_pending_value_change(
-          instance_ptr,
-          value_ptr,
-          parameter_ptr->type == LV2DYNPARAM_PARAMETER_TYPE_ENUM &&
-          value_ptr->type == LV2DYNPARAM_PARAMETER_TYPE_STRING);
-      }
-      else
-      {
-        LOG_DEBUG("Postponing pending parameter value change");
-        /* TODO: nobody is reading these changes, we dont really have test case for this yet */
-        /* It should probably be read in host_callbacks.c lv2dynparam_host_parameter_appear() */
-        list_add_tail(&value_ptr->siblings, &instance_ptr->pending_parameter_value_changes);
-      }
+  audiolock_leave_audio(instance_ptr->lock);
+}
 
-      break;
+bool
+lv2dynparam_host_realtime_run_budget(
+  lv2dynparam_host_instance instance,
+  unsigned int max_changes,
+  unsigned int max_usecs,
+  unsigned int * backlog_ptr)
+{
+  if (!audiolock_enter_audio(instance_ptr->lock))
+  {
+    /* we are not lucky enough - ui thread, is accessing the protected data */
+    return false;
+  }
 
-    default:
-       LOG_ERROR("Message of unknown type %u received", message_ptr->message_type);
-     }
+  realtime_run(instance_ptr, max_changes, max_usecs);
 
-    list_del(node_ptr);
-    rtsafe_memory_pool_deallocate(instance_ptr->messages_pool, message_ptr);
+  if (backlog_ptr != NULL)
+  {
+    *backlog_ptr = instance_ptr->ui_to_realtime_changes;
   }
 
   audiolock_leave_audio(instance_ptr->lock);
+
+  return true;
 }
 
 void
@@ -1231,6 +3581,10 @@ lv2dynparam_host_ui_run(
     assert(instance_ptr->root_group_ptr->pending_state == LV2DYNPARAM_PENDING_NOTHING);
   }
 
+  free_applied_batches(instance_ptr);
+
+  parameters_copy_borrowed(instance_ptr);
+
   //LOG_DEBUG("pending_childern_count is %u", instance_ptr->root_group_ptr->pending_childern_count);
 
   if (instance_ptr->root_group_ptr->pending_childern_count != 0)
@@ -1239,10 +3593,22 @@ lv2dynparam_host_ui_run(
       instance_ptr,
       instance_ptr->root_group_ptr);
 
-    assert(!instance_ptr->ui || instance_ptr->root_group_ptr->pending_childern_count == 0);
+    /* disappeared parameters are kept while value changes that may reference them are queued */
+    assert(!instance_ptr->ui ||
+           instance_ptr->root_group_ptr->pending_childern_count == 0 ||
+           !list_empty(&instance_ptr->ui_to_realtime_queue) ||
+           instance_ptr->plugin_changes != NULL ||
+           !list_empty(&instance_ptr->borrowed_parameters));
   }
 
+  presets_refresh(instance_ptr);
+
   audiolock_leave_ui(instance_ptr->lock);
+
+  if (morph_outdated(instance_ptr))
+  {
+    morph_install(instance_ptr);
+  }
 }
 
 void
@@ -1266,14 +3632,20 @@ lv2dynparam_host_ui_on(
     lv2dynparam_host_notify_group_appeared(
       instance_ptr,
       instance_ptr->root_group_ptr);
+    instance_ptr->root_group_ptr->ui_appeared = true;
     instance_ptr->root_group_ptr->pending_state = LV2DYNPARAM_PENDING_NOTHING;
 
+    parameters_copy_borrowed(instance_ptr);
+
     lv2dynparam_host_notify(
       instance_ptr,
       instance_ptr->root_group_ptr);
 
     LOG_DEBUG("pending_childern_count is %u", instance_ptr->root_group_ptr->pending_childern_count);
-    assert(instance_ptr->root_group_ptr->pending_childern_count == 0);
+    assert(instance_ptr->root_group_ptr->pending_childern_count == 0 ||
+           !list_empty(&instance_ptr->ui_to_realtime_queue) ||
+           instance_ptr->plugin_changes != NULL ||
+           !list_empty(&instance_ptr->borrowed_parameters));
   }
 
   audiolock_leave_ui(instance_ptr->lock);
@@ -1323,27 +3695,10 @@ lv2dynparam_parameter_change(
 
   audiolock_enter_ui(instance_ptr->lock);
 
-  switch (parameter_ptr->type)
+  LOG_DEBUG("\"%s\" changed by UI", parameter_ptr->name);
+
+  if (!parameter_ptr->type_ops->assign(parameter_ptr, parameter_ptr->type, &value))
   {
-  case LV2DYNPARAM_PARAMETER_TYPE_BOOLEAN:
-    LOG_DEBUG("\"%s\" changed to \"%s\"", parameter_ptr->name, value.boolean ? "TRUE" : "FALSE");
-    parameter_ptr->value.boolean = value.boolean;
-    break;
-  case LV2DYNPARAM_PARAMETER_TYPE_FLOAT:
-    LOG_DEBUG("\"%s\" changed to %f", parameter_ptr->name, value.fpoint);
-    parameter_ptr->value.fpoint = value.fpoint;
-    break;
-  case LV2DYNPARAM_PARAMETER_TYPE_ENUM:
-    LOG_DEBUG("\"%s\" changed to \"%s\" (index %u)", parameter_ptr->name, parameter_ptr->range.enumeration.values[value.enum_selected_index], value.enum_selected_index);
-    parameter_ptr->value.enum_selected_index = value.enum_selected_index;
-    break;
-  case LV2DYNPARAM_PARAMETER_TYPE_INT:
-    LOG_DEBUG("\"%s\" changed to %d", parameter_ptr->name, value.integer);
-    parameter_ptr->value.integer = value.integer;
-    break;
-  default:
-    LOG_ERROR("unknown parameter type");
-    assert(0);
     goto unlock;
   }
 
@@ -1351,25 +3706,177 @@ lv2dynparam_parameter_change(
   message_ptr->message_type = LV2DYNPARAM_HOST_MESSAGE_TYPE_PARAMETER_CHANGE;
   message_ptr->context.parameter = parameter_ptr;
   list_add_tail(&message_ptr->siblings, &instance_ptr->ui_to_realtime_queue);
+  instance_ptr->ui_to_realtime_changes++;
+
+unlock:
+  audiolock_leave_ui(instance_ptr->lock);
+}
+
+#define command_ptr ((struct lv2dynparam_host_command *)command_handle)
+
+void
+lv2dynparam_command_execute(
+  lv2dynparam_host_instance instance,
+  lv2dynparam_host_command command_handle)
+{
+  struct lv2dynparam_host_message * message_ptr;
+
+  audiolock_enter_ui(instance_ptr->lock);
+
+  if (command_ptr->pending_state == LV2DYNPARAM_PENDING_DISAPPEAR)
+  {
+    LOG_DEBUG("Not executing disappearing command \"%s\"", command_ptr->name);
+    goto unlock;
+  }
+
+  LOG_DEBUG("Executing command \"%s\"", command_ptr->name);
+
+  /* executed by lv2dynparam_host_realtime_run(), before plugin value changes are collected */
+  message_ptr = rtsafe_memory_pool_allocate_sleepy(instance_ptr->messages_pool);
+  message_ptr->message_type = LV2DYNPARAM_HOST_MESSAGE_TYPE_COMMAND_EXECUTE;
+  message_ptr->context.command = command_ptr;
+  list_add_tail(&message_ptr->siblings, &instance_ptr->ui_to_realtime_queue);
+  instance_ptr->ui_to_realtime_changes++;
 
 unlock:
   audiolock_leave_ui(instance_ptr->lock);
 }
 
+#undef command_ptr
+
 void
 lv2dynparam_get_parameters(
   lv2dynparam_host_instance instance,
   lv2dynparam_parameter_get_callback callback,
   void * context)
 {
+  struct parameters_iterator iterator;
+
+  iterator.values = NULL;
+  iterator.capacity = 0;
+  iterator.count = 0;
+  iterator.since = false;
+
+  if (!parameters_iterator_run(instance_ptr, &iterator))
+  {
+    goto free;
+  }
+
+  parameters_iterator_deliver(instance_ptr, &iterator, callback, context);
+
+free:
+  parameters_iterator_clear(&iterator);
+  free(iterator.values);
+}
+
+unsigned int
+lv2dynparam_get_parameters_since(
+  lv2dynparam_host_instance instance,
+  unsigned int generation,
+  lv2dynparam_parameter_get_callback callback,
+  void * context)
+{
+  struct parameters_iterator iterator;
+
+  iterator.values = NULL;
+  iterator.capacity = 0;
+  iterator.count = 0;
+  iterator.since = generation != 0; /* 0 means all parameters */
+  iterator.since_generation = generation;
+
+  if (!parameters_iterator_run(instance_ptr, &iterator))
+  {
+    /* nothing was delivered, next call should cover same changes */
+    parameters_iterator_clear(&iterator);
+    free(iterator.values);
+    return generation;
+  }
+
+  parameters_iterator_deliver(instance_ptr, &iterator, callback, context);
+
+  parameters_iterator_clear(&iterator);
+  free(iterator.values);
+
+  return iterator.values_generation;
+}
+
+struct lv2dynparam_host_snapshot *
+lv2dynparam_host_snapshot(
+  lv2dynparam_host_instance instance,
+  void * buffer,
+  size_t * size_ptr)
+{
+  struct snapshot_writer writer;
+  struct lv2dynparam_host_snapshot * snapshot_ptr;
+  locale_t locale;
+
   audiolock_enter_ui(instance_ptr->lock);
 
+  writer.used = sizeof(struct lv2dynparam_host_snapshot) +
+    instance_ptr->parameters_count * sizeof(struct lv2dynparam_host_snapshot_entry);
+  writer.index = 0;
+  writer.overflow = false;
+  writer.failed = false;
+
+  if (buffer != NULL)
+  {
+    writer.buffer = buffer;
+    writer.buffer_size = *size_ptr;
+    writer.grow = false;
+    writer.overflow = writer.used > writer.buffer_size;
+  }
+  else
+  {
+    writer.buffer_size = writer.used + instance_ptr->parameters_count * SNAPSHOT_ENTRY_STRINGS_SIZE_GUESS;
+    writer.buffer = malloc(writer.buffer_size);
+    writer.grow = true;
+    if (writer.buffer == NULL)
+    {
+      LOG_ERROR("failed to allocate %zu bytes for snapshot", writer.buffer_size);
+      audiolock_leave_ui(instance_ptr->lock);
+      return NULL;
+    }
+  }
+
   if (instance_ptr->root_group_ptr != NULL)
   {
-    dynparam_get_group_parameters(instance_ptr, instance_ptr->root_group_ptr, callback, context);
+    locale = numeric_locale_enter();
+    snapshot_group(instance_ptr->root_group_ptr, &writer);
+    numeric_locale_leave(locale);
   }
 
+  assert(writer.failed || writer.index <= instance_ptr->parameters_count);
+
   audiolock_leave_ui(instance_ptr->lock);
+
+  if (writer.failed)
+  {
+    goto fail;
+  }
+
+  if (size_ptr != NULL)
+  {
+    *size_ptr = writer.used;
+  }
+
+  if (writer.overflow)
+  {
+    return NULL;
+  }
+
+  snapshot_ptr = (struct lv2dynparam_host_snapshot *)writer.buffer;
+  snapshot_ptr->size = writer.used;
+  snapshot_ptr->count = writer.index;
+
+  return snapshot_ptr;
+
+fail:
+  if (writer.grow)
+  {
+    free(writer.buffer);
+  }
+
+  return NULL;
 }
 
 char *
@@ -1459,8 +3966,9 @@ set_parameter(
   const char * parameter_value,
   union lv2dynparam_host_parameter_value * value_ptr)
 {
-  char * locale;
+  locale_t locale;
   char typechar;
+  signed int note;
   unsigned int type;
 
   typechar = *parameter_value;
@@ -1480,13 +3988,15 @@ set_parameter(
   case SERIALIZE_TYPE_CHAR_INT:
     type = LV2DYNPARAM_PARAMETER_TYPE_INT;
     break;
+  case SERIALIZE_TYPE_CHAR_NOTE:
+    type = LV2DYNPARAM_PARAMETER_TYPE_NOTE;
+    break;
   default:
     LOG_ERROR("Unknown parameter type char '%c'", typechar);
     return LV2DYNPARAM_PARAMETER_TYPE_UNKNOWN;
   }
 
-  locale = strdup(setlocale(LC_NUMERIC, NULL));
-  setlocale(LC_NUMERIC, "POSIX");
+  locale = numeric_locale_enter();
 
   switch (type)
   {
@@ -1506,7 +4016,7 @@ set_parameter(
     }
     break;
   case LV2DYNPARAM_PARAMETER_TYPE_FLOAT:
-    if (sscanf(parameter_value, "%f", &value_ptr->fpoint) != 1)
+    if (!parse_float(parameter_value, &value_ptr->fpoint))
     {
       LOG_ERROR("failed to convert value '%s' of parameter '%s' to float", parameter_value, parameter_name);
       type = LV2DYNPARAM_PARAMETER_TYPE_UNKNOWN;
@@ -1523,23 +4033,89 @@ set_parameter(
     }
     break;
   case LV2DYNPARAM_PARAMETER_TYPE_INT:
-    if (sscanf(parameter_value, "%i", &value_ptr->integer) != 1)
+    if (!parse_int(parameter_value, &value_ptr->integer))
     {
       LOG_ERROR("failed to convert value '%s' of parameter '%s' to signed int", parameter_value, parameter_name);
       type = LV2DYNPARAM_PARAMETER_TYPE_UNKNOWN;
     }
     break;
+  case LV2DYNPARAM_PARAMETER_TYPE_NOTE:
+    if (!parse_int(parameter_value, &note) || note < 0 || note > 127)
+    {
+      LOG_ERROR("failed to convert value '%s' of parameter '%s' to note", parameter_value, parameter_name);
+      type = LV2DYNPARAM_PARAMETER_TYPE_UNKNOWN;
+      break;
+    }
+
+    value_ptr->note = note;
+    break;
   default:
     LOG_ERROR("Parameter change for parameter of unknown type %u received", type);
     type = LV2DYNPARAM_PARAMETER_TYPE_UNKNOWN;
   }
 
-  setlocale(LC_NUMERIC, locale);
-  free(locale);
+  numeric_locale_leave(locale);
 
   return type;
 }
 
+bool
+lv2dynparam_set_parameters(
+  lv2dynparam_host_instance instance,
+  const struct lv2dynparam_parameter_record * records,
+  unsigned int count)
+{
+  struct lv2dynparam_host_batch * batch_ptr;
+  unsigned int i;
+  char * name_asciizz;
+  unsigned int type;
+  union lv2dynparam_host_parameter_value value;
+
+  batch_ptr = lv2dynparam_host_batch_create(instance_ptr, count);
+  if (batch_ptr == NULL)
+  {
+    return false;
+  }
+
+  /* values are parsed without holding the lock, paths are resolved on submit */
+  for (i = 0 ; i < count ; i++)
+  {
+    name_asciizz = string_unescape(instance, records[i].name);
+    if (name_asciizz == NULL)
+    {
+      goto fail;
+    }
+
+    type = set_parameter(instance, records[i].name, records[i].value, &value);
+    if (type == LV2DYNPARAM_PARAMETER_TYPE_UNKNOWN)
+    {
+      rtsafe_memory_deallocate(name_asciizz);
+      continue;
+    }
+
+    LOG_DEBUG("Pending parameter '%s' value change to '%s' (%c)", records[i].name, records[i].value + 1, *records[i].value);
+
+    if (!lv2dynparam_host_batch_add(instance_ptr, batch_ptr, name_asciizz, type, &value, records[i].context))
+    {
+      if (type == LV2DYNPARAM_PARAMETER_TYPE_STRING)
+      {
+        rtsafe_memory_deallocate(value.string);
+      }
+
+      rtsafe_memory_deallocate(name_asciizz);
+      goto fail;
+    }
+  }
+
+  lv2dynparam_host_batch_submit(instance_ptr, batch_ptr);
+
+  return true;
+
+fail:
+  lv2dynparam_host_batch_free(instance_ptr, batch_ptr);
+  return false;
+}
+
 void
 lv2dynparam_set_parameter(
   lv2dynparam_host_instance instance,
@@ -1547,57 +4123,220 @@ lv2dynparam_set_parameter(
   const char * parameter_value,
   void * context)
 {
-  char * parameter_name_asciizz;
-  struct lv2dynparam_host_message * message_ptr;
-  struct lv2dynparam_host_parameter_pending_value_change * value_ptr;
+  struct lv2dynparam_parameter_record record;
+
+  record.name = parameter_name;
+  record.value = parameter_value;
+  record.context = context;
+
+  lv2dynparam_set_parameters(instance, &record, 1);
+}
+
+bool
+lv2dynparam_host_preset_store(
+  lv2dynparam_host_instance instance,
+  unsigned int index,
+  const struct lv2dynparam_parameter_record * records,
+  unsigned int count)
+{
+  struct lv2dynparam_host_preset * preset_ptr;
+  struct lv2dynparam_host_preset * old_preset_ptr;
+  struct lv2dynparam_host_preset_entry * entry_ptr;
+  unsigned int i;
+  char * name_asciizz;
+  unsigned int type;
+  union lv2dynparam_host_parameter_value value;
 
-  parameter_name_asciizz = string_unescape(instance, parameter_name);
-  if (parameter_name_asciizz == NULL)
+  if (index >= LV2DYNPARAM_HOST_PRESETS_COUNT)
   {
-    goto exit;
+    LOG_ERROR("Invalid preset index %u", index);
+    return false;
   }
 
-  audiolock_enter_ui(instance_ptr->lock);
+  preset_ptr = malloc(sizeof(struct lv2dynparam_host_preset) + count * sizeof(struct lv2dynparam_host_preset_entry));
+  if (preset_ptr == NULL)
+  {
+    LOG_ERROR("failed to allocate memory for preset of %u values", count);
+    return false;
+  }
 
-  message_ptr = rtsafe_memory_pool_allocate_sleepy(instance_ptr->messages_pool);
-  if (message_ptr == NULL)
+  preset_ptr->count = 0;
+
+  for (i = 0 ; i < count ; i++)
   {
-    LOG_ERROR("failed to allocate memory for host message");
-    goto free_name;
+    name_asciizz = string_unescape(instance, records[i].name);
+    if (name_asciizz == NULL)
+    {
+      preset_free(preset_ptr);
+      return false;
+    }
+
+    type = set_parameter(instance, records[i].name, records[i].value, &value);
+    if (type == LV2DYNPARAM_PARAMETER_TYPE_UNKNOWN)
+    {
+      rtsafe_memory_deallocate(name_asciizz);
+      continue;
+    }
+
+    entry_ptr = preset_ptr->entries + preset_ptr->count;
+    entry_ptr->name_asciizz = name_asciizz;
+    entry_ptr->source_type = type;
+    entry_ptr->source_value = value;
+    preset_ptr->count++;
   }
 
-  message_ptr = rtsafe_memory_pool_allocate_sleepy(instance_ptr->messages_pool);
-  message_ptr->message_type = LV2DYNPARAM_HOST_MESSAGE_TYPE_UNKNOWN_PARAMETER_CHANGE;
+  audiolock_enter_ui(instance_ptr->lock);
+  preset_resolve(instance_ptr, preset_ptr);
+  old_preset_ptr = instance_ptr->presets[index];
+  instance_ptr->presets[index] = preset_ptr;
+  audiolock_leave_ui(instance_ptr->lock);
 
-  value_ptr = rtsafe_memory_pool_allocate_sleepy(instance_ptr->pending_parameter_value_changes_pool);
-  if (value_ptr == NULL)
+  if (morph_outdated(instance_ptr))
   {
-    LOG_ERROR("failed to allocate memory for pending parameter value change");
-    goto free_message;
+    morph_install(instance_ptr);
   }
 
-  message_ptr->context.value_change = value_ptr;
-  value_ptr->type = set_parameter(instance, parameter_name, parameter_value, &value_ptr->data);
-  if (value_ptr->type != LV2DYNPARAM_PARAMETER_TYPE_UNKNOWN)
+  if (old_preset_ptr != NULL)
   {
-    LOG_DEBUG("Pending parameter '%s' value change to '%s' (%c)", parameter_name, parameter_value + 1, *parameter_value);
-    value_ptr->name_asciizz = parameter_name_asciizz;
-    value_ptr->context = context;
-    list_add_tail(&message_ptr->siblings, &instance_ptr->ui_to_realtime_queue);
-    goto unlock;
+    preset_free(old_preset_ptr);
   }
 
-  rtsafe_memory_pool_deallocate(instance_ptr->pending_parameter_value_changes_pool, value_ptr);
+  return true;
+}
 
-free_message:
-  rtsafe_memory_pool_deallocate(instance_ptr->messages_pool, message_ptr);
+void
+lv2dynparam_host_preset_remove(
+  lv2dynparam_host_instance instance,
+  unsigned int index)
+{
+  struct lv2dynparam_host_preset * preset_ptr;
 
-free_name:
-  rtsafe_memory_deallocate(parameter_name_asciizz);
+  if (index >= LV2DYNPARAM_HOST_PRESETS_COUNT)
+  {
+    LOG_ERROR("Invalid preset index %u", index);
+    return;
+  }
 
-unlock:
+  audiolock_enter_ui(instance_ptr->lock);
+  preset_ptr = instance_ptr->presets[index];
+  instance_ptr->presets[index] = NULL;
   audiolock_leave_ui(instance_ptr->lock);
 
-exit:
-  return;
+  if (morph_outdated(instance_ptr))
+  {
+    morph_install(instance_ptr);
+  }
+
+  if (preset_ptr != NULL)
+  {
+    preset_free(preset_ptr);
+  }
+}
+
+bool
+lv2dynparam_host_preset_apply(
+  lv2dynparam_host_instance instance,
+  unsigned int index)
+{
+  struct lv2dynparam_host_preset * preset_ptr;
+
+  if (index >= LV2DYNPARAM_HOST_PRESETS_COUNT)
+  {
+    return false;
+  }
+
+  if (!audiolock_enter_audio(instance_ptr->lock))
+  {
+    /* ui thread is accessing the protected data */
+    return false;
+  }
+
+  preset_ptr = instance_ptr->presets[index];
+  if (preset_ptr == NULL ||
+      preset_ptr->removal_generation != instance_ptr->removal_generation)
+  {
+    audiolock_leave_audio(instance_ptr->lock);
+    return false;
+  }
+
+  preset_apply(instance_ptr, preset_ptr);
+
+  audiolock_leave_audio(instance_ptr->lock);
+
+  return true;
+}
+
+bool
+lv2dynparam_host_morph_set(
+  lv2dynparam_host_instance instance,
+  unsigned int preset_a,
+  unsigned int preset_b)
+{
+  if (preset_a >= LV2DYNPARAM_HOST_PRESETS_COUNT ||
+      preset_b >= LV2DYNPARAM_HOST_PRESETS_COUNT)
+  {
+    LOG_ERROR("Invalid preset index for morph");
+    return false;
+  }
+
+  instance_ptr->morph_active = true;
+  instance_ptr->morph_presets[0] = preset_a;
+  instance_ptr->morph_presets[1] = preset_b;
+
+  morph_install(instance_ptr);
+
+  return instance_ptr->morph_ptr != NULL;
+}
+
+void
+lv2dynparam_host_morph_clear(
+  lv2dynparam_host_instance instance)
+{
+  instance_ptr->morph_active = false;
+  morph_install(instance_ptr);
+}
+
+bool
+lv2dynparam_host_morph_run(
+  lv2dynparam_host_instance instance,
+  float position)
+{
+  struct lv2dynparam_host_morph * morph_ptr;
+
+  if (!isfinite(position))
+  {
+    return false;
+  }
+
+  if (position < 0.0f)
+  {
+    position = 0.0f;
+  }
+  else if (position > 1.0f)
+  {
+    position = 1.0f;
+  }
+
+  if (!audiolock_enter_audio(instance_ptr->lock))
+  {
+    /* ui thread is accessing the protected data */
+    return false;
+  }
+
+  morph_ptr = instance_ptr->morph_ptr;
+  if (morph_ptr == NULL ||
+      morph_ptr->removal_generation != instance_ptr->removal_generation)
+  {
+    audiolock_leave_audio(instance_ptr->lock);
+    return false;
+  }
+
+  if (morph_ptr->position != position)
+  {
+    morph_evaluate(instance_ptr, morph_ptr, position);
+  }
+
+  audiolock_leave_audio(instance_ptr->lock);
+
+  return true;
 }
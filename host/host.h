@@ -54,6 +54,7 @@ union lv2dynparam_host_parameter_value
   bool boolean;
   float fpoint;
   signed int integer;
+  unsigned char note;           /* MIDI note number */
   unsigned int enum_selected_index;
   char * string;
 };
@@ -71,10 +72,19 @@ union lv2dynparam_host_parameter_range
     signed int max;
   } integer;
   struct
+  {
+    unsigned char min;
+    unsigned char max;
+  } note;
+  struct
   {
     char ** values;
     unsigned int values_count;
   } enumeration;
+  struct
+  {
+    unsigned int size;          /* maximum size of value, including the terminating zero */
+  } string;
 };
 
 /**
@@ -169,6 +179,34 @@ void
 lv2dynparam_host_realtime_run(
   lv2dynparam_host_instance instance);
 
+/**
+ * Call this function instead of lv2dynparam_host_realtime_run() to
+ * limit the work done in one audio cycle. Queued changes are issued
+ * until max_changes of them are done or max_usecs microseconds
+ * elapsed, the rest is left for next calls. Batch counts as number
+ * of its value changes and it is never split, so plugin does not see
+ * half applied batch. The first queued change is always issued, even
+ * when it alone exceeds the budget.
+ * Must be called from from audio/midi realtime thread.
+ * This function will not sleep/lock.
+ *
+ * @param instance Handle to instance received from lv2dynparam_host_attach()
+ * @param max_changes Maximum number of changes to issue
+ * @param max_usecs Time budget in microseconds, zero for no time limit
+ * @param backlog_ptr Pointer to variable receiving number of changes
+ * left queued. Can be NULL.
+ *
+ * @return Success status
+ * @retval true - success
+ * @retval false - UI thread holds the lock, nothing was done, try in next cycle
+ */
+bool
+lv2dynparam_host_realtime_run_budget(
+  lv2dynparam_host_instance instance,
+  unsigned int max_changes,
+  unsigned int max_usecs,
+  unsigned int * backlog_ptr);
+
 /**
  * Call this function to issue pending calls to UI.
  * Must be called from the UI thread.
@@ -346,6 +384,21 @@ lv2dynparam_parameter_change(
   lv2dynparam_host_parameter parameter_handle,
   union lv2dynparam_host_parameter_value value);
 
+/**
+ * Call this function to execute command.
+ * The command is executed by plugin during next lv2dynparam_host_realtime_run() call,
+ * in order with parameter value changes made before.
+ * Must be called from the UI thread.
+ * This function may sleep/lock.
+ *
+ * @param instance Handle to instance received from lv2dynparam_host_attach()
+ * @param command_handle handle of command to execute, as supplied to dynparam_ui_command_appeared()
+ */
+void
+lv2dynparam_command_execute(
+  lv2dynparam_host_instance instance,
+  lv2dynparam_host_command command_handle);
+
 /**
  * Callback called from UI thread to notify host about parameter value change.
  *
@@ -374,6 +427,9 @@ void
 
 /**
  * Call this funtion to get parameters of plugin, as pairs of parameter name and value strings.
+ * Values are collected in small chunks, so the realtime thread is not blocked for long,
+ * and form a consistent state. Callback is called without internal lock held,
+ * it must not call lv2dynparam_host_ui_run().
  * Must be called from the UI thread.
  * This function may sleep/lock.
  *
@@ -387,6 +443,341 @@ lv2dynparam_get_parameters(
   lv2dynparam_parameter_get_callback callback,
   void * context);
 
+/**
+ * Call this funtion to get parameters of plugin that changed since some previous state,
+ * as pairs of parameter name and value strings. Parameters that appeared meanwhile are
+ * considered changed too. Same as lv2dynparam_get_parameters() otherwise.
+ * Must be called from the UI thread.
+ * This function may sleep/lock.
+ *
+ * @param instance Handle to instance received from lv2dynparam_host_attach()
+ * @param generation Generation of the previous state, as returned by previous call.
+ * Use 0 for the initial call, to get all parameters.
+ * @param callback Callback to be called for each changed parameter
+ * @param context User context to be supplied as parameter when callback is called
+ * @return Generation of the state supplied to callback, to be used in next call
+ */
+unsigned int
+lv2dynparam_get_parameters_since(
+  lv2dynparam_host_instance instance,
+  unsigned int generation,
+  lv2dynparam_parameter_get_callback callback,
+  void * context);
+
+/** Entry of parameters snapshot. Offsets are relative to start of the snapshot. */
+struct lv2dynparam_host_snapshot_entry
+{
+  unsigned int path_offset;     /**< offset of parameter name string */
+  unsigned int value_offset;    /**< offset of parameter value string */
+};
+
+/**
+ * Snapshot of parameter values, as produced by lv2dynparam_host_snapshot().
+ * The table of entries is followed by the packed, zero terminated, strings.
+ * Snapshot contains no pointers, so it can be copied around as a single block.
+ */
+struct lv2dynparam_host_snapshot
+{
+  unsigned int size;            /**< size of whole snapshot, in bytes */
+  unsigned int count;           /**< number of entries */
+  struct lv2dynparam_host_snapshot_entry entries[];
+};
+
+/** Get name of parameter at @c index, same as name supplied to lv2dynparam_parameter_get_callback */
+#define LV2DYNPARAM_HOST_SNAPSHOT_PATH(snapshot_ptr, index) \
+  ((const char *)(snapshot_ptr) + (snapshot_ptr)->entries[index].path_offset)
+
+/** Get value of parameter at @c index, same as value supplied to lv2dynparam_parameter_get_callback */
+#define LV2DYNPARAM_HOST_SNAPSHOT_VALUE(snapshot_ptr, index) \
+  ((const char *)(snapshot_ptr) + (snapshot_ptr)->entries[index].value_offset)
+
+/**
+ * Call this function to get parameters of plugin in single contiguous buffer.
+ * Name and value strings are same as ones lv2dynparam_get_parameters() supplies to its callback.
+ * Must be called from the UI thread.
+ * This function may sleep/lock.
+ *
+ * @param instance Handle to instance received from lv2dynparam_host_attach()
+ * @param buffer Buffer to write snapshot to, suitably aligned for struct lv2dynparam_host_snapshot.
+ * If NULL, snapshot is allocated by the library and must be released with free().
+ * @param size_ptr When buffer is supplied, points to its size on input.
+ * On output receives size of the snapshot, or size needed when supplied buffer is too small.
+ * Can be NULL when buffer is NULL.
+ * @return Pointer to the snapshot, NULL on failure or when supplied buffer is too small
+ */
+struct lv2dynparam_host_snapshot *
+lv2dynparam_host_snapshot(
+  lv2dynparam_host_instance instance,
+  void * buffer,
+  size_t * size_ptr);
+
+/**
+ * Call this function to save values of plugin parameters in binary form.
+ * The state is versioned and is meant to be restored by the same or newer
+ * version of the library, on machine with same byte order.
+ * Must be called from the UI thread.
+ * This function may sleep/lock.
+ *
+ * @param instance Handle to instance received from lv2dynparam_host_attach()
+ * @param buffer_ptr Pointer to variable receiving the state, to be released with free()
+ * @param size_ptr Pointer to variable receiving size of the state, in bytes
+ * @return Success status
+ */
+bool
+lv2dynparam_host_state_save(
+  lv2dynparam_host_instance instance,
+  void ** buffer_ptr,
+  size_t * size_ptr);
+
+/**
+ * Call this function to restore values of plugin parameters from state
+ * previously saved with lv2dynparam_host_state_save(). Values of parameters
+ * that have not appeared yet are applied when they appear,
+ * same as with lv2dynparam_set_parameter().
+ * Must be called from the UI thread.
+ * This function may sleep/lock.
+ *
+ * @param instance Handle to instance received from lv2dynparam_host_attach()
+ * @param buffer The state, 4 bytes aligned. Not referenced after the call.
+ * @param size Size of the state buffer, in bytes
+ * @return Success status, false if state is corrupted or of unsupported version
+ */
+bool
+lv2dynparam_host_state_restore(
+  lv2dynparam_host_instance instance,
+  const void * buffer,
+  size_t size);
+
+/**
+ * Call this function to save values of plugin parameters to file.
+ * Same as lv2dynparam_host_state_save() but writes the state to file.
+ * Must be called from the UI thread.
+ * This function may sleep/lock.
+ *
+ * @param instance Handle to instance received from lv2dynparam_host_attach()
+ * @param filename Name of file to write, existing file is overwritten
+ * @return Success status
+ */
+bool
+lv2dynparam_host_state_save_file(
+  lv2dynparam_host_instance instance,
+  const char * filename);
+
+/**
+ * Call this function to restore values of plugin parameters from file.
+ * The file is mapped in memory and restored with lv2dynparam_host_state_restore().
+ * Must be called from the UI thread.
+ * This function may sleep/lock.
+ *
+ * @param instance Handle to instance received from lv2dynparam_host_attach()
+ * @param filename Name of file previously written by lv2dynparam_host_state_save_file()
+ * @return Success status
+ */
+bool
+lv2dynparam_host_state_load_file(
+  lv2dynparam_host_instance instance,
+  const char * filename);
+
+/** Parameter name and value pair, as used by lv2dynparam_set_parameters() */
+struct lv2dynparam_parameter_record
+{
+  const char * name;            /**< Parameter name, as supplied to lv2dynparam_parameter_get_callback */
+  const char * value;           /**< Parameter value, as string */
+  void * context;               /**< Value change context, see lv2dynparam_parameter_value_change_context */
+};
+
+/**
+ * Call this function to set many parameters of plugin at once.
+ * Values are parsed and parameters are looked up on the calling thread,
+ * then all changes are handed to the realtime thread as single unit
+ * and applied, in order, in same lv2dynparam_host_realtime_run() call.
+ * Records with malformed values are skipped.
+ * Must be called from the UI thread.
+ * This function may sleep/lock.
+ *
+ * @param instance Handle to instance received from lv2dynparam_host_attach()
+ * @param records Array of parameter records
+ * @param count Number of records in the array
+ * @return Success status, false if memory allocation failed and no value was set
+ */
+bool
+lv2dynparam_set_parameters(
+  lv2dynparam_host_instance instance,
+  const struct lv2dynparam_parameter_record * records,
+  unsigned int count);
+
+/**
+ * Call this function to store preset in the preset cache.
+ * Values are parsed and parameters are looked up once, here, so applying
+ * the preset with lv2dynparam_host_preset_apply() does no parsing or allocation.
+ * Preset previously stored at same index is replaced.
+ * Records with malformed values are skipped, record contexts are ignored.
+ * Must be called from the UI thread.
+ * This function may sleep/lock.
+ *
+ * @param instance Handle to instance received from lv2dynparam_host_attach()
+ * @param index Index of preset cache slot, less than 128
+ * @param records Array of parameter records
+ * @param count Number of records in the array
+ * @return Success status
+ */
+bool
+lv2dynparam_host_preset_store(
+  lv2dynparam_host_instance instance,
+  unsigned int index,
+  const struct lv2dynparam_parameter_record * records,
+  unsigned int count);
+
+/**
+ * Call this function to remove preset from the preset cache.
+ * Must be called from the UI thread.
+ * This function may sleep/lock.
+ *
+ * @param instance Handle to instance received from lv2dynparam_host_attach()
+ * @param index Index of preset cache slot
+ */
+void
+lv2dynparam_host_preset_remove(
+  lv2dynparam_host_instance instance,
+  unsigned int index);
+
+/**
+ * Call this function to apply preset stored in the preset cache.
+ * Values are applied immediately, value changes queued from the UI thread
+ * are applied after them, by lv2dynparam_host_realtime_run().
+ * Values of parameters that have not appeared are skipped, unless they
+ * appear while the preset is being applied.
+ * Must be called from from audio/midi realtime thread.
+ * This function will not sleep/lock.
+ *
+ * @param instance Handle to instance received from lv2dynparam_host_attach()
+ * @param index Index of preset cache slot
+ * @return Whether preset was applied, false if slot is empty or UI thread
+ * is accessing the cache at the moment, in which case call can be retried.
+ */
+bool
+lv2dynparam_host_preset_apply(
+  lv2dynparam_host_instance instance,
+  unsigned int index);
+
+/**
+ * Call this function to setup morphing between two presets in the preset cache.
+ * Float and integer parameters present in both presets are interpolated linearly,
+ * enum and boolean parameters switch from first to second preset at position 0.5.
+ * Parameters present in only one of the presets are not touched.
+ * Morph is rebuilt automatically when either preset slot is changed.
+ * Must be called from the UI thread.
+ * This function may sleep/lock.
+ *
+ * @param instance Handle to instance received from lv2dynparam_host_attach()
+ * @param preset_a Index of preset cache slot for position 0.0
+ * @param preset_b Index of preset cache slot for position 1.0
+ * @return Whether morph is ready, false if either slot is empty, in which case
+ * morph becomes ready when preset is stored in it.
+ */
+bool
+lv2dynparam_host_morph_set(
+  lv2dynparam_host_instance instance,
+  unsigned int preset_a,
+  unsigned int preset_b);
+
+/**
+ * Call this function to stop morphing setup with lv2dynparam_host_morph_set().
+ * Must be called from the UI thread.
+ * This function may sleep/lock.
+ *
+ * @param instance Handle to instance received from lv2dynparam_host_attach()
+ */
+void
+lv2dynparam_host_morph_clear(
+  lv2dynparam_host_instance instance);
+
+/**
+ * Call this function to evaluate morph at given position.
+ * Only parameters whose value changes are updated, calling this function
+ * with unchanged position is cheap.
+ * Must be called from from audio/midi realtime thread.
+ * This function will not sleep/lock.
+ *
+ * @param instance Handle to instance received from lv2dynparam_host_attach()
+ * @param position Morph position, clamped to range 0.0 .. 1.0
+ * @return Whether morph was evaluated, false if position is not finite, no morph is ready
+ * or UI thread is accessing the parameters at the moment, in which case call can be retried.
+ */
+bool
+lv2dynparam_host_morph_run(
+  lv2dynparam_host_instance instance,
+  float position);
+
+/**
+ * Store function supplied by host state backend, same as LV2_State_Store_Function
+ * of the LV2 State extension. Returns zero (LV2_STATE_SUCCESS) on success.
+ */
+typedef
+int
+(* lv2dynparam_host_state_store_function)(
+  void * handle,
+  uint32_t key,
+  const void * value,
+  size_t size,
+  uint32_t type,
+  uint32_t flags);
+
+/**
+ * Retrieve function supplied by host state backend, same as LV2_State_Retrieve_Function
+ * of the LV2 State extension. Returns NULL if there is no value for the key.
+ */
+typedef
+const void *
+(* lv2dynparam_host_state_retrieve_function)(
+  void * handle,
+  uint32_t key,
+  size_t * size,
+  uint32_t * type,
+  uint32_t * flags);
+
+/**
+ * Call this function to save values of plugin parameters through LV2 State
+ * compatible store function, typically from host implementation of
+ * LV2_State_Interface::save(). Each parameter is stored under its own key,
+ * as atom:Float, atom:Int, atom:Bool or atom:String (enums), so no text
+ * conversion is involved. List of stored parameters is stored under extra key.
+ * Must be called from the UI thread.
+ * This function may sleep/lock.
+ *
+ * @param instance Handle to instance received from lv2dynparam_host_attach()
+ * @param store Store function of host state backend
+ * @param handle Handle to be supplied to store function
+ * @param features Host features, must include http://lv2plug.in/ns/ext/urid#map
+ * @return Success status
+ */
+bool
+lv2dynparam_host_lv2_state_save(
+  lv2dynparam_host_instance instance,
+  lv2dynparam_host_state_store_function store,
+  void * handle,
+  const LV2_Feature * const * features);
+
+/**
+ * Call this function to restore values of plugin parameters saved with
+ * lv2dynparam_host_lv2_state_save(). Values of parameters that have not
+ * appeared yet are applied when parameters appear.
+ * Must be called from the UI thread.
+ * This function may sleep/lock.
+ *
+ * @param instance Handle to instance received from lv2dynparam_host_attach()
+ * @param retrieve Retrieve function of host state backend
+ * @param handle Handle to be supplied to retrieve function
+ * @param features Host features, must include http://lv2plug.in/ns/ext/urid#map
+ * @return Success status, false if state contains no parameters list or it is corrupted
+ */
+bool
+lv2dynparam_host_lv2_state_restore(
+  lv2dynparam_host_instance instance,
+  lv2dynparam_host_state_retrieve_function retrieve,
+  void * handle,
+  const LV2_Feature * const * features);
+
 /**
  * Call this function to set parameter of plugin, as pair of parameter name and value strings.
  * Must be called from the UI thread.
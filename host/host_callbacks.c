@@ -88,18 +88,22 @@ lv2dynparam_host_group_appear(
   INIT_LIST_HEAD(&group_ptr->child_commands);
 
   instance_ptr->callbacks_ptr->group_get_name(group, group_ptr->name);
+  group_ptr->path = NULL;
 
   group_ptr->pending_state = LV2DYNPARAM_PENDING_APPEAR;
   group_ptr->pending_childern_count = 0;
+  group_ptr->ui_appeared = false;
 
   if (parent_group_ptr == NULL)
   {
     LOG_DEBUG("The top level group \"%s\" appeared", group_ptr->name);
+    group_ptr->path_hash = LV2DYNPARAM_HOST_PATH_HASH_INITIAL;
     instance_ptr->root_group_ptr = group_ptr;
   }
   else
   {
     LOG_DEBUG("Group \"%s\" with parent \"%s\" appeared.", group_ptr->name, parent_group_ptr->name);
+    group_ptr->path_hash = lv2dynparam_host_path_hash_component(parent_group_ptr->path_hash, group_ptr->name);
     list_add_tail(&group_ptr->siblings, &parent_group_ptr->child_groups);
 
     lv2dynparam_host_group_pending_children_count_increment(parent_group_ptr);
@@ -107,6 +111,8 @@ lv2dynparam_host_group_appear(
 
   LOG_DEBUG("%u hints", hints_ptr->count);
 
+  instance_ptr->structure_generation++;
+
   *group_host_context = group_ptr;
 
   return true;
@@ -130,16 +136,23 @@ lv2dynparam_host_group_disappear(
 
   LOG_DEBUG("Group %s disappeared.", group_ptr->name);
 
-  switch (group_ptr->pending_state)
+  instance_ptr->structure_generation++;
+
+  /* The whole subtree disappears with the group. Plugin frees it when
+   * this call returns, children are dropped in bulk by lv2dynparam_host_ui_run() */
+
+  if (group_ptr->pending_state == LV2DYNPARAM_PENDING_NOTHING)
   {
-  case LV2DYNPARAM_PENDING_APPEAR:
-    group_ptr->pending_state = LV2DYNPARAM_PENDING_NOTHING;
-    lv2dynparam_host_group_pending_children_count_decrement(group_ptr->parent_group_ptr);
-    break;
-  case LV2DYNPARAM_PENDING_NOTHING:
-    group_ptr->pending_state = LV2DYNPARAM_PENDING_DISAPPEAR;
     lv2dynparam_host_group_pending_children_count_increment(group_ptr->parent_group_ptr);
-    break;
+  }
+
+  /* else group is already counted as pending child of its parent */
+
+  group_ptr->pending_state = LV2DYNPARAM_PENDING_DISAPPEAR;
+
+  if (!list_empty(&instance_ptr->borrowed_parameters))
+  {
+    lv2dynparam_host_group_drop_borrowed(instance_ptr);
   }
 
   return true;
@@ -155,7 +168,6 @@ lv2dynparam_host_parameter_appear(
 {
   struct lv2dynparam_host_parameter * param_ptr;
   struct lv2dynparam_host_group * group_ptr;
-  unsigned int i;
 
   group_ptr = (struct lv2dynparam_host_group *)group_host_context;
 
@@ -168,6 +180,7 @@ lv2dynparam_host_parameter_appear(
   param_ptr->param_handle = parameter;
   param_ptr->context_set = false;
   param_ptr->pending_value_change = false;
+  param_ptr->path = NULL;
 
   instance_ptr->callbacks_ptr->parameter_get_name(parameter, param_ptr->name);
   instance_ptr->callbacks_ptr->parameter_get_type_uri(parameter, param_ptr->type_uri);
@@ -186,13 +199,11 @@ lv2dynparam_host_parameter_appear(
     return true;
   }
 
-  if (!lv2dynparam_hints_init_copy(
-        instance_ptr->memory,
-        hints_ptr,
-        &param_ptr->hints))
-  {
-    goto fail_deallocate;
-  }
+  /* Hints and enum values stay in plugin storage, they are copied
+   * by lv2dynparam_host_ui_run(), so appear does not allocate for them */
+  lv2dynparam_hints_init_empty(&param_ptr->hints);
+  param_ptr->plugin_hints_ptr = hints_ptr;
+  param_ptr->borrowed = true;
 
   instance_ptr->callbacks_ptr->parameter_get_value(
     parameter,
@@ -216,27 +227,21 @@ lv2dynparam_host_parameter_appear(
     param_ptr->max_ptr = NULL;
   }
 
-  /* read current value */
-  switch (param_ptr->type)
+  if (param_ptr->type == LV2DYNPARAM_PARAMETER_TYPE_STRING ||
+      param_ptr->type == LV2DYNPARAM_PARAMETER_TYPE_FILENAME)
   {
-  case LV2DYNPARAM_PARAMETER_TYPE_BOOLEAN:
-    param_ptr->value.boolean = *(unsigned char *)(param_ptr->value_ptr);
-    LOG_DEBUG("Boolean parameter with value %s", param_ptr->value.boolean ? "TRUE" : "FALSE");
-    break;
-  case LV2DYNPARAM_PARAMETER_TYPE_FLOAT:
-    param_ptr->value.fpoint = *(float *)(param_ptr->value_ptr);
-    LOG_DEBUG("Float parameter with value %f", param_ptr->value.fpoint);
-    break;
-  case LV2DYNPARAM_PARAMETER_TYPE_ENUM:
-    param_ptr->value.enum_selected_index = *(unsigned int *)(param_ptr->value_ptr);
-    LOG_DEBUG("Enum parameter with selected value index %u", param_ptr->value.enum_selected_index);
-    break;
-  case LV2DYNPARAM_PARAMETER_TYPE_INT:
-    param_ptr->value.integer = *(signed int *)(param_ptr->value_ptr);
-    LOG_DEBUG("Integer parameter with value %d", param_ptr->value.integer);
-    break;
+    /* value is copied to preallocated buffer, realtime thread can update it */
+    param_ptr->range.string.size = ((struct lv2dynparam_string_value *)(param_ptr->value_ptr))->size;
+    param_ptr->value.string = rtsafe_memory_allocate(instance_ptr->memory, param_ptr->range.string.size);
+    if (param_ptr->value.string == NULL)
+    {
+      goto fail_deallocate;
+    }
   }
 
+  /* read current value */
+  param_ptr->type_ops->read(param_ptr);
+
   /* read current range */
   switch (param_ptr->type)
   {
@@ -250,31 +255,16 @@ lv2dynparam_host_parameter_appear(
     param_ptr->range.integer.max = *(signed int *)(param_ptr->max_ptr);
     LOG_DEBUG("Integer parameter with range %d - %d", param_ptr->range.integer.min, param_ptr->range.integer.max);
     break;
+  case LV2DYNPARAM_PARAMETER_TYPE_NOTE:
+    param_ptr->range.note.min = *(unsigned char *)(param_ptr->min_ptr);
+    param_ptr->range.note.max = *(unsigned char *)(param_ptr->max_ptr);
+    LOG_DEBUG("Note parameter with range %u - %u", param_ptr->range.note.min, param_ptr->range.note.max);
+    break;
   case LV2DYNPARAM_PARAMETER_TYPE_ENUM:
     param_ptr->range.enumeration.values_count = *(unsigned int *)(param_ptr->max_ptr);
-
-/*     LOG_DEBUG("Enum parameter with %u possible values", param_ptr->data.enumeration.values_count); */
-/*     for (i = 0 ; i < param_ptr->range.enumeration.values_count ; i++) */
-/*     { */
-/*       LOG_DEBUG("\"%s\"", (*(const char * const * *)(param_ptr->min_ptr))[i]); */
-/*     } */
-
-    param_ptr->range.enumeration.values =
-      lv2dynparam_enum_duplicate(
-        instance_ptr->memory,
-        *(const char * const * *)(param_ptr->min_ptr),
-        param_ptr->range.enumeration.values_count);
-    if (param_ptr->range.enumeration.values == NULL)
-    {
-      goto fail_clear_hints;
-    }
+    param_ptr->range.enumeration.values = *(char * * *)(param_ptr->min_ptr);
 
     LOG_DEBUG("Enum parameter with %u possible values", param_ptr->range.enumeration.values_count);
-    for (i = 0 ; i < param_ptr->range.enumeration.values_count ; i++)
-    {
-      LOG_DEBUG("\"%s\"", param_ptr->range.enumeration.values[i]);
-    }
-
     LOG_DEBUG(
       "Selected value is \"%s\" at index  %u",
       param_ptr->range.enumeration.values[param_ptr->value.enum_selected_index],
@@ -286,17 +276,26 @@ lv2dynparam_host_parameter_appear(
   /* Add parameter as child of its group */
   param_ptr->group_ptr = group_ptr;
   list_add_tail(&param_ptr->siblings, &group_ptr->child_params);
+  instance_ptr->parameters_count++;
+  instance_ptr->structure_generation++;
+  param_ptr->generation = ++instance_ptr->values_generation;
   param_ptr->pending_state = LV2DYNPARAM_PENDING_APPEAR;
+  param_ptr->ui_appeared = false;
   param_ptr->context_set = false;
+  param_ptr->context_pending_value_change = NULL;
+  param_ptr->plugin_change_queued = 0;
+  param_ptr->plugin_change_next = NULL;
+  param_ptr->path_hash = lv2dynparam_host_path_hash_component(group_ptr->path_hash, param_ptr->name);
+  list_add_tail(&param_ptr->borrowed_siblings, &instance_ptr->borrowed_parameters);
   lv2dynparam_host_group_pending_children_count_increment(group_ptr);
 
+  /* value for this parameter may have been set before it appeared */
+  lv2dynparam_host_parameter_resolve_pending_value_change(instance_ptr, param_ptr);
+
   *parameter_host_context = param_ptr;
 
   return true;
 
-fail_clear_hints:
-  lv2dynparam_hints_clear(&param_ptr->hints);
-
 fail_deallocate:
   rtsafe_memory_pool_deallocate(instance_ptr->parameters_pool, param_ptr);
 
@@ -318,11 +317,19 @@ lv2dynparam_host_parameter_disappear(
 
   LOG_DEBUG("Parameter %s disappeared.", param_ptr->name);
 
+  instance_ptr->structure_generation++;
+
+  if (param_ptr->borrowed)
+  {
+    /* plugin frees the parameter when this call returns */
+    lv2dynparam_host_parameter_drop_borrowed(param_ptr);
+  }
+
   switch (param_ptr->pending_state)
   {
   case LV2DYNPARAM_PENDING_APPEAR:
-    param_ptr->pending_state = LV2DYNPARAM_PENDING_NOTHING;
-    lv2dynparam_host_group_pending_children_count_decrement(param_ptr->group_ptr);
+    /* already counted as pending, freed by lv2dynparam_host_ui_run() */
+    param_ptr->pending_state = LV2DYNPARAM_PENDING_DISAPPEAR;
     break;
   case LV2DYNPARAM_PENDING_NOTHING:
     param_ptr->pending_state = LV2DYNPARAM_PENDING_DISAPPEAR;
@@ -338,6 +345,27 @@ lv2dynparam_host_parameter_change(
   void * instance_host_context,
   void * parameter_host_context)
 {
+  struct lv2dynparam_host_parameter * head_ptr;
+
+  if (param_ptr == NULL)
+  {
+    /* parameter of unknown type, ignored */
+    return true;
+  }
+
+  if (!__sync_bool_compare_and_swap(&param_ptr->plugin_change_queued, 0, 1))
+  {
+    /* already queued, new value will be read when the queue is drained */
+    return true;
+  }
+
+  do
+  {
+    head_ptr = instance_ptr->plugin_changes;
+    param_ptr->plugin_change_next = head_ptr;
+  }
+  while (!__sync_bool_compare_and_swap(&instance_ptr->plugin_changes, head_ptr, param_ptr));
+
   return true;
 }
 
@@ -349,14 +377,68 @@ lv2dynparam_host_command_appear(
   const struct lv2dynparam_hints * hints_ptr,
   void ** command_context)
 {
-  LOG_DEBUG("Command apperead.");
-  return false;                 /* not implemented */
+  struct lv2dynparam_host_command * command_ptr;
+  struct lv2dynparam_host_group * group_ptr;
+
+  group_ptr = (struct lv2dynparam_host_group *)group_host_context;
+
+  command_ptr = rtsafe_memory_pool_allocate(instance_ptr->commands_pool);
+  if (command_ptr == NULL)
+  {
+    goto fail;
+  }
+
+  if (!lv2dynparam_hints_init_copy(
+        instance_ptr->memory,
+        hints_ptr,
+        &command_ptr->hints))
+  {
+    goto fail_deallocate;
+  }
+
+  command_ptr->command_handle = command;
+  instance_ptr->callbacks_ptr->command_get_name(command, command_ptr->name);
+
+  LOG_DEBUG("Command \"%s\" with parent \"%s\" appeared.", command_ptr->name, group_ptr->name);
+
+  command_ptr->group_ptr = group_ptr;
+  list_add_tail(&command_ptr->siblings, &group_ptr->child_commands);
+  command_ptr->pending_state = LV2DYNPARAM_PENDING_APPEAR;
+  command_ptr->ui_appeared = false;
+  lv2dynparam_host_group_pending_children_count_increment(group_ptr);
+
+  *command_context = command_ptr;
+
+  return true;
+
+fail_deallocate:
+  rtsafe_memory_pool_deallocate(instance_ptr->commands_pool, command_ptr);
+
+fail:
+  return false;
 }
 
+#define command_ptr ((struct lv2dynparam_host_command *)command_host_context)
+
 unsigned char
 lv2dynparam_host_command_disappear(
   void * instance_host_context,
   void * command_host_context)
 {
+  LOG_DEBUG("Command %s disappeared.", command_ptr->name);
+
+  /* freed in lv2dynparam_host_notify(), queued executions may reference it */
+  switch (command_ptr->pending_state)
+  {
+  case LV2DYNPARAM_PENDING_APPEAR:
+    /* already counted as pending */
+    command_ptr->pending_state = LV2DYNPARAM_PENDING_DISAPPEAR;
+    break;
+  case LV2DYNPARAM_PENDING_NOTHING:
+    command_ptr->pending_state = LV2DYNPARAM_PENDING_DISAPPEAR;
+    lv2dynparam_host_group_pending_children_count_increment(command_ptr->group_ptr);
+    break;
+  }
+
   return true;
 }
@@ -39,23 +39,60 @@ struct lv2dynparam_host_group
 
   char name[LV2DYNPARAM_MAX_STRING_SIZE];
 
+  char * path;                  /* escaped serialization path, NULL until first needed, empty for root group */
+  size_t path_len;
+  unsigned int path_hash;
+
   struct lv2dynparam_hints hints;
 
   unsigned int pending_state;
   unsigned int pending_childern_count;
 
+  bool ui_appeared;             /* whether UI was notified about the group */
   void * ui_context;
 };
 
+struct lv2dynparam_host_parameter;
+
+/* Type specific parameter operations, bound when parameter type URI is mapped */
+struct lv2dynparam_host_parameter_type
+{
+  const char * uri;
+  unsigned int type;
+
+  /* store value of value_type into parameter value, false if it cannot be converted */
+  bool
+  (* assign)(
+    struct lv2dynparam_host_parameter * parameter_ptr,
+    unsigned int value_type,
+    const union lv2dynparam_host_parameter_value * value_ptr);
+
+  /* write parameter value to plugin */
+  void
+  (* write)(
+    struct lv2dynparam_host_parameter * parameter_ptr);
+
+  /* read parameter value from plugin */
+  void
+  (* read)(
+    struct lv2dynparam_host_parameter * parameter_ptr);
+};
+
 struct lv2dynparam_host_parameter
 {
   struct list_head siblings;
   struct lv2dynparam_host_group * group_ptr;
   lv2dynparam_parameter_handle param_handle;
   char name[LV2DYNPARAM_MAX_STRING_SIZE];
+  char * path;                  /* escaped serialization path, NULL until first needed */
+  unsigned int path_hash;
   struct lv2dynparam_hints hints;
+  const struct lv2dynparam_hints * plugin_hints_ptr; /* hints in plugin storage, copied by lv2dynparam_host_ui_run() */
+  bool borrowed;                /* hints and enum values are not copied from plugin storage */
+  struct list_head borrowed_siblings; /* siblings in instance borrowed_parameters, while copy is pending */
   char type_uri[LV2DYNPARAM_MAX_STRING_SIZE];
   unsigned int type;
+  const struct lv2dynparam_host_parameter_type * type_ops; /* matching type */
 
   void * value_ptr;
   void * min_ptr;
@@ -63,6 +100,7 @@ struct lv2dynparam_host_parameter
 
   union lv2dynparam_host_parameter_range range;
   union lv2dynparam_host_parameter_value value;
+  unsigned int generation;      /* values_generation of last value change */
 
   unsigned int pending_state;
   bool pending_value_change;
@@ -72,6 +110,10 @@ struct lv2dynparam_host_parameter
 
   void * context_pending_value_change; /* associated with pending value change */
 
+  int plugin_change_queued;     /* non-zero while in instance plugin_changes stack, accessed atomically */
+  struct lv2dynparam_host_parameter * plugin_change_next;
+
+  bool ui_appeared;             /* whether UI was notified about appear */
   void * ui_context;            /* associated with UI (appear) */
 };
 
@@ -81,8 +123,11 @@ struct lv2dynparam_host_command
   struct lv2dynparam_host_group * group_ptr;
   lv2dynparam_command_handle command_handle;
   char name[LV2DYNPARAM_MAX_STRING_SIZE];
+  struct lv2dynparam_hints hints;
+
+  unsigned int pending_state;
+  bool ui_appeared;             /* whether UI was notified about appear */
 
-  bool gui_referenced;
   void * ui_context;
 };
 
@@ -90,14 +135,24 @@ struct lv2dynparam_host_parameter_pending_value_change
 {
   struct list_head siblings;
   char * name_asciizz;
+  unsigned int path_hash;       /* hash of name_asciizz, valid while postponed */
+  struct lv2dynparam_host_parameter * parameter_ptr; /* valid when resolved */
   unsigned int type;
   union lv2dynparam_host_parameter_value data;
   void * context;
 };
 
+/* Number of buckets in the postponed value changes index, must be power of two */
+#define LV2DYNPARAM_HOST_PENDING_VALUE_CHANGES_HASH_SIZE 256
+
+/* Path hashes are computed over the unescaped names of the groups and the
+ * parameter, root group excluded. They match the hash of the asciizz
+ * representation of the same path. */
+#define LV2DYNPARAM_HOST_PATH_HASH_INITIAL 2166136261u
+
 #define LV2DYNPARAM_HOST_MESSAGE_TYPE_PARAMETER_CHANGE          0
 #define LV2DYNPARAM_HOST_MESSAGE_TYPE_COMMAND_EXECUTE           1
-#define LV2DYNPARAM_HOST_MESSAGE_TYPE_UNKNOWN_PARAMETER_CHANGE  2
+#define LV2DYNPARAM_HOST_MESSAGE_TYPE_BATCH                     2
 
 struct lv2dynparam_host_message
 {
@@ -110,10 +165,80 @@ struct lv2dynparam_host_message
     struct lv2dynparam_host_group * group;
     struct lv2dynparam_host_parameter * parameter;
     struct lv2dynparam_host_command * command;
-    struct lv2dynparam_host_parameter_pending_value_change * value_change;
+    struct lv2dynparam_host_batch * batch;
   } context;
 };
 
+struct lv2dynparam_host_preset_entry
+{
+  char * name_asciizz;
+  unsigned int source_type;     /* as parsed, enum values are strings */
+  union lv2dynparam_host_parameter_value source_value;
+
+  struct lv2dynparam_host_parameter * parameter_ptr; /* NULL if not appeared */
+  unsigned int type;            /* as resolved for parameter_ptr */
+  union lv2dynparam_host_parameter_value value;
+};
+
+/* Parsed preset, resolved against the parameter tree. Modified on UI thread with the lock held */
+struct lv2dynparam_host_preset
+{
+  unsigned int version;         /* changed each time preset is resolved */
+  unsigned int structure_generation; /* of the tree when resolved */
+  unsigned int removal_generation; /* of the tree when resolved */
+  unsigned int unresolved_count;
+  unsigned int count;
+  struct lv2dynparam_host_preset_entry entries[];
+};
+
+/* Number of preset cache slots */
+#define LV2DYNPARAM_HOST_PRESETS_COUNT 128
+
+/* Morph between two cached presets. Values are kept in separate arrays
+ * per kind, so the interpolation runs as plain loops over floats.
+ * Built on UI thread, evaluated on realtime thread with the lock held. */
+struct lv2dynparam_host_morph
+{
+  unsigned int preset_versions[2]; /* versions of the presets it was built from */
+  unsigned int removal_generation;  /* of the tree when built */
+  float position;                   /* last evaluated, negative if never */
+
+  unsigned int floats_count;
+  struct lv2dynparam_host_parameter ** float_parameters;
+  float * float_values[2];
+  float * float_results;
+
+  /* int and note parameters, interpolated in double, exact for all int values */
+  unsigned int ints_count;
+  struct lv2dynparam_host_parameter ** int_parameters;
+  double * int_values[2];
+  double * int_results;
+
+  /* enum and boolean parameters, switched at LV2DYNPARAM_HOST_MORPH_SWITCH_POSITION */
+  unsigned int switches_count;
+  struct lv2dynparam_host_parameter ** switch_parameters;
+  union lv2dynparam_host_parameter_value * switch_values[2];
+};
+
+#define LV2DYNPARAM_HOST_MORPH_SWITCH_POSITION 0.5f
+
+struct lv2dynparam_host_batch_entry
+{
+  struct lv2dynparam_host_parameter * parameter_ptr; /* resolved on submit, NULL if parameter has not appeared */
+  struct lv2dynparam_host_parameter_pending_value_change * value_ptr;
+};
+
+/* Value changes handed to the realtime thread in one message. Not modified
+ * after submit. Returned through realtime_to_ui_queue to be freed in ui_run. */
+struct lv2dynparam_host_batch
+{
+  struct lv2dynparam_host_message * message_ptr;
+  bool submitted;
+  unsigned int count;
+  unsigned int max_count;
+  struct lv2dynparam_host_batch_entry entries[];
+};
+
 struct lv2dynparam_host_instance
 {
   void * instance_context;
@@ -122,18 +247,42 @@ struct lv2dynparam_host_instance
   LV2_Handle lv2instance;
 
   struct lv2dynparam_host_group * root_group_ptr;
+  unsigned int parameters_count; /* number of parameters in the tree */
+  unsigned int structure_generation; /* incremented when groups or parameters appear or disappear */
+  unsigned int values_generation; /* incremented when parameter value is changed */
+  unsigned int removal_generation; /* incremented when parameter is freed */
 
   bool ui;
 
   struct list_head realtime_to_ui_queue; /* protected by the audiolock */
   struct list_head ui_to_realtime_queue; /* protected by the audiolock */
+  unsigned int ui_to_realtime_changes; /* changes in ui_to_realtime_queue, batch counts as its entries, protected by the audiolock */
+
+  /* lock-free stack of parameters whose value was changed by plugin,
+     pushed from any plugin thread, drained in realtime_run */
+  struct lv2dynparam_host_parameter * plugin_changes;
+
+  /* postponed value changes of parameters that have not appeared yet, indexed by path hash */
+  struct list_head pending_parameter_value_changes[LV2DYNPARAM_HOST_PENDING_VALUE_CHANGES_HASH_SIZE];
+
+  /* postponed value changes matched on parameter appear, applied in realtime_run */
+  struct list_head resolved_parameter_value_changes;
+
+  /* appeared parameters whose hints and enum values are still in plugin storage, copied in ui_run */
+  struct list_head borrowed_parameters;
+
+  struct lv2dynparam_host_preset * presets[LV2DYNPARAM_HOST_PRESETS_COUNT];
+  unsigned int presets_version; /* last preset version assigned, UI thread only */
 
-  struct list_head pending_parameter_value_changes;
+  bool morph_active;            /* UI thread only */
+  unsigned int morph_presets[2]; /* UI thread only */
+  struct lv2dynparam_host_morph * morph_ptr;
 
   rtsafe_memory_handle memory;
 
   rtsafe_memory_pool_handle groups_pool;
   rtsafe_memory_pool_handle parameters_pool;
+  rtsafe_memory_pool_handle commands_pool;
   rtsafe_memory_pool_handle messages_pool;
   rtsafe_memory_pool_handle pending_parameter_value_changes_pool;
 
@@ -159,4 +308,47 @@ lv2dynparam_host_parameter_free(
   struct lv2dynparam_host_instance * instance_ptr,
   struct lv2dynparam_host_parameter * parameter_ptr);
 
+void
+lv2dynparam_host_parameter_drop_borrowed(
+  struct lv2dynparam_host_parameter * parameter_ptr);
+
+void
+lv2dynparam_host_group_drop_borrowed(
+  struct lv2dynparam_host_instance * instance_ptr);
+
+unsigned int
+lv2dynparam_host_path_hash_component(
+  unsigned int hash,
+  const char * name);
+
+void
+lv2dynparam_host_parameter_resolve_pending_value_change(
+  struct lv2dynparam_host_instance * instance_ptr,
+  struct lv2dynparam_host_parameter * parameter_ptr);
+
+struct lv2dynparam_host_batch *
+lv2dynparam_host_batch_create(
+  struct lv2dynparam_host_instance * instance_ptr,
+  unsigned int max_count);
+
+/* On success, takes ownership of name_asciizz and of string value */
+bool
+lv2dynparam_host_batch_add(
+  struct lv2dynparam_host_instance * instance_ptr,
+  struct lv2dynparam_host_batch * batch_ptr,
+  char * name_asciizz,
+  unsigned int type,
+  const union lv2dynparam_host_parameter_value * value_ptr,
+  void * context);
+
+void
+lv2dynparam_host_batch_submit(
+  struct lv2dynparam_host_instance * instance_ptr,
+  struct lv2dynparam_host_batch * batch_ptr);
+
+void
+lv2dynparam_host_batch_free(
+  struct lv2dynparam_host_instance * instance_ptr,
+  struct lv2dynparam_host_batch * batch_ptr);
+
 #endif /* #ifndef DYNPARAM_INTERNAL_H__86778596_B1A9_4BD7_A14A_BECBD5589468__INCLUDED */
@@ -0,0 +1,1126 @@
+/* -*- Mode: C ; c-basic-offset: 2 -*- */
+/*****************************************************************************
+ *
+ *   Binary state save and restore
+ *
+ *   This file is part of lv2dynparam host library
+ *
+ *   Copyright (C) 2006,2007,2008,2009 Nedko Arnaudov <nedko@arnaudov.name>
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; version 2 of the License
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ *****************************************************************************/
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <lv2.h>
+
+#include "../lv2dynparam.h"
+#include "../lv2_rtmempool.h"
+#include "host.h"
+#include "../audiolock.h"
+#include "../list.h"
+#include "../memory_atomic.h"
+#include "internal.h"
+#include "../helpers.h"
+
+//#define LOG_LEVEL LOG_LEVEL_DEBUG
+#include "../log.h"
+
+/*
+ * State layout, all integers are 32 bit in byte order of the saving machine:
+ *
+ *   header
+ *   values      uint32_t[count], raw value bits; string table offset for enums
+ *   paths       uint32_t[count], string table offsets of asciizz parameter paths
+ *   types       uint8_t[count], LV2DYNPARAM_PARAMETER_TYPE_XXX, padded to 4 bytes
+ *   strings     string table, terminated with two zero bytes
+ *
+ * Paths use the asciizz form: names of groups (root excluded) and of the
+ * parameter, each zero terminated, followed by an extra zero. Restore
+ * does no text parsing, paths are matched as is.
+ */
+
+#define STATE_MAGIC            0x5350444c /* "LDPS" when stored little endian */
+#define STATE_VERSION          1
+#define STATE_BYTE_ORDER_MARK  0x01020304
+
+/* Initial guess for size of strings of one parameter */
+#define STATE_STRINGS_SIZE_GUESS 32
+
+struct state_header
+{
+  uint32_t magic;
+  uint32_t version;
+  uint32_t byte_order;
+  uint32_t size;
+  uint32_t count;
+  uint32_t values_offset;
+  uint32_t paths_offset;
+  uint32_t types_offset;
+  uint32_t strings_offset;
+  uint32_t strings_size;
+};
+
+struct state_writer
+{
+  char * buffer;
+  size_t buffer_size;
+  size_t used;
+  uint32_t index;
+  uint32_t count;
+  uint32_t strings_offset;
+};
+
+#define STATE_ALIGN(size) (((size) + 3) & ~(size_t)3)
+
+static
+bool
+state_reserve(
+  struct state_writer * writer_ptr,
+  size_t size)
+{
+  size_t new_size;
+  char * new_buffer;
+
+  if (writer_ptr->used + size <= writer_ptr->buffer_size)
+  {
+    return true;
+  }
+
+  new_size = writer_ptr->buffer_size * 2;
+  if (new_size < writer_ptr->used + size)
+  {
+    new_size = writer_ptr->used + size;
+  }
+
+  new_buffer = realloc(writer_ptr->buffer, new_size);
+  if (new_buffer == NULL)
+  {
+    LOG_ERROR("failed to grow state buffer to %zu bytes", new_size);
+    return false;
+  }
+
+  writer_ptr->buffer = new_buffer;
+  writer_ptr->buffer_size = new_size;
+
+  return true;
+}
+
+/* Appends string to the string table and returns its offset within the table */
+static
+bool
+state_append_string(
+  struct state_writer * writer_ptr,
+  const char * string,
+  uint32_t * offset_ptr)
+{
+  size_t size;
+
+  size = strlen(string) + 1;
+
+  if (!state_reserve(writer_ptr, size))
+  {
+    return false;
+  }
+
+  memcpy(writer_ptr->buffer + writer_ptr->used, string, size);
+  *offset_ptr = writer_ptr->used - writer_ptr->strings_offset;
+  writer_ptr->used += size;
+
+  return true;
+}
+
+/* Appends asciizz path of the parameter to the string table */
+static
+bool
+state_append_path(
+  struct state_writer * writer_ptr,
+  struct lv2dynparam_host_parameter * parameter_ptr,
+  uint32_t * offset_ptr)
+{
+  struct lv2dynparam_host_group * group_ptr;
+  size_t size;
+  size_t len;
+  char * ptr;
+
+  size = strlen(parameter_ptr->name) + 2;
+  for (group_ptr = parameter_ptr->group_ptr ; group_ptr->parent_group_ptr != NULL ; group_ptr = group_ptr->parent_group_ptr)
+  {
+    size += strlen(group_ptr->name) + 1;
+  }
+
+  if (!state_reserve(writer_ptr, size))
+  {
+    return false;
+  }
+
+  /* fill from the end, walking up to the root */
+  ptr = writer_ptr->buffer + writer_ptr->used + size;
+  *--ptr = 0;
+
+  len = strlen(parameter_ptr->name) + 1;
+  ptr -= len;
+  memcpy(ptr, parameter_ptr->name, len);
+
+  for (group_ptr = parameter_ptr->group_ptr ; group_ptr->parent_group_ptr != NULL ; group_ptr = group_ptr->parent_group_ptr)
+  {
+    len = strlen(group_ptr->name) + 1;
+    ptr -= len;
+    memcpy(ptr, group_ptr->name, len);
+  }
+
+  assert(ptr == writer_ptr->buffer + writer_ptr->used);
+
+  *offset_ptr = writer_ptr->used - writer_ptr->strings_offset;
+  writer_ptr->used += size;
+
+  return true;
+}
+
+static
+bool
+state_save_group(
+  struct state_writer * writer_ptr,
+  struct lv2dynparam_host_group * group_ptr)
+{
+  struct list_head * node_ptr;
+  struct lv2dynparam_host_group * child_group_ptr;
+  struct lv2dynparam_host_parameter * parameter_ptr;
+  struct state_header * header_ptr;
+  uint32_t value;
+  uint32_t path_offset;
+
+  list_for_each(node_ptr, &group_ptr->child_groups)
+  {
+    child_group_ptr = list_entry(node_ptr, struct lv2dynparam_host_group, siblings);
+    if (child_group_ptr->pending_state == LV2DYNPARAM_PENDING_DISAPPEAR)
+    {
+      /* removed by plugin, freed on next lv2dynparam_host_ui_run() */
+      continue;
+    }
+
+    if (!state_save_group(writer_ptr, child_group_ptr))
+    {
+      return false;
+    }
+  }
+
+  list_for_each(node_ptr, &group_ptr->child_params)
+  {
+    parameter_ptr = list_entry(node_ptr, struct lv2dynparam_host_parameter, siblings);
+    if (parameter_ptr->pending_state == LV2DYNPARAM_PENDING_DISAPPEAR)
+    {
+      continue;
+    }
+
+    switch (parameter_ptr->type)
+    {
+    case LV2DYNPARAM_PARAMETER_TYPE_BOOLEAN:
+      value = parameter_ptr->value.boolean ? 1 : 0;
+      break;
+    case LV2DYNPARAM_PARAMETER_TYPE_FLOAT:
+      memcpy(&value, &parameter_ptr->value.fpoint, sizeof(value));
+      break;
+    case LV2DYNPARAM_PARAMETER_TYPE_INT:
+      value = (uint32_t)parameter_ptr->value.integer;
+      break;
+    case LV2DYNPARAM_PARAMETER_TYPE_NOTE:
+      value = parameter_ptr->value.note;
+      break;
+    case LV2DYNPARAM_PARAMETER_TYPE_ENUM:
+      if (!state_append_string(
+            writer_ptr,
+            parameter_ptr->range.enumeration.values[parameter_ptr->value.enum_selected_index],
+            &value))
+      {
+        return false;
+      }
+      break;
+    case LV2DYNPARAM_PARAMETER_TYPE_STRING:
+    case LV2DYNPARAM_PARAMETER_TYPE_FILENAME:
+      if (!state_append_string(writer_ptr, parameter_ptr->value.string, &value))
+      {
+        return false;
+      }
+      break;
+    default:
+      LOG_ERROR("Not saving parameter '%s' of unknown type %u", parameter_ptr->name, parameter_ptr->type);
+      continue;
+    }
+
+    if (!state_append_path(writer_ptr, parameter_ptr, &path_offset))
+    {
+      return false;
+    }
+
+    /* buffer may have been moved by the appends above */
+    header_ptr = (struct state_header *)writer_ptr->buffer;
+    ((uint32_t *)(writer_ptr->buffer + header_ptr->values_offset))[writer_ptr->index] = value;
+    ((uint32_t *)(writer_ptr->buffer + header_ptr->paths_offset))[writer_ptr->index] = path_offset;
+    ((uint8_t *)(writer_ptr->buffer + header_ptr->types_offset))[writer_ptr->index] = parameter_ptr->type;
+    writer_ptr->index++;
+  }
+
+  return true;
+}
+
+static
+bool
+state_check(
+  const void * buffer,
+  size_t size)
+{
+  const struct state_header * header_ptr;
+  const char * strings;
+  const uint32_t * values;
+  const uint32_t * paths;
+  const uint8_t * types;
+  uint32_t i;
+
+  header_ptr = buffer;
+
+  if (((uintptr_t)buffer & 3) != 0)
+  {
+    LOG_ERROR("state buffer is not aligned");
+    return false;
+  }
+
+  if (size < sizeof(struct state_header) ||
+      header_ptr->magic != STATE_MAGIC)
+  {
+    LOG_ERROR("not a lv2dynparam state");
+    return false;
+  }
+
+  if (header_ptr->byte_order != STATE_BYTE_ORDER_MARK)
+  {
+    LOG_ERROR("state was saved on machine with different byte order");
+    return false;
+  }
+
+  if (header_ptr->version != STATE_VERSION)
+  {
+    LOG_ERROR("unsupported state version %u", (unsigned int)header_ptr->version);
+    return false;
+  }
+
+  if (header_ptr->size > size ||
+      header_ptr->count > (header_ptr->size - sizeof(struct state_header)) / 9 ||
+      header_ptr->values_offset < sizeof(struct state_header) ||
+      header_ptr->values_offset % 4 != 0 ||
+      header_ptr->paths_offset % 4 != 0 ||
+      header_ptr->values_offset > header_ptr->size - header_ptr->count * sizeof(uint32_t) ||
+      header_ptr->paths_offset > header_ptr->size - header_ptr->count * sizeof(uint32_t) ||
+      header_ptr->types_offset > header_ptr->size - header_ptr->count ||
+      header_ptr->strings_offset > header_ptr->size ||
+      header_ptr->strings_size > header_ptr->size - header_ptr->strings_offset ||
+      header_ptr->strings_size < 2)
+  {
+    LOG_ERROR("corrupted state header");
+    return false;
+  }
+
+  /* terminating zeros guarantee that string scans stay within the table */
+  strings = (const char *)buffer + header_ptr->strings_offset;
+  if (strings[header_ptr->strings_size - 1] != 0 ||
+      strings[header_ptr->strings_size - 2] != 0)
+  {
+    LOG_ERROR("corrupted state string table");
+    return false;
+  }
+
+  values = (const uint32_t *)((const char *)buffer + header_ptr->values_offset);
+  paths = (const uint32_t *)((const char *)buffer + header_ptr->paths_offset);
+  types = (const uint8_t *)buffer + header_ptr->types_offset;
+
+  for (i = 0 ; i < header_ptr->count ; i++)
+  {
+    if (paths[i] >= header_ptr->strings_size ||
+        ((types[i] == LV2DYNPARAM_PARAMETER_TYPE_ENUM ||
+          types[i] == LV2DYNPARAM_PARAMETER_TYPE_STRING ||
+          types[i] == LV2DYNPARAM_PARAMETER_TYPE_FILENAME) &&
+         values[i] >= header_ptr->strings_size))
+    {
+      LOG_ERROR("corrupted state entry %u", (unsigned int)i);
+      return false;
+    }
+  }
+
+  return true;
+}
+
+/* On success, batch takes ownership of string value */
+static
+bool
+state_batch_add(
+  struct lv2dynparam_host_instance * instance_ptr,
+  struct lv2dynparam_host_batch * batch_ptr,
+  const char * path,
+  size_t path_size,
+  unsigned int type,
+  const union lv2dynparam_host_parameter_value * value_ptr)
+{
+  char * name_asciizz;
+
+  name_asciizz = rtsafe_memory_allocate_sleepy(instance_ptr->memory, path_size);
+  if (name_asciizz == NULL)
+  {
+    LOG_ERROR("failed to allocate memory for parameter path");
+    return false;
+  }
+
+  memcpy(name_asciizz, path, path_size);
+
+  if (!lv2dynparam_host_batch_add(instance_ptr, batch_ptr, name_asciizz, type, value_ptr, NULL))
+  {
+    rtsafe_memory_deallocate(name_asciizz);
+    return false;
+  }
+
+  return true;
+}
+
+/* Size of asciizz path, including the terminating zeros, 0 if path is not terminated within max_size */
+static
+size_t
+state_path_size(
+  const char * path,
+  size_t max_size)
+{
+  size_t size;
+
+  size = 0;
+  while (size < max_size)
+  {
+    if (path[size] == 0)
+    {
+      return size + 1;
+    }
+
+    while (size < max_size && path[size] != 0)
+    {
+      size++;
+    }
+
+    size++;                     /* component terminator */
+  }
+
+  return 0;
+}
+
+/* Mirrors LV2_URID_Map of LV2 URID extension */
+struct state_urid_map
+{
+  void * handle;
+  uint32_t (* map)(void * handle, const char * uri);
+};
+
+#define STATE_URID_MAP_URI "http://lv2plug.in/ns/ext/urid#map"
+
+#define STATE_ATOM_BOOL_URI   "http://lv2plug.in/ns/ext/atom#Bool"
+#define STATE_ATOM_FLOAT_URI  "http://lv2plug.in/ns/ext/atom#Float"
+#define STATE_ATOM_INT_URI    "http://lv2plug.in/ns/ext/atom#Int"
+#define STATE_ATOM_STRING_URI "http://lv2plug.in/ns/ext/atom#String"
+
+/* Key of the list of saved parameters, and its value type; list is sequence
+ * of asciizz parameter paths, terminated with an extra zero byte */
+#define STATE_PARAMETERS_KEY_URI  LV2DYNPARAM_BASE_URI "#state_parameters"
+#define STATE_PARAMETERS_TYPE_URI LV2DYNPARAM_BASE_URI "#state_paths"
+
+/* Parameter values are stored under this prefix followed by the percent encoded path */
+#define STATE_PARAMETER_KEY_URI_PREFIX LV2DYNPARAM_BASE_URI "#state_parameter/"
+
+/* LV2_STATE_IS_POD | LV2_STATE_IS_PORTABLE */
+#define STATE_LV2_FLAGS 3
+
+struct state_lv2
+{
+  struct state_urid_map * map_ptr;
+  uint32_t type_bool;
+  uint32_t type_float;
+  uint32_t type_int;
+  uint32_t type_string;
+  uint32_t type_paths;
+  uint32_t parameters_key;
+  char * key_uri;
+  size_t key_uri_size;
+};
+
+static
+bool
+state_lv2_init(
+  struct state_lv2 * lv2_ptr,
+  const LV2_Feature * const * features)
+{
+  lv2_ptr->map_ptr = NULL;
+  lv2_ptr->key_uri = NULL;
+  lv2_ptr->key_uri_size = 0;
+
+  while (features != NULL && *features != NULL)
+  {
+    if (strcmp((*features)->URI, STATE_URID_MAP_URI) == 0)
+    {
+      lv2_ptr->map_ptr = (*features)->data;
+      break;
+    }
+
+    features++;
+  }
+
+  if (lv2_ptr->map_ptr == NULL)
+  {
+    LOG_ERROR("host does not provide " STATE_URID_MAP_URI " feature");
+    return false;
+  }
+
+  lv2_ptr->type_bool = lv2_ptr->map_ptr->map(lv2_ptr->map_ptr->handle, STATE_ATOM_BOOL_URI);
+  lv2_ptr->type_float = lv2_ptr->map_ptr->map(lv2_ptr->map_ptr->handle, STATE_ATOM_FLOAT_URI);
+  lv2_ptr->type_int = lv2_ptr->map_ptr->map(lv2_ptr->map_ptr->handle, STATE_ATOM_INT_URI);
+  lv2_ptr->type_string = lv2_ptr->map_ptr->map(lv2_ptr->map_ptr->handle, STATE_ATOM_STRING_URI);
+  lv2_ptr->type_paths = lv2_ptr->map_ptr->map(lv2_ptr->map_ptr->handle, STATE_PARAMETERS_TYPE_URI);
+  lv2_ptr->parameters_key = lv2_ptr->map_ptr->map(lv2_ptr->map_ptr->handle, STATE_PARAMETERS_KEY_URI);
+
+  return true;
+}
+
+static
+void
+state_lv2_uninit(
+  struct state_lv2 * lv2_ptr)
+{
+  free(lv2_ptr->key_uri);
+}
+
+/* Maps key of parameter with asciizz path, 0 on failure */
+static
+uint32_t
+state_lv2_map_key(
+  struct state_lv2 * lv2_ptr,
+  const char * path,
+  size_t path_size)
+{
+  static const char hex[] = "0123456789ABCDEF";
+  size_t size;
+  char * ptr;
+  unsigned char c;
+
+  /* each byte is encoded in at most three characters */
+  size = sizeof(STATE_PARAMETER_KEY_URI_PREFIX) + path_size * 3;
+  if (size > lv2_ptr->key_uri_size)
+  {
+    ptr = realloc(lv2_ptr->key_uri, size);
+    if (ptr == NULL)
+    {
+      LOG_ERROR("failed to allocate memory for state key");
+      return 0;
+    }
+
+    lv2_ptr->key_uri = ptr;
+    lv2_ptr->key_uri_size = size;
+  }
+
+  memcpy(lv2_ptr->key_uri, STATE_PARAMETER_KEY_URI_PREFIX, sizeof(STATE_PARAMETER_KEY_URI_PREFIX) - 1);
+  ptr = lv2_ptr->key_uri + sizeof(STATE_PARAMETER_KEY_URI_PREFIX) - 1;
+
+  /* components are separated with slashes, other reserved characters are percent encoded */
+  for ( ; path[1] != 0 || path[0] != 0 ; path++)
+  {
+    c = *path;
+
+    if (c == 0)
+    {
+      *ptr++ = '/';
+    }
+    else if ((c >= 'a' && c <= 'z') ||
+             (c >= 'A' && c <= 'Z') ||
+             (c >= '0' && c <= '9') ||
+             c == '-' || c == '.' || c == '_' || c == '~')
+    {
+      *ptr++ = c;
+    }
+    else
+    {
+      *ptr++ = '%';
+      *ptr++ = hex[c >> 4];
+      *ptr++ = hex[c & 15];
+    }
+  }
+
+  *ptr = 0;
+
+  return lv2_ptr->map_ptr->map(lv2_ptr->map_ptr->handle, lv2_ptr->key_uri);
+}
+
+#define instance_ptr ((struct lv2dynparam_host_instance *)instance)
+
+bool
+lv2dynparam_host_state_save(
+  lv2dynparam_host_instance instance,
+  void ** buffer_ptr,
+  size_t * size_ptr)
+{
+  struct state_writer writer;
+  struct state_header * header_ptr;
+  static const char terminator[2] = {0, 0};
+
+  audiolock_enter_ui(instance_ptr->lock);
+
+  writer.count = instance_ptr->parameters_count;
+  writer.index = 0;
+  writer.strings_offset =
+    sizeof(struct state_header) +
+    writer.count * sizeof(uint32_t) * 2 +
+    STATE_ALIGN(writer.count);
+  writer.used = writer.strings_offset;
+  writer.buffer_size = writer.used + writer.count * STATE_STRINGS_SIZE_GUESS + sizeof(terminator);
+  writer.buffer = malloc(writer.buffer_size);
+  if (writer.buffer == NULL)
+  {
+    LOG_ERROR("failed to allocate %zu bytes for state", writer.buffer_size);
+    goto fail_unlock;
+  }
+
+  memset(writer.buffer, 0, writer.strings_offset);
+
+  header_ptr = (struct state_header *)writer.buffer;
+  header_ptr->magic = STATE_MAGIC;
+  header_ptr->version = STATE_VERSION;
+  header_ptr->byte_order = STATE_BYTE_ORDER_MARK;
+  header_ptr->values_offset = sizeof(struct state_header);
+  header_ptr->paths_offset = header_ptr->values_offset + writer.count * sizeof(uint32_t);
+  header_ptr->types_offset = header_ptr->paths_offset + writer.count * sizeof(uint32_t);
+  header_ptr->strings_offset = writer.strings_offset;
+
+  if (instance_ptr->root_group_ptr != NULL &&
+      !state_save_group(&writer, instance_ptr->root_group_ptr))
+  {
+    goto fail_free;
+  }
+
+  audiolock_leave_ui(instance_ptr->lock);
+
+  if (!state_reserve(&writer, sizeof(terminator)))
+  {
+    goto fail_free_unlocked;
+  }
+
+  memcpy(writer.buffer + writer.used, terminator, sizeof(terminator));
+  writer.used += sizeof(terminator);
+
+  header_ptr = (struct state_header *)writer.buffer;
+  header_ptr->count = writer.index;
+  header_ptr->strings_size = writer.used - writer.strings_offset;
+  header_ptr->size = writer.used;
+
+  *buffer_ptr = writer.buffer;
+  *size_ptr = writer.used;
+
+  return true;
+
+fail_free:
+  audiolock_leave_ui(instance_ptr->lock);
+fail_free_unlocked:
+  free(writer.buffer);
+  return false;
+
+fail_unlock:
+  audiolock_leave_ui(instance_ptr->lock);
+  return false;
+}
+
+bool
+lv2dynparam_host_state_restore(
+  lv2dynparam_host_instance instance,
+  const void * buffer,
+  size_t size)
+{
+  const struct state_header * header_ptr;
+  const char * strings;
+  const char * path;
+  const uint32_t * values;
+  const uint32_t * paths;
+  const uint8_t * types;
+  uint32_t i;
+  size_t path_size;
+  unsigned int type;
+  union lv2dynparam_host_parameter_value value;
+  struct lv2dynparam_host_batch * batch_ptr;
+
+  if (!state_check(buffer, size))
+  {
+    return false;
+  }
+
+  header_ptr = buffer;
+  strings = (const char *)buffer + header_ptr->strings_offset;
+  values = (const uint32_t *)((const char *)buffer + header_ptr->values_offset);
+  paths = (const uint32_t *)((const char *)buffer + header_ptr->paths_offset);
+  types = (const uint8_t *)buffer + header_ptr->types_offset;
+
+  batch_ptr = lv2dynparam_host_batch_create(instance_ptr, header_ptr->count);
+  if (batch_ptr == NULL)
+  {
+    return false;
+  }
+
+  for (i = 0 ; i < header_ptr->count ; i++)
+  {
+    type = types[i];
+
+    switch (type)
+    {
+    case LV2DYNPARAM_PARAMETER_TYPE_BOOLEAN:
+      value.boolean = values[i] != 0;
+      break;
+    case LV2DYNPARAM_PARAMETER_TYPE_FLOAT:
+      memcpy(&value.fpoint, values + i, sizeof(float));
+      break;
+    case LV2DYNPARAM_PARAMETER_TYPE_INT:
+      value.integer = (int32_t)values[i];
+      break;
+    case LV2DYNPARAM_PARAMETER_TYPE_NOTE:
+      if (values[i] > 127)
+      {
+        LOG_ERROR("Skipping state entry %u with invalid note %u", (unsigned int)i, (unsigned int)values[i]);
+        continue;
+      }
+      value.note = values[i];
+      break;
+    case LV2DYNPARAM_PARAMETER_TYPE_ENUM:
+      /* enums are matched by value string, index may differ between plugin versions */
+      /* fall through */
+    case LV2DYNPARAM_PARAMETER_TYPE_FILENAME:
+      /* filenames are applied as string values */
+      type = LV2DYNPARAM_PARAMETER_TYPE_STRING;
+      /* fall through */
+    case LV2DYNPARAM_PARAMETER_TYPE_STRING:
+      value.string = lv2dynparam_strdup_sleepy(instance_ptr->memory, strings + values[i]);
+      if (value.string == NULL)
+      {
+        LOG_ERROR("lv2dynparam_strdup_sleepy() failed");
+        goto fail;
+      }
+      break;
+    default:
+      LOG_ERROR("Skipping state entry %u of unknown type %u", (unsigned int)i, type);
+      continue;
+    }
+
+    path = strings + paths[i];
+    path_size = state_path_size(path, header_ptr->strings_size - paths[i]);
+    assert(path_size != 0);     /* string table ends with two zeros */
+
+    if (!state_batch_add(instance_ptr, batch_ptr, path, path_size, type, &value))
+    {
+      goto fail_free_value;
+    }
+  }
+
+  lv2dynparam_host_batch_submit(instance_ptr, batch_ptr);
+
+  return true;
+
+fail_free_value:
+  if (type == LV2DYNPARAM_PARAMETER_TYPE_STRING)
+  {
+    rtsafe_memory_deallocate(value.string);
+  }
+
+fail:
+  lv2dynparam_host_batch_free(instance_ptr, batch_ptr);
+  return false;
+}
+
+bool
+lv2dynparam_host_state_save_file(
+  lv2dynparam_host_instance instance,
+  const char * filename)
+{
+  void * buffer;
+  size_t size;
+  int fd;
+  ssize_t written;
+  size_t offset;
+  bool ret;
+
+  if (!lv2dynparam_host_state_save(instance, &buffer, &size))
+  {
+    return false;
+  }
+
+  ret = false;
+
+  fd = open(filename, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+  if (fd == -1)
+  {
+    LOG_ERROR("failed to open '%s' for writing", filename);
+    goto free;
+  }
+
+  for (offset = 0 ; offset < size ; offset += written)
+  {
+    written = write(fd, (const char *)buffer + offset, size - offset);
+    if (written <= 0)
+    {
+      LOG_ERROR("failed to write state to '%s'", filename);
+      goto close;
+    }
+  }
+
+  ret = true;
+
+close:
+  if (close(fd) != 0)
+  {
+    LOG_ERROR("failed to close '%s'", filename);
+    ret = false;
+  }
+
+free:
+  free(buffer);
+  return ret;
+}
+
+bool
+lv2dynparam_host_state_load_file(
+  lv2dynparam_host_instance instance,
+  const char * filename)
+{
+  int fd;
+  struct stat st;
+  void * buffer;
+  bool ret;
+
+  ret = false;
+
+  fd = open(filename, O_RDONLY);
+  if (fd == -1)
+  {
+    LOG_ERROR("failed to open '%s'", filename);
+    goto exit;
+  }
+
+  if (fstat(fd, &st) != 0)
+  {
+    LOG_ERROR("failed to stat '%s'", filename);
+    goto close;
+  }
+
+  if (st.st_size < (off_t)sizeof(struct state_header))
+  {
+    LOG_ERROR("'%s' is too small to be lv2dynparam state", filename);
+    goto close;
+  }
+
+  buffer = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  if (buffer == MAP_FAILED)
+  {
+    LOG_ERROR("failed to map '%s'", filename);
+    goto close;
+  }
+
+  ret = lv2dynparam_host_state_restore(instance, buffer, st.st_size);
+
+  munmap(buffer, st.st_size);
+
+close:
+  close(fd);
+
+exit:
+  return ret;
+}
+
+bool
+lv2dynparam_host_lv2_state_save(
+  lv2dynparam_host_instance instance,
+  lv2dynparam_host_state_store_function store,
+  void * handle,
+  const LV2_Feature * const * features)
+{
+  struct state_lv2 lv2;
+  void * buffer;
+  size_t size;
+  const struct state_header * header_ptr;
+  const char * strings;
+  const uint32_t * values;
+  const uint32_t * paths;
+  const uint8_t * types;
+  uint32_t i;
+  const char * path;
+  size_t path_size;
+  char * index;
+  size_t index_size;
+  uint32_t key;
+  const void * value_ptr;
+  size_t value_size;
+  uint32_t value_type;
+  int32_t value_int;
+  bool ret;
+
+  ret = false;
+
+  if (!state_lv2_init(&lv2, features))
+  {
+    goto exit;
+  }
+
+  /* values are collected by the binary state writer, so lock is not held while host stores them */
+  if (!lv2dynparam_host_state_save(instance, &buffer, &size))
+  {
+    goto uninit;
+  }
+
+  header_ptr = buffer;
+  strings = (const char *)buffer + header_ptr->strings_offset;
+  values = (const uint32_t *)((const char *)buffer + header_ptr->values_offset);
+  paths = (const uint32_t *)((const char *)buffer + header_ptr->paths_offset);
+  types = (const uint8_t *)buffer + header_ptr->types_offset;
+
+  /* index can not be larger than the string table */
+  index = malloc(header_ptr->strings_size + 1);
+  if (index == NULL)
+  {
+    LOG_ERROR("failed to allocate memory for state parameters list");
+    goto free_buffer;
+  }
+
+  index_size = 0;
+
+  for (i = 0 ; i < header_ptr->count ; i++)
+  {
+    path = strings + paths[i];
+    path_size = state_path_size(path, header_ptr->strings_size - paths[i]);
+    assert(path_size != 0);
+
+    switch (types[i])
+    {
+    case LV2DYNPARAM_PARAMETER_TYPE_BOOLEAN:
+      value_int = values[i] != 0;
+      value_ptr = &value_int;
+      value_size = sizeof(int32_t);
+      value_type = lv2.type_bool;
+      break;
+    case LV2DYNPARAM_PARAMETER_TYPE_FLOAT:
+      value_ptr = values + i;
+      value_size = sizeof(float);
+      value_type = lv2.type_float;
+      break;
+    case LV2DYNPARAM_PARAMETER_TYPE_INT:
+    case LV2DYNPARAM_PARAMETER_TYPE_NOTE:
+      /* notes are stored as plain integers, restored through the note assign handler */
+      value_ptr = values + i;
+      value_size = sizeof(int32_t);
+      value_type = lv2.type_int;
+      break;
+    case LV2DYNPARAM_PARAMETER_TYPE_ENUM:
+    case LV2DYNPARAM_PARAMETER_TYPE_STRING:
+    case LV2DYNPARAM_PARAMETER_TYPE_FILENAME:
+      value_ptr = strings + values[i];
+      value_size = strlen(value_ptr) + 1;
+      value_type = lv2.type_string;
+      break;
+    default:
+      continue;
+    }
+
+    key = state_lv2_map_key(&lv2, path, path_size);
+    if (key == 0)
+    {
+      goto free_index;
+    }
+
+    if (store(handle, key, value_ptr, value_size, value_type, STATE_LV2_FLAGS) != 0)
+    {
+      LOG_ERROR("host failed to store value of state parameter");
+      goto free_index;
+    }
+
+    memcpy(index + index_size, path, path_size);
+    index_size += path_size;
+  }
+
+  index[index_size++] = 0;
+
+  if (store(handle, lv2.parameters_key, index, index_size, lv2.type_paths, STATE_LV2_FLAGS) != 0)
+  {
+    LOG_ERROR("host failed to store list of state parameters");
+    goto free_index;
+  }
+
+  ret = true;
+
+free_index:
+  free(index);
+
+free_buffer:
+  free(buffer);
+
+uninit:
+  state_lv2_uninit(&lv2);
+
+exit:
+  return ret;
+}
+
+bool
+lv2dynparam_host_lv2_state_restore(
+  lv2dynparam_host_instance instance,
+  lv2dynparam_host_state_retrieve_function retrieve,
+  void * handle,
+  const LV2_Feature * const * features)
+{
+  struct state_lv2 lv2;
+  const char * index;
+  size_t index_size;
+  size_t offset;
+  size_t path_size;
+  unsigned int count;
+  uint32_t type;
+  uint32_t flags;
+  uint32_t key;
+  const void * value_ptr;
+  size_t value_size;
+  uint32_t value_type;
+  int32_t value_int;
+  unsigned int parameter_type;
+  union lv2dynparam_host_parameter_value value;
+  struct lv2dynparam_host_batch * batch_ptr;
+  bool ret;
+
+  ret = false;
+
+  if (!state_lv2_init(&lv2, features))
+  {
+    goto exit;
+  }
+
+  index = retrieve(handle, lv2.parameters_key, &index_size, &type, &flags);
+  if (index == NULL)
+  {
+    LOG_ERROR("no lv2dynparam parameters in state");
+    goto uninit;
+  }
+
+  if (type != lv2.type_paths || index_size == 0 || index[index_size - 1] != 0)
+  {
+    LOG_ERROR("corrupted list of state parameters");
+    goto uninit;
+  }
+
+  count = 0;
+  for (offset = 0 ; index[offset] != 0 ; offset += path_size)
+  {
+    path_size = state_path_size(index + offset, index_size - 1 - offset);
+    if (path_size == 0)
+    {
+      LOG_ERROR("corrupted list of state parameters");
+      goto uninit;
+    }
+
+    count++;
+  }
+
+  batch_ptr = lv2dynparam_host_batch_create(instance_ptr, count);
+  if (batch_ptr == NULL)
+  {
+    goto uninit;
+  }
+
+  for (offset = 0 ; index[offset] != 0 ; offset += path_size)
+  {
+    path_size = state_path_size(index + offset, index_size - 1 - offset);
+
+    key = state_lv2_map_key(&lv2, index + offset, path_size);
+    if (key == 0)
+    {
+      goto free_batch;
+    }
+
+    value_ptr = retrieve(handle, key, &value_size, &value_type, &flags);
+    if (value_ptr == NULL)
+    {
+      LOG_DEBUG("state has no value for parameter \"%s\"", index + offset);
+      continue;
+    }
+
+    if (value_type == lv2.type_float && value_size == sizeof(float))
+    {
+      parameter_type = LV2DYNPARAM_PARAMETER_TYPE_FLOAT;
+      memcpy(&value.fpoint, value_ptr, sizeof(float));
+    }
+    else if (value_type == lv2.type_int && value_size == sizeof(int32_t))
+    {
+      parameter_type = LV2DYNPARAM_PARAMETER_TYPE_INT;
+      memcpy(&value_int, value_ptr, sizeof(int32_t));
+      value.integer = value_int;
+    }
+    else if (value_type == lv2.type_bool && value_size == sizeof(int32_t))
+    {
+      parameter_type = LV2DYNPARAM_PARAMETER_TYPE_BOOLEAN;
+      memcpy(&value_int, value_ptr, sizeof(int32_t));
+      value.boolean = value_int != 0;
+    }
+    else if (value_type == lv2.type_string &&
+             value_size > 0 &&
+             ((const char *)value_ptr)[value_size - 1] == 0)
+    {
+      /* string values, enums and filenames are matched by value string as in binary state */
+      parameter_type = LV2DYNPARAM_PARAMETER_TYPE_STRING;
+      value.string = lv2dynparam_strdup_sleepy(instance_ptr->memory, value_ptr);
+      if (value.string == NULL)
+      {
+        LOG_ERROR("lv2dynparam_strdup_sleepy() failed");
+        goto free_batch;
+      }
+    }
+    else
+    {
+      LOG_ERROR("Skipping state value of parameter \"%s\" with unexpected type or size", index + offset);
+      continue;
+    }
+
+    if (!state_batch_add(instance_ptr, batch_ptr, index + offset, path_size, parameter_type, &value))
+    {
+      if (parameter_type == LV2DYNPARAM_PARAMETER_TYPE_STRING)
+      {
+        rtsafe_memory_deallocate(value.string);
+      }
+
+      goto free_batch;
+    }
+  }
+
+  lv2dynparam_host_batch_submit(instance_ptr, batch_ptr);
+
+  ret = true;
+  goto uninit;
+
+free_batch:
+  lv2dynparam_host_batch_free(instance_ptr, batch_ptr);
+
+uninit:
+  state_lv2_uninit(&lv2);
+
+exit:
+  return ret;
+}
@@ -450,6 +450,22 @@ struct lv2dynparam_plugin_callbacks
 /** URI for string parameter */
 #define LV2DYNPARAM_PARAMETER_TYPE_STRING_URI        LV2DYNPARAM_BASE_URI "#parameter_string"
 
+/**
+ * Value data of string parameter, as pointed by the pointer that
+ * lv2dynparam_plugin_callbacks::parameter_get_value() returns.
+ *
+ * Both buffers are preallocated by plugin. To change the value, host
+ * stores the new value in @c pending buffer and calls
+ * lv2dynparam_plugin_callbacks::parameter_change(). Plugin then swaps
+ * the two buffers, so @c value is never written while it is current.
+ */
+struct lv2dynparam_string_value
+{
+  char * value;                 /**< current value, ASCIIZ string */
+  char * pending;               /**< buffer for next value, written by host */
+  unsigned int size;            /**< size of each buffer, including the terminating zero */
+};
+
 /** URI for filename parameter */
 #define LV2DYNPARAM_PARAMETER_TYPE_FILENAME_URI      LV2DYNPARAM_BASE_URI "#parameter_filename"
 
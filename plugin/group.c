@@ -82,11 +82,17 @@ lv2dynparam_plugin_group_init(
 
   memcpy(group_ptr->name, name, name_size);
   group_ptr->group_ptr = parent_group_ptr;
+  group_ptr->static_node = false;
   INIT_LIST_HEAD(&group_ptr->child_groups);
   INIT_LIST_HEAD(&group_ptr->child_parameters);
 
-  group_ptr->pending = LV2DYNPARAM_PENDING_APPEAR;
-  instance_ptr->pending++;
+  for (index = 0 ; index < LV2DYNPARAM_PLUGIN_GROUP_NAME_HASH_SIZE ; index++)
+  {
+    INIT_LIST_HEAD(group_ptr->child_parameters_hash + index);
+  }
+
+  group_ptr->pending = LV2DYNPARAM_PENDING_NOTHING;
+  lv2dynparam_plugin_group_set_pending(instance_ptr, group_ptr, LV2DYNPARAM_PENDING_APPEAR);
 
   return true;
 }
@@ -159,6 +165,8 @@ lv2dynparam_plugin_group_clean(
     lv2dynparam_plugin_parameter_free(instance_ptr, child_param_ptr);
   }
 
+  lv2dynparam_plugin_group_set_pending(instance_ptr, group_ptr, LV2DYNPARAM_PENDING_NOTHING);
+
   lv2dynparam_hints_clear(&group_ptr->hints);
 }
 
@@ -169,18 +177,66 @@ lv2dynparam_plugin_group_free(
 {
   lv2dynparam_plugin_group_clean(instance_ptr, group_ptr);
   LOG_DEBUG("Freeing group \"%s\"", group_ptr->name);
-  rtsafe_memory_pool_deallocate(instance_ptr->groups_pool, group_ptr);
+
+  if (!group_ptr->static_node)
+  {
+    rtsafe_memory_pool_deallocate(instance_ptr->groups_pool, group_ptr);
+  }
 }
 
 void
-lv2dynparam_plugin_group_notify(
+lv2dynparam_plugin_group_set_pending(
+  struct lv2dynparam_plugin_instance * instance_ptr,
+  struct lv2dynparam_plugin_group * group_ptr,
+  unsigned int pending)
+{
+  if (group_ptr->pending == LV2DYNPARAM_PENDING_NOTHING &&
+      pending != LV2DYNPARAM_PENDING_NOTHING)
+  {
+    list_add_tail(&group_ptr->pending_siblings, &instance_ptr->pending_groups);
+    instance_ptr->pending++;
+  }
+  else if (group_ptr->pending != LV2DYNPARAM_PENDING_NOTHING &&
+           pending == LV2DYNPARAM_PENDING_NOTHING)
+  {
+    list_del(&group_ptr->pending_siblings);
+    instance_ptr->pending--;
+  }
+
+  group_ptr->pending = pending;
+}
+
+/* Children of removed group disappear together with it, host is not notified for them */
+static
+void
+lv2dynparam_plugin_group_cancel_pending(
   struct lv2dynparam_plugin_instance * instance_ptr,
   struct lv2dynparam_plugin_group * group_ptr)
 {
   struct list_head * node_ptr;
   struct lv2dynparam_plugin_group * child_group_ptr;
-  struct lv2dynparam_plugin_parameter * child_param_ptr;
 
+  list_for_each(node_ptr, &group_ptr->child_groups)
+  {
+    child_group_ptr = list_entry(node_ptr, struct lv2dynparam_plugin_group, siblings);
+    lv2dynparam_plugin_group_set_pending(instance_ptr, child_group_ptr, LV2DYNPARAM_PENDING_NOTHING);
+    lv2dynparam_plugin_group_cancel_pending(instance_ptr, child_group_ptr);
+  }
+
+  list_for_each(node_ptr, &group_ptr->child_parameters)
+  {
+    lv2dynparam_plugin_param_set_pending(
+      instance_ptr,
+      list_entry(node_ptr, struct lv2dynparam_plugin_parameter, siblings),
+      LV2DYNPARAM_PENDING_NOTHING);
+  }
+}
+
+void
+lv2dynparam_plugin_group_notify(
+  struct lv2dynparam_plugin_instance * instance_ptr,
+  struct lv2dynparam_plugin_group * group_ptr)
+{
   if (instance_ptr->host_callbacks == NULL)
   {
     /* Host not attached */
@@ -193,6 +249,13 @@ lv2dynparam_plugin_group_notify(
     /* There is nothing to notify for */
     return;
   case LV2DYNPARAM_PENDING_APPEAR:
+    if (group_ptr->group_ptr != NULL &&
+        group_ptr->group_ptr->pending == LV2DYNPARAM_PENDING_APPEAR)
+    {
+      /* Parent group has not appeared yet, host will be notified after it */
+      return;
+    }
+
     if (instance_ptr->host_callbacks->group_appear(
           instance_ptr->host_context,
           group_ptr->group_ptr == NULL ? NULL : group_ptr->group_ptr->host_context, /* host context of parent group */
@@ -200,42 +263,51 @@ lv2dynparam_plugin_group_notify(
           &group_ptr->hints,
           &group_ptr->host_context))
     {
-      group_ptr->pending = LV2DYNPARAM_PENDING_NOTHING;
-      instance_ptr->pending--;
+      lv2dynparam_plugin_group_set_pending(instance_ptr, group_ptr, LV2DYNPARAM_PENDING_NOTHING);
     }
-
-    list_for_each(node_ptr, &group_ptr->child_groups)
+    return;
+  case LV2DYNPARAM_PENDING_DISAPPEAR:
+    /* group is already detached from its parent, host drops the whole subtree */
+    if (instance_ptr->host_callbacks->group_disappear(
+          instance_ptr->host_context,
+          group_ptr->host_context))
     {
-      child_group_ptr = list_entry(node_ptr, struct lv2dynparam_plugin_group, siblings);
-
-      assert(child_group_ptr->group_ptr == group_ptr);
-
-      lv2dynparam_plugin_group_notify(instance_ptr, child_group_ptr);
-
-/*       if (instance_ptr->pending == 0) */
-/*       { */
-        /* optimization */
-/*         return; */
-/*       } */
+      lv2dynparam_plugin_group_free(instance_ptr, group_ptr);
     }
+    return;
+  default:
+    assert(0);
+  }
+}
 
-    list_for_each(node_ptr, &group_ptr->child_parameters)
-    {
-      child_param_ptr = list_entry(node_ptr, struct lv2dynparam_plugin_parameter, siblings);
+void
+lv2dynparam_plugin_instance_notify(
+  struct lv2dynparam_plugin_instance * instance_ptr)
+{
+  struct list_head * node_ptr;
+  struct list_head * next_ptr;
 
-      assert(child_param_ptr->group_ptr == group_ptr);
+  if (instance_ptr->host_callbacks == NULL ||
+      instance_ptr->pending == 0)
+  {
+    /* Host not attached or nothing to notify for */
+    return;
+  }
 
-      lv2dynparam_plugin_param_notify(instance_ptr, child_param_ptr);
+  /* groups first, parameters appear only in groups that already appeared */
 
-/*       if (instance_ptr->pending == 0) */
-/*       { */
-        /* optimization */
-/*         return; */
-/*       } */
-    }
-    return;
-  default:
-    assert(0);
+  list_for_each_safe(node_ptr, next_ptr, &instance_ptr->pending_groups)
+  {
+    lv2dynparam_plugin_group_notify(
+      instance_ptr,
+      list_entry(node_ptr, struct lv2dynparam_plugin_group, pending_siblings));
+  }
+
+  list_for_each_safe(node_ptr, next_ptr, &instance_ptr->pending_parameters)
+  {
+    lv2dynparam_plugin_param_notify(
+      instance_ptr,
+      list_entry(node_ptr, struct lv2dynparam_plugin_parameter, pending_siblings));
   }
 }
 
@@ -283,7 +355,7 @@ lv2dynparam_plugin_group_add(
     return false;
   }
 
-  lv2dynparam_plugin_group_notify(instance_ptr, group_ptr);
+  lv2dynparam_plugin_instance_notify(instance_ptr);
 
   *group_handle_ptr = (lv2dynparam_plugin_group)group_ptr;
 
@@ -291,3 +363,42 @@ lv2dynparam_plugin_group_add(
 
   return true;
 }
+
+bool
+lv2dynparam_plugin_group_remove(
+  lv2dynparam_plugin_instance instance_handle,
+  lv2dynparam_plugin_group group)
+{
+  struct lv2dynparam_plugin_group * group_ptr;
+
+  group_ptr = (struct lv2dynparam_plugin_group *)group;
+
+  if (group_ptr == NULL ||
+      group_ptr == &instance_ptr->root_group ||
+      group_ptr->pending == LV2DYNPARAM_PENDING_DISAPPEAR)
+  {
+    LOG_ERROR("Cannot remove root group or group that is already removed");
+    return false;
+  }
+
+  LOG_DEBUG("Removing group \"%s\"", group_ptr->name);
+
+  list_del(&group_ptr->siblings);
+
+  /* If in pending appear - host knows nothing about the group and its children, delete them right now */
+  if (group_ptr->pending == LV2DYNPARAM_PENDING_APPEAR)
+  {
+    lv2dynparam_plugin_group_free(instance_ptr, group_ptr);
+    return true;
+  }
+
+  if (instance_ptr->pending != 0)
+  {
+    lv2dynparam_plugin_group_cancel_pending(instance_ptr, group_ptr);
+  }
+
+  lv2dynparam_plugin_group_set_pending(instance_ptr, group_ptr, LV2DYNPARAM_PENDING_DISAPPEAR);
+  lv2dynparam_plugin_instance_notify(instance_ptr);
+
+  return true;
+}
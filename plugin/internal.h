@@ -23,20 +23,14 @@
 #ifndef DYNPARAM_INTERNAL_H__1A466106_9E02_4FA2_9D30_888795C93BC9__INCLUDED
 #define DYNPARAM_INTERNAL_H__1A466106_9E02_4FA2_9D30_888795C93BC9__INCLUDED
 
-#define LV2DYNPARAM_PARAMETER_TYPE_COMMAND   0
-#define LV2DYNPARAM_PARAMETER_TYPE_FLOAT     1
-#define LV2DYNPARAM_PARAMETER_TYPE_INT       2
-#define LV2DYNPARAM_PARAMETER_TYPE_NOTE      3
-#define LV2DYNPARAM_PARAMETER_TYPE_STRING    4
-#define LV2DYNPARAM_PARAMETER_TYPE_FILENAME  5
-#define LV2DYNPARAM_PARAMETER_TYPE_BOOLEAN   6
-#define LV2DYNPARAM_PARAMETER_TYPE_ENUM      7
-
 #define LV2DYNPARAM_PENDING_NOTHING    0 /* nothing pending */
 #define LV2DYNPARAM_PENDING_APPEAR     1 /* pending appear */
 #define LV2DYNPARAM_PENDING_DISAPPEAR  2 /* pending disappear */
 #define LV2DYNPARAM_PENDING_CHANGE     3 /* pending change */
 
+/* Must be power of two */
+#define LV2DYNPARAM_PLUGIN_GROUP_NAME_HASH_SIZE 64
+
 struct lv2dynparam_plugin_group
 {
   struct list_head siblings;    /* siblings in parent group child_parameters */
@@ -47,12 +41,44 @@ struct lv2dynparam_plugin_group
   char name[LV2DYNPARAM_MAX_STRING_SIZE];
   struct list_head child_groups;
   struct list_head child_parameters;
+  struct list_head child_parameters_hash[LV2DYNPARAM_PLUGIN_GROUP_NAME_HASH_SIZE]; /* child parameters by name hash */
 
   unsigned int pending;         /* One of LV2DYNPARAM_PENDING_XXX */
+  struct list_head pending_siblings; /* siblings in instance pending_groups, when pending */
+
+  bool static_node;             /* part of instance static tree, not allocated from pool */
 
   void * host_context;
 };
 
+struct lv2dynparam_plugin_parameter;
+struct lv2dynparam_plugin_loader;
+struct lv2dynparam_plugin_filename;
+
+/* Type specific parameter operations, bound when parameter type is set */
+struct lv2dynparam_plugin_parameter_type
+{
+  const char * uri;
+  size_t uri_size;              /* including the terminating zero */
+
+  void
+  (* get_value)(
+    struct lv2dynparam_plugin_parameter * param_ptr,
+    void ** value_buffer);
+
+  void
+  (* get_range)(
+    struct lv2dynparam_plugin_parameter * param_ptr,
+    void ** value_min_buffer,
+    void ** value_max_buffer);
+
+  /* call plugin callback with current value */
+  bool
+  (* change)(
+    struct lv2dynparam_plugin_parameter * param_ptr);
+};
+
+/* Commands are kept as parameters of type LV2DYNPARAM_PARAMETER_TYPE_COMMAND */
 struct lv2dynparam_plugin_parameter
 {
   struct list_head siblings;    /* siblings in parent group child_parameters */
@@ -61,7 +87,10 @@ struct lv2dynparam_plugin_parameter
 
   struct lv2dynparam_hints hints;
   unsigned int type;
+  const struct lv2dynparam_plugin_parameter_type * type_ops; /* matching type */
   char name[LV2DYNPARAM_MAX_STRING_SIZE];
+  unsigned int name_hash;
+  struct list_head hash_siblings; /* siblings in parent group child_parameters_hash bucket */
   union
   {
     struct
@@ -82,20 +111,20 @@ struct lv2dynparam_plugin_parameter
       unsigned char min;
       unsigned char max;
     } note;
-/*     char string[??]; */
-/*     char filename[??]; */
+    struct lv2dynparam_string_value string; /* buffers allocated from instance memory */
+    struct
+    {
+      struct lv2dynparam_string_value path; /* buffers allocated from instance memory */
+      struct lv2dynparam_plugin_filename * loader_ptr;
+    } filename;
     struct
     {
       char ** values;
       unsigned int values_count;
       unsigned int selected_value;
+      bool values_borrowed;     /* values are owned by plugin, not duplicated */
     } enumeration;
     unsigned char boolean;
-    struct
-    {
-      int (*callback)(void * context);
-      void * context;
-    } command;
   } data;
   union
   {
@@ -103,27 +132,44 @@ struct lv2dynparam_plugin_parameter
     lv2dynparam_plugin_param_float_changed fpoint;
     lv2dynparam_plugin_param_enum_changed enumeration;
     lv2dynparam_plugin_param_int_changed integer;
+    lv2dynparam_plugin_param_note_changed note;
+    lv2dynparam_plugin_param_string_changed string;
+    lv2dynparam_plugin_command_executed command;
   } plugin_callback;
   void * plugin_callback_context;
 
   unsigned int pending;         /* One of LV2DYNPARAM_PENDING_XXX */
+  struct list_head pending_siblings; /* siblings in instance pending_parameters, when pending */
+
+  bool static_node;             /* part of instance static tree, not allocated from pool */
 
   void * host_context;
 };
 
 struct lv2dynparam_plugin_instance
 {
-  struct list_head siblings;
+  struct list_head siblings;    /* siblings in instances registry bucket */
+  unsigned int hash;            /* instances registry bucket index */
   rtsafe_memory_handle memory;
   LV2_Handle lv2instance;
   struct lv2dynparam_plugin_group root_group;
   struct lv2dynparam_host_callbacks * host_callbacks;
   void * host_context;
 
-  unsigned int pending;
+  /* Groups and parameters with something to notify host for, in order of
+   * becoming pending, so parent groups precede their children */
+  struct list_head pending_groups;
+  struct list_head pending_parameters;
+  unsigned int pending;         /* number of pending groups and parameters */
+
+  /* Handles of static tree nodes, by index in the tree, followed by the nodes themselves */
+  void ** static_nodes;
+  unsigned int static_nodes_count;
 
   rtsafe_memory_pool_handle groups_pool;
   rtsafe_memory_pool_handle parameters_pool;
+
+  struct lv2dynparam_plugin_loader * loader_ptr; /* started by first filename parameter */
 };
 
 unsigned char
@@ -154,11 +200,21 @@ lv2dynparam_plugin_group_free(
   struct lv2dynparam_plugin_instance * instance_ptr,
   struct lv2dynparam_plugin_group * group_ptr);
 
+void
+lv2dynparam_plugin_group_set_pending(
+  struct lv2dynparam_plugin_instance * instance_ptr,
+  struct lv2dynparam_plugin_group * group_ptr,
+  unsigned int pending);
+
 void
 lv2dynparam_plugin_group_notify(
   struct lv2dynparam_plugin_instance * instance_ptr,
   struct lv2dynparam_plugin_group * group_ptr);
 
+void
+lv2dynparam_plugin_instance_notify(
+  struct lv2dynparam_plugin_instance * instance_ptr);
+
 void
 lv2dynparam_plugin_group_get_type_uri(
   lv2dynparam_group_handle group,
@@ -174,6 +230,29 @@ lv2dynparam_plugin_parameter_free(
   struct lv2dynparam_plugin_instance * instance_ptr,
   struct lv2dynparam_plugin_parameter * param_ptr);
 
+void
+lv2dynparam_plugin_param_set_type(
+  struct lv2dynparam_plugin_parameter * param_ptr,
+  unsigned int type);
+
+void
+lv2dynparam_plugin_param_set_pending(
+  struct lv2dynparam_plugin_instance * instance_ptr,
+  struct lv2dynparam_plugin_parameter * param_ptr,
+  unsigned int pending);
+
+bool
+lv2dynparam_plugin_param_descriptor_check(
+  const struct lv2dynparam_plugin_param_descriptor * descriptor_ptr);
+
+void
+lv2dynparam_plugin_param_init(
+  struct lv2dynparam_plugin_instance * instance_ptr,
+  struct lv2dynparam_plugin_parameter * param_ptr,
+  struct lv2dynparam_plugin_group * group_ptr,
+  const struct lv2dynparam_plugin_param_descriptor * descriptor_ptr,
+  void * callback_context);
+
 void
 lv2dynparam_plugin_param_notify(
   struct lv2dynparam_plugin_instance * instance_ptr,
@@ -204,4 +283,42 @@ unsigned char
 lv2dynparam_plugin_parameter_change(
   lv2dynparam_parameter_handle parameter);
 
+void
+lv2dynparam_plugin_command_get_name(
+  lv2dynparam_command_handle command,
+  char * buffer);
+
+unsigned char
+lv2dynparam_plugin_command_execute(
+  lv2dynparam_command_handle command);
+
+bool
+lv2dynparam_plugin_loader_create(
+  struct lv2dynparam_plugin_loader ** loader_ptr_ptr);
+
+void
+lv2dynparam_plugin_loader_destroy(
+  struct lv2dynparam_plugin_loader * loader_ptr);
+
+struct lv2dynparam_plugin_filename *
+lv2dynparam_plugin_loader_filename_create(
+  struct lv2dynparam_plugin_loader * loader_ptr,
+  unsigned int path_size,
+  lv2dynparam_plugin_param_filename_load load,
+  lv2dynparam_plugin_param_filename_unload unload,
+  void * context);
+
+void
+lv2dynparam_plugin_loader_request(
+  struct lv2dynparam_plugin_filename * filename_ptr,
+  const char * path);
+
+void
+lv2dynparam_plugin_loader_release(
+  struct lv2dynparam_plugin_filename * filename_ptr);
+
+void *
+lv2dynparam_plugin_loader_payload(
+  struct lv2dynparam_plugin_filename * filename_ptr);
+
 #endif /* #ifndef DYNPARAM_INTERNAL_H__1A466106_9E02_4FA2_9D30_888795C93BC9__INCLUDED */
@@ -0,0 +1,457 @@
+/* -*- Mode: C ; c-basic-offset: 2 -*- */
+/*****************************************************************************
+ *
+ *   This file is part of lv2dynparam plugin library
+ *
+ *   Copyright (C) 2006,2007,2008,2009 Nedko Arnaudov <nedko@arnaudov.name>
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; version 2 of the License
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ *****************************************************************************/
+
+/* Loader thread of filename parameters. Audio thread never waits for it:
+ * requested paths are passed through seqlock protected buffer, loaded
+ * payloads are published by pointer swap and the loader is woken up
+ * with sem_post(). Everything else, including loads, unloads and memory
+ * management of the loader side state, happens on the loader thread. */
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <sched.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <lv2.h>
+
+#include "../lv2dynparam.h"
+#include "plugin.h"
+#include "../list.h"
+#include "../memory_atomic.h"
+#include "internal.h"
+
+//#define LOG_LEVEL LOG_LEVEL_DEBUG
+#include "../log.h"
+
+struct lv2dynparam_plugin_loader
+{
+  pthread_t thread;
+  sem_t wakeup;
+  bool quit;
+
+  pthread_mutex_t mutex;
+  struct list_head new_filenames; /* protected by mutex */
+
+  struct list_head filenames;   /* loader thread only */
+  char path[LV2DYNPARAM_PLUGIN_STRING_MAX_SIZE]; /* loader thread only */
+};
+
+/* Loader side state of filename parameter, allocated on non-audio thread
+ * and freed by the loader thread once parameter releases it */
+struct lv2dynparam_plugin_filename
+{
+  struct list_head siblings;    /* siblings in loader new_filenames or filenames */
+  struct lv2dynparam_plugin_loader * loader_ptr;
+
+  lv2dynparam_plugin_param_filename_load load;
+  lv2dynparam_plugin_param_filename_unload unload;
+  void * context;
+
+  /* requested path, written by audio thread, sequence is odd while writing */
+  char * path;
+  unsigned int path_size;
+  volatile unsigned int path_sequence;
+  unsigned int loaded_path_sequence; /* loader thread only */
+
+  /* published payload, sequence is incremented after payload is replaced */
+  void * volatile payload;
+  volatile unsigned int publish_sequence;
+  volatile unsigned int seen_sequence; /* last publish_sequence seen by audio thread */
+  struct list_head retired;     /* loader thread only */
+
+  volatile int dead;            /* parameter is gone, set by audio thread */
+};
+
+/* Payload replaced by newer one, waiting for audio thread to move on */
+struct lv2dynparam_plugin_loader_retired
+{
+  struct list_head siblings;
+  void * payload;
+  unsigned int sequence;        /* publish_sequence of the payload that replaced it */
+};
+
+static
+void
+lv2dynparam_plugin_loader_read_path(
+  struct lv2dynparam_plugin_loader * loader_ptr,
+  struct lv2dynparam_plugin_filename * filename_ptr,
+  unsigned int * sequence_ptr)
+{
+  unsigned int sequence;
+
+  for (;;)
+  {
+    sequence = filename_ptr->path_sequence;
+    if ((sequence & 1) != 0)
+    {
+      /* audio thread is writing it right now */
+      sched_yield();
+      continue;
+    }
+
+    __sync_synchronize();
+    memcpy(loader_ptr->path, filename_ptr->path, filename_ptr->path_size);
+    __sync_synchronize();
+
+    if (sequence == filename_ptr->path_sequence)
+    {
+      break;
+    }
+  }
+
+  loader_ptr->path[filename_ptr->path_size - 1] = 0;
+  *sequence_ptr = sequence;
+}
+
+static
+void
+lv2dynparam_plugin_loader_publish(
+  struct lv2dynparam_plugin_filename * filename_ptr,
+  void * payload)
+{
+  struct lv2dynparam_plugin_loader_retired * retired_ptr;
+
+  if (filename_ptr->payload != NULL)
+  {
+    retired_ptr = malloc(sizeof(struct lv2dynparam_plugin_loader_retired));
+    if (retired_ptr == NULL)
+    {
+      LOG_ERROR("failed to allocate memory for retired payload, keeping old one");
+
+      if (payload != NULL)
+      {
+        filename_ptr->unload(filename_ptr->context, payload);
+      }
+
+      return;
+    }
+
+    retired_ptr->payload = filename_ptr->payload;
+    retired_ptr->sequence = filename_ptr->publish_sequence + 1;
+    list_add_tail(&retired_ptr->siblings, &filename_ptr->retired);
+  }
+
+  filename_ptr->payload = payload;
+  __sync_synchronize();
+  filename_ptr->publish_sequence++;
+}
+
+static
+void
+lv2dynparam_plugin_loader_unload_retired(
+  struct lv2dynparam_plugin_filename * filename_ptr,
+  bool all)
+{
+  struct list_head * node_ptr;
+  struct list_head * next_ptr;
+  struct lv2dynparam_plugin_loader_retired * retired_ptr;
+
+  list_for_each_safe(node_ptr, next_ptr, &filename_ptr->retired)
+  {
+    retired_ptr = list_entry(node_ptr, struct lv2dynparam_plugin_loader_retired, siblings);
+
+    /* wraparound safe "audio thread has seen the replacement" */
+    if (!all && (int)(filename_ptr->seen_sequence - retired_ptr->sequence) < 0)
+    {
+      continue;
+    }
+
+    filename_ptr->unload(filename_ptr->context, retired_ptr->payload);
+    list_del(node_ptr);
+    free(retired_ptr);
+  }
+}
+
+static
+void
+lv2dynparam_plugin_loader_free_filename(
+  struct lv2dynparam_plugin_filename * filename_ptr)
+{
+  lv2dynparam_plugin_loader_unload_retired(filename_ptr, true);
+
+  if (filename_ptr->payload != NULL)
+  {
+    filename_ptr->unload(filename_ptr->context, filename_ptr->payload);
+  }
+
+  list_del(&filename_ptr->siblings);
+  free(filename_ptr->path);
+  free(filename_ptr);
+}
+
+static
+void
+lv2dynparam_plugin_loader_process(
+  struct lv2dynparam_plugin_loader * loader_ptr,
+  struct lv2dynparam_plugin_filename * filename_ptr)
+{
+  unsigned int sequence;
+  void * payload;
+
+  if (filename_ptr->dead)
+  {
+    lv2dynparam_plugin_loader_free_filename(filename_ptr);
+    return;
+  }
+
+  lv2dynparam_plugin_loader_read_path(loader_ptr, filename_ptr, &sequence);
+  if (sequence != filename_ptr->loaded_path_sequence)
+  {
+    filename_ptr->loaded_path_sequence = sequence;
+
+    if (loader_ptr->path[0] == 0)
+    {
+      lv2dynparam_plugin_loader_publish(filename_ptr, NULL);
+    }
+    else
+    {
+      LOG_DEBUG("Loading \"%s\"", loader_ptr->path);
+
+      payload = filename_ptr->load(filename_ptr->context, loader_ptr->path);
+      if (payload == NULL)
+      {
+        LOG_ERROR("Loading of \"%s\" failed, keeping previous payload", loader_ptr->path);
+      }
+      else
+      {
+        lv2dynparam_plugin_loader_publish(filename_ptr, payload);
+      }
+    }
+  }
+
+  lv2dynparam_plugin_loader_unload_retired(filename_ptr, false);
+}
+
+static
+void *
+lv2dynparam_plugin_loader_thread(
+  void * context)
+{
+  struct lv2dynparam_plugin_loader * loader_ptr;
+  struct list_head * node_ptr;
+  struct list_head * next_ptr;
+
+  loader_ptr = context;
+
+  for (;;)
+  {
+    if (sem_wait(&loader_ptr->wakeup) != 0)
+    {
+      assert(errno == EINTR);
+      continue;
+    }
+
+    if (loader_ptr->quit)
+    {
+      break;
+    }
+
+    pthread_mutex_lock(&loader_ptr->mutex);
+    list_splice_init(&loader_ptr->new_filenames, loader_ptr->filenames.prev);
+    pthread_mutex_unlock(&loader_ptr->mutex);
+
+    /* wakeups are not counted per parameter, check all of them */
+    list_for_each_safe(node_ptr, next_ptr, &loader_ptr->filenames)
+    {
+      lv2dynparam_plugin_loader_process(
+        loader_ptr,
+        list_entry(node_ptr, struct lv2dynparam_plugin_filename, siblings));
+    }
+  }
+
+  return NULL;
+}
+
+bool
+lv2dynparam_plugin_loader_create(
+  struct lv2dynparam_plugin_loader ** loader_ptr_ptr)
+{
+  struct lv2dynparam_plugin_loader * loader_ptr;
+  int ret;
+
+  loader_ptr = malloc(sizeof(struct lv2dynparam_plugin_loader));
+  if (loader_ptr == NULL)
+  {
+    LOG_ERROR("failed to allocate memory for loader");
+    goto fail;
+  }
+
+  if (sem_init(&loader_ptr->wakeup, 0, 0) != 0)
+  {
+    LOG_ERROR("failed to initialize loader semaphore");
+    goto fail_free;
+  }
+
+  pthread_mutex_init(&loader_ptr->mutex, NULL);
+  INIT_LIST_HEAD(&loader_ptr->new_filenames);
+  INIT_LIST_HEAD(&loader_ptr->filenames);
+  loader_ptr->quit = false;
+
+  ret = pthread_create(&loader_ptr->thread, NULL, lv2dynparam_plugin_loader_thread, loader_ptr);
+  if (ret != 0)
+  {
+    LOG_ERROR("failed to start loader thread (%d)", ret);
+    goto fail_destroy;
+  }
+
+  *loader_ptr_ptr = loader_ptr;
+
+  return true;
+
+fail_destroy:
+  pthread_mutex_destroy(&loader_ptr->mutex);
+  sem_destroy(&loader_ptr->wakeup);
+
+fail_free:
+  free(loader_ptr);
+
+fail:
+  return false;
+}
+
+void
+lv2dynparam_plugin_loader_destroy(
+  struct lv2dynparam_plugin_loader * loader_ptr)
+{
+  loader_ptr->quit = true;
+  sem_post(&loader_ptr->wakeup);
+  pthread_join(loader_ptr->thread, NULL);
+
+  /* parameters are already freed, release what they left */
+  list_splice_init(&loader_ptr->new_filenames, loader_ptr->filenames.prev);
+  while (!list_empty(&loader_ptr->filenames))
+  {
+    lv2dynparam_plugin_loader_free_filename(
+      list_entry(loader_ptr->filenames.next, struct lv2dynparam_plugin_filename, siblings));
+  }
+
+  pthread_mutex_destroy(&loader_ptr->mutex);
+  sem_destroy(&loader_ptr->wakeup);
+  free(loader_ptr);
+}
+
+struct lv2dynparam_plugin_filename *
+lv2dynparam_plugin_loader_filename_create(
+  struct lv2dynparam_plugin_loader * loader_ptr,
+  unsigned int path_size,
+  lv2dynparam_plugin_param_filename_load load,
+  lv2dynparam_plugin_param_filename_unload unload,
+  void * context)
+{
+  struct lv2dynparam_plugin_filename * filename_ptr;
+
+  filename_ptr = malloc(sizeof(struct lv2dynparam_plugin_filename));
+  if (filename_ptr == NULL)
+  {
+    goto fail;
+  }
+
+  filename_ptr->path = malloc(path_size);
+  if (filename_ptr->path == NULL)
+  {
+    goto fail_free;
+  }
+
+  filename_ptr->loader_ptr = loader_ptr;
+  filename_ptr->path[0] = 0;
+  filename_ptr->path_size = path_size;
+  filename_ptr->path_sequence = 0;
+  filename_ptr->loaded_path_sequence = 0;
+
+  filename_ptr->load = load;
+  filename_ptr->unload = unload;
+  filename_ptr->context = context;
+
+  filename_ptr->payload = NULL;
+  filename_ptr->publish_sequence = 0;
+  filename_ptr->seen_sequence = 0;
+  INIT_LIST_HEAD(&filename_ptr->retired);
+  filename_ptr->dead = 0;
+
+  pthread_mutex_lock(&loader_ptr->mutex);
+  list_add_tail(&filename_ptr->siblings, &loader_ptr->new_filenames);
+  pthread_mutex_unlock(&loader_ptr->mutex);
+
+  return filename_ptr;
+
+fail_free:
+  free(filename_ptr);
+
+fail:
+  LOG_ERROR("failed to allocate memory for filename parameter loader state");
+  return NULL;
+}
+
+/* Called from audio thread */
+void
+lv2dynparam_plugin_loader_request(
+  struct lv2dynparam_plugin_filename * filename_ptr,
+  const char * path)
+{
+  size_t len;
+
+  len = strlen(path);
+  assert(len < filename_ptr->path_size);
+
+  filename_ptr->path_sequence++;
+  __sync_synchronize();
+  memcpy(filename_ptr->path, path, len + 1);
+  __sync_synchronize();
+  filename_ptr->path_sequence++;
+
+  sem_post(&filename_ptr->loader_ptr->wakeup);
+}
+
+/* Called from audio thread, loader frees the state and unloads payloads */
+void
+lv2dynparam_plugin_loader_release(
+  struct lv2dynparam_plugin_filename * filename_ptr)
+{
+  __sync_synchronize();
+  filename_ptr->dead = 1;
+  sem_post(&filename_ptr->loader_ptr->wakeup);
+}
+
+/* Called from audio thread */
+void *
+lv2dynparam_plugin_loader_payload(
+  struct lv2dynparam_plugin_filename * filename_ptr)
+{
+  unsigned int sequence;
+  void * payload;
+
+  sequence = filename_ptr->publish_sequence;
+  __sync_synchronize();
+  payload = filename_ptr->payload;
+
+  if (sequence != filename_ptr->seen_sequence)
+  {
+    /* payloads published before this one are not used anymore */
+    filename_ptr->seen_sequence = sequence;
+    sem_post(&filename_ptr->loader_ptr->wakeup);
+  }
+
+  return payload;
+}
@@ -43,63 +43,354 @@ lv2dynparam_plugin_parameter_free(
 {
   LOG_DEBUG("Freeing parameter \"%s\"", param_ptr->name);
 
+  lv2dynparam_plugin_param_set_pending(instance_ptr, param_ptr, LV2DYNPARAM_PENDING_NOTHING);
+  list_del(&param_ptr->hash_siblings);
+
   switch (param_ptr->type)
   {
   case LV2DYNPARAM_PARAMETER_TYPE_ENUM:
+    if (param_ptr->data.enumeration.values_borrowed)
+    {
+      break;
+    }
+
     lv2dynparam_enum_free(
       instance_ptr->memory,
       param_ptr->data.enumeration.values,
       param_ptr->data.enumeration.values_count);
     break;
+  case LV2DYNPARAM_PARAMETER_TYPE_STRING:
+    rtsafe_memory_deallocate(param_ptr->data.string.value);
+    rtsafe_memory_deallocate(param_ptr->data.string.pending);
+    break;
+  case LV2DYNPARAM_PARAMETER_TYPE_FILENAME:
+    lv2dynparam_plugin_loader_release(param_ptr->data.filename.loader_ptr);
+    rtsafe_memory_deallocate(param_ptr->data.filename.path.value);
+    rtsafe_memory_deallocate(param_ptr->data.filename.path.pending);
+    break;
   }
 
   lv2dynparam_hints_clear(&param_ptr->hints);
-  rtsafe_memory_pool_deallocate(instance_ptr->parameters_pool, param_ptr);
+
+  if (!param_ptr->static_node)
+  {
+    rtsafe_memory_pool_deallocate(instance_ptr->parameters_pool, param_ptr);
+  }
 }
 
-#define parameter_ptr ((struct lv2dynparam_plugin_parameter *)parameter)
+static
+void
+lv2dynparam_plugin_param_no_range(
+  struct lv2dynparam_plugin_parameter * param_ptr,
+  void ** value_min_buffer,
+  void ** value_max_buffer)
+{
+}
 
+static
 void
-lv2dynparam_plugin_parameter_get_type_uri(
-  lv2dynparam_parameter_handle parameter,
-  char * buffer)
+lv2dynparam_plugin_param_float_get_value(
+  struct lv2dynparam_plugin_parameter * param_ptr,
+  void ** value_buffer)
 {
-  size_t s;
-  const char * uri;
+  *value_buffer = &param_ptr->data.fpoint.value;
+}
+
+static
+void
+lv2dynparam_plugin_param_float_get_range(
+  struct lv2dynparam_plugin_parameter * param_ptr,
+  void ** value_min_buffer,
+  void ** value_max_buffer)
+{
+  *value_min_buffer = &param_ptr->data.fpoint.min;
+  *value_max_buffer = &param_ptr->data.fpoint.max;
+}
+
+static
+bool
+lv2dynparam_plugin_param_float_dispatch(
+  struct lv2dynparam_plugin_parameter * param_ptr)
+{
+  return param_ptr->plugin_callback.fpoint(
+    param_ptr->plugin_callback_context,
+    param_ptr->data.fpoint.value);
+}
+
+static
+void
+lv2dynparam_plugin_param_int_get_value(
+  struct lv2dynparam_plugin_parameter * param_ptr,
+  void ** value_buffer)
+{
+  *value_buffer = &param_ptr->data.integer.value;
+}
+
+static
+void
+lv2dynparam_plugin_param_int_get_range(
+  struct lv2dynparam_plugin_parameter * param_ptr,
+  void ** value_min_buffer,
+  void ** value_max_buffer)
+{
+  *value_min_buffer = &param_ptr->data.integer.min;
+  *value_max_buffer = &param_ptr->data.integer.max;
+}
+
+static
+bool
+lv2dynparam_plugin_param_int_dispatch(
+  struct lv2dynparam_plugin_parameter * param_ptr)
+{
+  return param_ptr->plugin_callback.integer(
+    param_ptr->plugin_callback_context,
+    param_ptr->data.integer.value);
+}
+
+static
+void
+lv2dynparam_plugin_param_note_get_value(
+  struct lv2dynparam_plugin_parameter * param_ptr,
+  void ** value_buffer)
+{
+  *value_buffer = &param_ptr->data.note.value;
+}
+
+static
+void
+lv2dynparam_plugin_param_note_get_range(
+  struct lv2dynparam_plugin_parameter * param_ptr,
+  void ** value_min_buffer,
+  void ** value_max_buffer)
+{
+  *value_min_buffer = &param_ptr->data.note.min;
+  *value_max_buffer = &param_ptr->data.note.max;
+}
+
+static
+bool
+lv2dynparam_plugin_param_note_dispatch(
+  struct lv2dynparam_plugin_parameter * param_ptr)
+{
+  return param_ptr->plugin_callback.note(
+    param_ptr->plugin_callback_context,
+    param_ptr->data.note.value);
+}
 
-  switch (parameter_ptr->type)
+/* MIDI note numbers are 0-127 */
+static
+bool
+lv2dynparam_plugin_param_note_check(
+  const char * name,
+  unsigned char value,
+  unsigned char min,
+  unsigned char max)
+{
+  if (min > max || max > 127 || value < min || value > max)
   {
-  case LV2DYNPARAM_PARAMETER_TYPE_FLOAT:
-    uri = LV2DYNPARAM_PARAMETER_TYPE_FLOAT_URI;
-    break;
-  case LV2DYNPARAM_PARAMETER_TYPE_INT:
-    uri = LV2DYNPARAM_PARAMETER_TYPE_INT_URI;
-    break;
-  case LV2DYNPARAM_PARAMETER_TYPE_NOTE:
-    uri = LV2DYNPARAM_PARAMETER_TYPE_NOTE_URI;
-    break;
-  case LV2DYNPARAM_PARAMETER_TYPE_STRING:
-    uri = LV2DYNPARAM_PARAMETER_TYPE_STRING_URI;
-    break;
-  case LV2DYNPARAM_PARAMETER_TYPE_FILENAME:
-    uri = LV2DYNPARAM_PARAMETER_TYPE_FILENAME_URI;
-    break;
-  case LV2DYNPARAM_PARAMETER_TYPE_BOOLEAN:
-    uri = LV2DYNPARAM_PARAMETER_TYPE_BOOLEAN_URI;
-    break;
-  case LV2DYNPARAM_PARAMETER_TYPE_ENUM:
-    uri = LV2DYNPARAM_PARAMETER_TYPE_ENUM_URI;
-    break;
-  default:
-    assert(0);
-    return;
+    LOG_ERROR("Invalid value %u or range %u-%u of note parameter \"%s\"", value, min, max, name);
+    return false;
   }
 
-  s = strlen(uri) + 1;
+  return true;
+}
 
-  assert(s <= LV2DYNPARAM_MAX_STRING_SIZE);
+static
+void
+lv2dynparam_plugin_param_boolean_get_value(
+  struct lv2dynparam_plugin_parameter * param_ptr,
+  void ** value_buffer)
+{
+  *value_buffer = &param_ptr->data.boolean;
+}
+
+static
+bool
+lv2dynparam_plugin_param_boolean_dispatch(
+  struct lv2dynparam_plugin_parameter * param_ptr)
+{
+  return param_ptr->plugin_callback.boolean(
+    param_ptr->plugin_callback_context,
+    param_ptr->data.boolean);
+}
+
+static
+void
+lv2dynparam_plugin_param_enum_get_value(
+  struct lv2dynparam_plugin_parameter * param_ptr,
+  void ** value_buffer)
+{
+  *value_buffer = &param_ptr->data.enumeration.selected_value;
+}
+
+static
+void
+lv2dynparam_plugin_param_enum_get_range(
+  struct lv2dynparam_plugin_parameter * param_ptr,
+  void ** value_min_buffer,
+  void ** value_max_buffer)
+{
+  *value_min_buffer = &param_ptr->data.enumeration.values;
+  *value_max_buffer = &param_ptr->data.enumeration.values_count;
+}
+
+static
+bool
+lv2dynparam_plugin_param_enum_dispatch(
+  struct lv2dynparam_plugin_parameter * param_ptr)
+{
+  return param_ptr->plugin_callback.enumeration(
+    param_ptr->plugin_callback_context,
+    param_ptr->data.enumeration.values[param_ptr->data.enumeration.selected_value],
+    param_ptr->data.enumeration.selected_value);
+}
+
+static
+void
+lv2dynparam_plugin_param_string_get_value(
+  struct lv2dynparam_plugin_parameter * param_ptr,
+  void ** value_buffer)
+{
+  *value_buffer = &param_ptr->data.string;
+}
+
+/* Swap buffers, so host never writes the current value */
+static
+void
+lv2dynparam_plugin_param_string_swap(
+  struct lv2dynparam_string_value * string_ptr)
+{
+  char * value;
+
+  value = string_ptr->pending;
+  string_ptr->pending = string_ptr->value;
+  string_ptr->value = value;
+}
+
+static
+bool
+lv2dynparam_plugin_param_string_dispatch(
+  struct lv2dynparam_plugin_parameter * param_ptr)
+{
+  /* host stored the new value in pending buffer */
+  lv2dynparam_plugin_param_string_swap(&param_ptr->data.string);
+
+  return param_ptr->plugin_callback.string(
+    param_ptr->plugin_callback_context,
+    param_ptr->data.string.value);
+}
+
+static
+void
+lv2dynparam_plugin_param_filename_get_value(
+  struct lv2dynparam_plugin_parameter * param_ptr,
+  void ** value_buffer)
+{
+  *value_buffer = &param_ptr->data.filename.path;
+}
+
+static
+bool
+lv2dynparam_plugin_param_filename_dispatch(
+  struct lv2dynparam_plugin_parameter * param_ptr)
+{
+  lv2dynparam_plugin_param_string_swap(&param_ptr->data.filename.path);
+
+  /* loading is done by the loader thread, plugin gets the payload later */
+  lv2dynparam_plugin_loader_request(
+    param_ptr->data.filename.loader_ptr,
+    param_ptr->data.filename.path.value);
+
+  return true;
+}
+
+static
+bool
+lv2dynparam_plugin_command_dispatch(
+  struct lv2dynparam_plugin_parameter * param_ptr)
+{
+  return param_ptr->plugin_callback.command(param_ptr->plugin_callback_context);
+}
+
+#define LV2DYNPARAM_PLUGIN_PARAMETER_TYPE(uri_str, get_value_func, get_range_func, change_func) \
+  {                                                                                              \
+    .uri = uri_str,                                                                              \
+    .uri_size = sizeof(uri_str),                                                                 \
+    .get_value = get_value_func,                                                                 \
+    .get_range = get_range_func,                                                                 \
+    .change = change_func                                                                        \
+  }
+
+/* Indexed by LV2DYNPARAM_PARAMETER_TYPE_XXX, commands have no type URI, value or range */
+static const struct lv2dynparam_plugin_parameter_type g_lv2dynparam_plugin_parameter_types[] =
+{
+  [LV2DYNPARAM_PARAMETER_TYPE_COMMAND] =
+  {
+    .uri = NULL,
+    .uri_size = 0,
+    .get_value = NULL,
+    .get_range = NULL,
+    .change = lv2dynparam_plugin_command_dispatch
+  },
+  [LV2DYNPARAM_PARAMETER_TYPE_FLOAT] = LV2DYNPARAM_PLUGIN_PARAMETER_TYPE(
+    LV2DYNPARAM_PARAMETER_TYPE_FLOAT_URI,
+    lv2dynparam_plugin_param_float_get_value,
+    lv2dynparam_plugin_param_float_get_range,
+    lv2dynparam_plugin_param_float_dispatch),
+  [LV2DYNPARAM_PARAMETER_TYPE_INT] = LV2DYNPARAM_PLUGIN_PARAMETER_TYPE(
+    LV2DYNPARAM_PARAMETER_TYPE_INT_URI,
+    lv2dynparam_plugin_param_int_get_value,
+    lv2dynparam_plugin_param_int_get_range,
+    lv2dynparam_plugin_param_int_dispatch),
+  [LV2DYNPARAM_PARAMETER_TYPE_NOTE] = LV2DYNPARAM_PLUGIN_PARAMETER_TYPE(
+    LV2DYNPARAM_PARAMETER_TYPE_NOTE_URI,
+    lv2dynparam_plugin_param_note_get_value,
+    lv2dynparam_plugin_param_note_get_range,
+    lv2dynparam_plugin_param_note_dispatch),
+  [LV2DYNPARAM_PARAMETER_TYPE_STRING] = LV2DYNPARAM_PLUGIN_PARAMETER_TYPE(
+    LV2DYNPARAM_PARAMETER_TYPE_STRING_URI,
+    lv2dynparam_plugin_param_string_get_value,
+    lv2dynparam_plugin_param_no_range,
+    lv2dynparam_plugin_param_string_dispatch),
+  [LV2DYNPARAM_PARAMETER_TYPE_FILENAME] = LV2DYNPARAM_PLUGIN_PARAMETER_TYPE(
+    LV2DYNPARAM_PARAMETER_TYPE_FILENAME_URI,
+    lv2dynparam_plugin_param_filename_get_value,
+    lv2dynparam_plugin_param_no_range,
+    lv2dynparam_plugin_param_filename_dispatch),
+  [LV2DYNPARAM_PARAMETER_TYPE_BOOLEAN] = LV2DYNPARAM_PLUGIN_PARAMETER_TYPE(
+    LV2DYNPARAM_PARAMETER_TYPE_BOOLEAN_URI,
+    lv2dynparam_plugin_param_boolean_get_value,
+    lv2dynparam_plugin_param_no_range,
+    lv2dynparam_plugin_param_boolean_dispatch),
+  [LV2DYNPARAM_PARAMETER_TYPE_ENUM] = LV2DYNPARAM_PLUGIN_PARAMETER_TYPE(
+    LV2DYNPARAM_PARAMETER_TYPE_ENUM_URI,
+    lv2dynparam_plugin_param_enum_get_value,
+    lv2dynparam_plugin_param_enum_get_range,
+    lv2dynparam_plugin_param_enum_dispatch),
+};
+
+void
+lv2dynparam_plugin_param_set_type(
+  struct lv2dynparam_plugin_parameter * param_ptr,
+  unsigned int type)
+{
+  assert(type < sizeof(g_lv2dynparam_plugin_parameter_types) / sizeof(g_lv2dynparam_plugin_parameter_types[0]));
+  assert(g_lv2dynparam_plugin_parameter_types[type].change != NULL);
+
+  param_ptr->type = type;
+  param_ptr->type_ops = g_lv2dynparam_plugin_parameter_types + type;
+}
 
-  memcpy(buffer, uri, s);
+#define parameter_ptr ((struct lv2dynparam_plugin_parameter *)parameter)
+
+void
+lv2dynparam_plugin_parameter_get_type_uri(
+  lv2dynparam_parameter_handle parameter,
+  char * buffer)
+{
+  assert(parameter_ptr->type_ops->uri_size <= LV2DYNPARAM_MAX_STRING_SIZE);
+
+  memcpy(buffer, parameter_ptr->type_ops->uri, parameter_ptr->type_ops->uri_size);
 }
 
 void
@@ -121,28 +412,7 @@ lv2dynparam_plugin_parameter_get_value(
   lv2dynparam_parameter_handle parameter,
   void ** value_buffer)
 {
-  switch (parameter_ptr->type)
-  {
-  case LV2DYNPARAM_PARAMETER_TYPE_FLOAT:
-    *value_buffer = &parameter_ptr->data.fpoint.value;
-    return;
-  case LV2DYNPARAM_PARAMETER_TYPE_INT:
-    *value_buffer = &parameter_ptr->data.integer.value;
-    return;
-  case LV2DYNPARAM_PARAMETER_TYPE_NOTE:
-    *value_buffer = &parameter_ptr->data.note.value;
-    return;
-  case LV2DYNPARAM_PARAMETER_TYPE_STRING:
-    return;
-  case LV2DYNPARAM_PARAMETER_TYPE_FILENAME:
-    return;
-  case LV2DYNPARAM_PARAMETER_TYPE_BOOLEAN:
-    *value_buffer = &parameter_ptr->data.boolean;
-    return;
-  case LV2DYNPARAM_PARAMETER_TYPE_ENUM:
-    *value_buffer = &parameter_ptr->data.enumeration.selected_value;
-    return;
-  }
+  parameter_ptr->type_ops->get_value(parameter_ptr, value_buffer);
 }
 
 void
@@ -151,25 +421,7 @@ lv2dynparam_plugin_parameter_get_range(
   void ** value_min_buffer,
   void ** value_max_buffer)
 {
-  switch (parameter_ptr->type)
-  {
-  case LV2DYNPARAM_PARAMETER_TYPE_FLOAT:
-    *value_min_buffer = &parameter_ptr->data.fpoint.min;
-    *value_max_buffer = &parameter_ptr->data.fpoint.max;
-    return;
-  case LV2DYNPARAM_PARAMETER_TYPE_INT:
-    *value_min_buffer = &parameter_ptr->data.integer.min;
-    *value_max_buffer = &parameter_ptr->data.integer.max;
-    return;
-  case LV2DYNPARAM_PARAMETER_TYPE_NOTE:
-    *value_min_buffer = &parameter_ptr->data.note.min;
-    *value_max_buffer = &parameter_ptr->data.note.max;
-    return;
-  case LV2DYNPARAM_PARAMETER_TYPE_ENUM:
-    *value_min_buffer = &parameter_ptr->data.enumeration.values;
-    *value_max_buffer = &parameter_ptr->data.enumeration.values_count;
-    return;
-  }
+  parameter_ptr->type_ops->get_range(parameter_ptr, value_min_buffer, value_max_buffer);
 }
 
 unsigned char
@@ -178,63 +430,56 @@ lv2dynparam_plugin_parameter_change(
 {
   //LOG_DEBUG("lv2dynparam_plugin_parameter_change() called.");
 
-  switch (parameter_ptr->type)
-  {
-  case LV2DYNPARAM_PARAMETER_TYPE_FLOAT:
-    if (!parameter_ptr->plugin_callback.fpoint(
-          parameter_ptr->plugin_callback_context,
-          parameter_ptr->data.fpoint.value))
-    {
-      return false;
-    }
-
-    return true;
-
-  case LV2DYNPARAM_PARAMETER_TYPE_INT:
-    if (!parameter_ptr->plugin_callback.integer(
-          parameter_ptr->plugin_callback_context,
-          parameter_ptr->data.integer.value))
-    {
-      return false;
-    }
-
-    return true;
+  return parameter_ptr->type_ops->change(parameter_ptr);
+}
 
-  case LV2DYNPARAM_PARAMETER_TYPE_NOTE:
-    return true;
+#undef parameter_ptr
+#define parameter_ptr ((struct lv2dynparam_plugin_parameter *)command)
 
-  case LV2DYNPARAM_PARAMETER_TYPE_STRING:
-    return true;
+void
+lv2dynparam_plugin_command_get_name(
+  lv2dynparam_command_handle command,
+  char * buffer)
+{
+  assert(parameter_ptr->type == LV2DYNPARAM_PARAMETER_TYPE_COMMAND);
 
-  case LV2DYNPARAM_PARAMETER_TYPE_FILENAME:
-    return true;
+  lv2dynparam_plugin_parameter_get_name(command, buffer);
+}
 
-  case LV2DYNPARAM_PARAMETER_TYPE_BOOLEAN:
-    if (!parameter_ptr->plugin_callback.boolean(
-          parameter_ptr->plugin_callback_context,
-          parameter_ptr->data.boolean))
-    {
-      return false;
-    }
+unsigned char
+lv2dynparam_plugin_command_execute(
+  lv2dynparam_command_handle command)
+{
+  LOG_DEBUG("Executing command \"%s\"", parameter_ptr->name);
 
-    return true;
+  assert(parameter_ptr->type == LV2DYNPARAM_PARAMETER_TYPE_COMMAND);
 
-  case LV2DYNPARAM_PARAMETER_TYPE_ENUM:
-    if (!parameter_ptr->plugin_callback.enumeration(
-          parameter_ptr->plugin_callback_context,
-          parameter_ptr->data.enumeration.values[parameter_ptr->data.enumeration.selected_value],
-          parameter_ptr->data.enumeration.selected_value))
-    {
-      return false;
-    }
+  return parameter_ptr->type_ops->change(parameter_ptr);
+}
 
-    return true;
+#undef parameter_ptr
+#define parameter_ptr ((struct lv2dynparam_plugin_parameter *)parameter)
 
-  default:
-    assert(0);
+void
+lv2dynparam_plugin_param_set_pending(
+  struct lv2dynparam_plugin_instance * instance_ptr,
+  struct lv2dynparam_plugin_parameter * param_ptr,
+  unsigned int pending)
+{
+  if (param_ptr->pending == LV2DYNPARAM_PENDING_NOTHING &&
+      pending != LV2DYNPARAM_PENDING_NOTHING)
+  {
+    list_add_tail(&param_ptr->pending_siblings, &instance_ptr->pending_parameters);
+    instance_ptr->pending++;
+  }
+  else if (param_ptr->pending != LV2DYNPARAM_PENDING_NOTHING &&
+           pending == LV2DYNPARAM_PENDING_NOTHING)
+  {
+    list_del(&param_ptr->pending_siblings);
+    instance_ptr->pending--;
   }
 
-  return true;
+  param_ptr->pending = pending;
 }
 
 void
@@ -242,6 +487,8 @@ lv2dynparam_plugin_param_notify(
   struct lv2dynparam_plugin_instance * instance_ptr,
   struct lv2dynparam_plugin_parameter * param_ptr)
 {
+  bool disappeared;
+
   if (instance_ptr->host_callbacks == NULL)
   {
     /* Host not attached */
@@ -254,33 +501,322 @@ lv2dynparam_plugin_param_notify(
     /* There is nothing to notify for */
     return;
   case LV2DYNPARAM_PENDING_APPEAR:
+    if (param_ptr->group_ptr->pending == LV2DYNPARAM_PENDING_APPEAR)
+    {
+      /* Group has not appeared yet, host will be notified after it */
+      return;
+    }
+
 /*     LOG_DEBUG("Appearing %s", param_ptr->name); */
-    if (instance_ptr->host_callbacks->parameter_appear(
+    if (param_ptr->type == LV2DYNPARAM_PARAMETER_TYPE_COMMAND)
+    {
+      if (instance_ptr->host_callbacks->command_appear(
+            instance_ptr->host_context,
+            param_ptr->group_ptr->host_context,
+            param_ptr,
+            &param_ptr->hints,
+            &param_ptr->host_context))
+      {
+        lv2dynparam_plugin_param_set_pending(instance_ptr, param_ptr, LV2DYNPARAM_PENDING_NOTHING);
+      }
+    }
+    else if (instance_ptr->host_callbacks->parameter_appear(
           instance_ptr->host_context,
           param_ptr->group_ptr->host_context,
           param_ptr,
           &param_ptr->hints,
           &param_ptr->host_context))
     {
-      param_ptr->pending = LV2DYNPARAM_PENDING_NOTHING;
-      instance_ptr->pending--;
+      lv2dynparam_plugin_param_set_pending(instance_ptr, param_ptr, LV2DYNPARAM_PENDING_NOTHING);
     }
     return;
-  case LV2DYNPARAM_PENDING_DISAPPEAR:
-/*     LOG_DEBUG("Disappering %s", param_ptr->name); */
-    if (instance_ptr->host_callbacks->parameter_disappear(
+  case LV2DYNPARAM_PENDING_CHANGE:
+    /* Pending disappear was cancelled by adding parameter with same name and type,
+       host still has it but value may have been changed by the re-add */
+    if (instance_ptr->host_callbacks->parameter_change(
           instance_ptr->host_context,
           param_ptr->host_context))
     {
-      param_ptr->pending = LV2DYNPARAM_PENDING_NOTHING;
-      list_del(&param_ptr->siblings);
-      instance_ptr->pending--;
-      lv2dynparam_plugin_parameter_free(instance_ptr, param_ptr);
+      lv2dynparam_plugin_param_set_pending(instance_ptr, param_ptr, LV2DYNPARAM_PENDING_NOTHING);
     }
     return;
-  default:
+  case LV2DYNPARAM_PENDING_DISAPPEAR:
+/*     LOG_DEBUG("Disappering %s", param_ptr->name); */
+    if (param_ptr->type == LV2DYNPARAM_PARAMETER_TYPE_COMMAND)
+    {
+      disappeared = instance_ptr->host_callbacks->command_disappear(
+        instance_ptr->host_context,
+        param_ptr->host_context);
+    }
+    else
+    {
+      disappeared = instance_ptr->host_callbacks->parameter_disappear(
+        instance_ptr->host_context,
+        param_ptr->host_context);
+    }
+
+    if (disappeared)
+    {
+      list_del(&param_ptr->siblings);
+      lv2dynparam_plugin_parameter_free(instance_ptr, param_ptr);
+    }
+    return;
+  default:
+    assert(0);
+  }
+}
+
+/* Value was changed by plugin. Host reads the new value through
+   parameter_get_value() pointer, it is only told that it changed. */
+static
+bool
+lv2dynparam_plugin_param_value_changed(
+  struct lv2dynparam_plugin_instance * instance_ptr,
+  struct lv2dynparam_plugin_parameter * param_ptr)
+{
+  if (instance_ptr->host_callbacks == NULL ||
+      param_ptr->pending != LV2DYNPARAM_PENDING_NOTHING)
+  {
+    /* Host not attached, or host will read the value when the pending state is notified */
+    return true;
+  }
+
+  return instance_ptr->host_callbacks->parameter_change(
+    instance_ptr->host_context,
+    param_ptr->host_context);
+}
+
+/* FNV-1a */
+static
+unsigned int
+lv2dynparam_plugin_name_hash(
+  const char * name)
+{
+  unsigned int hash;
+
+  hash = 2166136261u;
+  while (*name != 0)
+  {
+    hash ^= (unsigned char)*name++;
+    hash *= 16777619u;
+  }
+
+  return hash;
+}
+
+static
+void
+lv2dynparam_plugin_param_link(
+  struct lv2dynparam_plugin_group * group_ptr,
+  struct lv2dynparam_plugin_parameter * param_ptr,
+  unsigned int name_hash)
+{
+  param_ptr->name_hash = name_hash;
+  list_add_tail(&param_ptr->siblings, &group_ptr->child_parameters);
+  list_add_tail(
+    &param_ptr->hash_siblings,
+    group_ptr->child_parameters_hash + (name_hash & (LV2DYNPARAM_PLUGIN_GROUP_NAME_HASH_SIZE - 1)));
+}
+
+/* Removes parameter pending disappear, that cannot be reused, from the name
+ * index. It stays in the group until host is notified and it is freed, but
+ * it is not found next to new parameter with same name. */
+static
+void
+lv2dynparam_plugin_param_unindex(
+  struct lv2dynparam_plugin_parameter * param_ptr)
+{
+  assert(param_ptr->pending == LV2DYNPARAM_PENDING_DISAPPEAR);
+  list_del_init(&param_ptr->hash_siblings);
+}
+
+/* Enum values of appeared parameter are referenced by host, so parameter
+ * is reused only if it has same values */
+static
+bool
+lv2dynparam_plugin_param_enum_values_equal(
+  const struct lv2dynparam_plugin_parameter * param_ptr,
+  const char * const * values,
+  unsigned int values_count)
+{
+  unsigned int i;
+
+  if (param_ptr->data.enumeration.values_count != values_count)
+  {
+    return false;
+  }
+
+  for (i = 0 ; i < values_count ; i++)
+  {
+    if (strcmp(param_ptr->data.enumeration.values[i], values[i]) != 0)
+    {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+/* Looks up parameter with same name, for reuse. Returns false if group contains
+ * parameter with same name that is not pending disappear. Parameter with same
+ * name but of different type is removed from the name index. */
+static
+bool
+lv2dynparam_plugin_param_find_reusable(
+  struct lv2dynparam_plugin_group * group_ptr,
+  const char * name,
+  unsigned int name_hash,
+  unsigned int type,
+  struct lv2dynparam_plugin_parameter ** param_ptr_ptr)
+{
+  struct list_head * node_ptr;
+  struct lv2dynparam_plugin_parameter * param_ptr;
+
+  *param_ptr_ptr = NULL;
+
+  list_for_each(node_ptr, group_ptr->child_parameters_hash + (name_hash & (LV2DYNPARAM_PLUGIN_GROUP_NAME_HASH_SIZE - 1)))
+  {
+    param_ptr = list_entry(node_ptr, struct lv2dynparam_plugin_parameter, hash_siblings);
+
+    assert(param_ptr->group_ptr == group_ptr);
+
+    if (param_ptr->name_hash == name_hash && strcmp(param_ptr->name, name) == 0)
+    {
+      if (param_ptr->pending != LV2DYNPARAM_PENDING_DISAPPEAR)
+      {
+        return false;
+      }
+
+      if (param_ptr->type == type)
+      {
+        *param_ptr_ptr = param_ptr;
+      }
+      else
+      {
+        /* there is pending disappear of parameter with same name but of different type */
+        lv2dynparam_plugin_param_unindex(param_ptr);
+      }
+
+      return true;
+    }
+  }
+
+  return true;
+}
+
+static
+void
+lv2dynparam_plugin_param_init_from_descriptor(
+  struct lv2dynparam_plugin_parameter * param_ptr,
+  const struct lv2dynparam_plugin_param_descriptor * descriptor_ptr,
+  void * callback_context)
+{
+  switch (descriptor_ptr->type)
+  {
+  case LV2DYNPARAM_PARAMETER_TYPE_BOOLEAN:
+    param_ptr->data.boolean = descriptor_ptr->data.boolean.value;
+    param_ptr->plugin_callback.boolean = descriptor_ptr->data.boolean.callback;
+    break;
+  case LV2DYNPARAM_PARAMETER_TYPE_FLOAT:
+    param_ptr->data.fpoint.value = descriptor_ptr->data.fpoint.value;
+    param_ptr->data.fpoint.min = descriptor_ptr->data.fpoint.min;
+    param_ptr->data.fpoint.max = descriptor_ptr->data.fpoint.max;
+    param_ptr->plugin_callback.fpoint = descriptor_ptr->data.fpoint.callback;
+    break;
+  case LV2DYNPARAM_PARAMETER_TYPE_INT:
+    param_ptr->data.integer.value = descriptor_ptr->data.integer.value;
+    param_ptr->data.integer.min = descriptor_ptr->data.integer.min;
+    param_ptr->data.integer.max = descriptor_ptr->data.integer.max;
+    param_ptr->plugin_callback.integer = descriptor_ptr->data.integer.callback;
+    break;
+  case LV2DYNPARAM_PARAMETER_TYPE_NOTE:
+    param_ptr->data.note.value = descriptor_ptr->data.note.value;
+    param_ptr->data.note.min = descriptor_ptr->data.note.min;
+    param_ptr->data.note.max = descriptor_ptr->data.note.max;
+    param_ptr->plugin_callback.note = descriptor_ptr->data.note.callback;
+    break;
+  case LV2DYNPARAM_PARAMETER_TYPE_ENUM:
+    param_ptr->data.enumeration.values = (char **)descriptor_ptr->data.enumeration.values;
+    param_ptr->data.enumeration.values_count = descriptor_ptr->data.enumeration.values_count;
+    param_ptr->data.enumeration.selected_value = descriptor_ptr->data.enumeration.value_index;
+    param_ptr->data.enumeration.values_borrowed = true;
+    param_ptr->plugin_callback.enumeration = descriptor_ptr->data.enumeration.callback;
+    break;
+  default:
     assert(0);
   }
+
+  param_ptr->plugin_callback_context = callback_context;
+}
+
+bool
+lv2dynparam_plugin_param_descriptor_check(
+  const struct lv2dynparam_plugin_param_descriptor * descriptor_ptr)
+{
+  switch (descriptor_ptr->type)
+  {
+  case LV2DYNPARAM_PARAMETER_TYPE_BOOLEAN:
+  case LV2DYNPARAM_PARAMETER_TYPE_FLOAT:
+  case LV2DYNPARAM_PARAMETER_TYPE_INT:
+    break;
+  case LV2DYNPARAM_PARAMETER_TYPE_NOTE:
+    if (!lv2dynparam_plugin_param_note_check(
+          descriptor_ptr->name,
+          descriptor_ptr->data.note.value,
+          descriptor_ptr->data.note.min,
+          descriptor_ptr->data.note.max))
+    {
+      return false;
+    }
+    break;
+  case LV2DYNPARAM_PARAMETER_TYPE_ENUM:
+    if (descriptor_ptr->data.enumeration.value_index >= descriptor_ptr->data.enumeration.values_count)
+    {
+      LOG_ERROR("Invalid initial value index of enum parameter \"%s\"", descriptor_ptr->name);
+      return false;
+    }
+    break;
+  default:
+    LOG_ERROR("Cannot add parameter \"%s\" of type %u from descriptor", descriptor_ptr->name, descriptor_ptr->type);
+    return false;
+  }
+
+  if (strlen(descriptor_ptr->name) + 1 >= LV2DYNPARAM_MAX_STRING_SIZE)
+  {
+    LOG_ERROR("Name of parameter \"%s\" is too long", descriptor_ptr->name);
+    return false;
+  }
+
+  return true;
+}
+
+/* Initializes new parameter, descriptor must be checked with lv2dynparam_plugin_param_descriptor_check() */
+void
+lv2dynparam_plugin_param_init(
+  struct lv2dynparam_plugin_instance * instance_ptr,
+  struct lv2dynparam_plugin_parameter * param_ptr,
+  struct lv2dynparam_plugin_group * group_ptr,
+  const struct lv2dynparam_plugin_param_descriptor * descriptor_ptr,
+  void * callback_context)
+{
+  size_t name_size;
+
+  lv2dynparam_hints_init_empty(&param_ptr->hints);
+  param_ptr->static_node = false;
+
+  lv2dynparam_plugin_param_set_type(param_ptr, descriptor_ptr->type);
+
+  name_size = strlen(descriptor_ptr->name) + 1;
+  assert(name_size < LV2DYNPARAM_MAX_STRING_SIZE);
+  memcpy(param_ptr->name, descriptor_ptr->name, name_size);
+
+  param_ptr->group_ptr = group_ptr;
+  lv2dynparam_plugin_param_init_from_descriptor(param_ptr, descriptor_ptr, callback_context);
+
+  param_ptr->pending = LV2DYNPARAM_PENDING_NOTHING;
+  lv2dynparam_plugin_param_set_pending(instance_ptr, param_ptr, LV2DYNPARAM_PENDING_APPEAR);
+
+  lv2dynparam_plugin_param_link(group_ptr, param_ptr, lv2dynparam_plugin_name_hash(descriptor_ptr->name));
 }
 
 #define instance_ptr ((struct lv2dynparam_plugin_instance *)instance_handle)
@@ -298,8 +834,8 @@ lv2dynparam_plugin_param_boolean_add(
 {
   struct lv2dynparam_plugin_parameter * param_ptr;
   struct lv2dynparam_plugin_group * group_ptr;
-  struct list_head * node_ptr;
   size_t name_size;
+  unsigned int name_hash;
 
   LOG_DEBUG("lv2dynparam_plugin_param_boolean_add() called for \"%s\"", name);
 
@@ -319,36 +855,114 @@ lv2dynparam_plugin_param_boolean_add(
     group_ptr = (struct lv2dynparam_plugin_group *)group;
   }
 
+  name_hash = lv2dynparam_plugin_name_hash(name);
+
   /* Search for same parameter in pending disappear state, and try to reuse it */
-  list_for_each(node_ptr, &group_ptr->child_parameters)
+  if (!lv2dynparam_plugin_param_find_reusable(group_ptr, name, name_hash, LV2DYNPARAM_PARAMETER_TYPE_BOOLEAN, &param_ptr))
   {
-    param_ptr = list_entry(node_ptr, struct lv2dynparam_plugin_parameter, siblings);
+    assert(0);                  /* groups cannot contain two parameters with same names */
+    return false;
+  }
 
-    assert(param_ptr->group_ptr == group_ptr);
+  if (param_ptr != NULL)
+  {
+    param_ptr->data.boolean = value;
+    param_ptr->plugin_callback.boolean = callback;
+    param_ptr->plugin_callback_context = callback_context;
+    lv2dynparam_plugin_param_set_pending(instance_ptr, param_ptr, LV2DYNPARAM_PENDING_CHANGE);
 
-    if (strcmp(param_ptr->name, name) == 0)
-    {
-      if (param_ptr->pending != LV2DYNPARAM_PENDING_DISAPPEAR)
-      {
-        assert(0);                /* groups cannot contain two parameters with same names */
-        return false;
-      }
+    *param_handle_ptr = (lv2dynparam_parameter_handle)param_ptr;
 
-      if (param_ptr->type != LV2DYNPARAM_PARAMETER_TYPE_BOOLEAN)
-      {
-        /* There is pending disappear of parameter with same name but of different type */
-        break;
-      }
+    return true;
+  }
+
+  param_ptr = rtsafe_memory_pool_allocate(instance_ptr->parameters_pool);
+  if (param_ptr == NULL)
+  {
+    return false;
+  }
 
-      param_ptr->data.boolean = value;
-      param_ptr->plugin_callback.boolean = callback;
-      param_ptr->plugin_callback_context = callback_context;
-      param_ptr->pending = LV2DYNPARAM_PENDING_CHANGE;
+  lv2dynparam_hints_init_empty(&param_ptr->hints);
+  param_ptr->static_node = false;
 
-      *param_handle_ptr = (lv2dynparam_parameter_handle)param_ptr;
+  lv2dynparam_plugin_param_set_type(param_ptr, LV2DYNPARAM_PARAMETER_TYPE_BOOLEAN);
 
-      return true;
-    }
+  memcpy(param_ptr->name, name, name_size);
+
+  param_ptr->group_ptr = group_ptr;
+  param_ptr->data.boolean = value;
+  param_ptr->plugin_callback.boolean = callback;
+  param_ptr->plugin_callback_context = callback_context;
+
+  param_ptr->pending = LV2DYNPARAM_PENDING_NOTHING;
+  lv2dynparam_plugin_param_set_pending(instance_ptr, param_ptr, LV2DYNPARAM_PENDING_APPEAR);
+
+  lv2dynparam_plugin_param_link(group_ptr, param_ptr, name_hash);
+
+  lv2dynparam_plugin_instance_notify(instance_ptr);
+
+  *param_handle_ptr = (lv2dynparam_parameter_handle)param_ptr;
+
+  return true;
+}
+
+bool
+lv2dynparam_plugin_param_float_add(
+  lv2dynparam_plugin_instance instance_handle,
+  lv2dynparam_plugin_group group,
+  const char * name,
+  const struct lv2dynparam_hints * hints_ptr,
+  float value,
+  float min,
+  float max,
+  lv2dynparam_plugin_param_float_changed callback,
+  void * callback_context,
+  lv2dynparam_plugin_parameter * param_handle_ptr)
+{
+  struct lv2dynparam_plugin_parameter * param_ptr;
+  struct lv2dynparam_plugin_group * group_ptr;
+  size_t name_size;
+  unsigned int name_hash;
+
+  LOG_DEBUG("lv2dynparam_plugin_param_float_add() called for \"%s\"", name);
+
+  name_size = strlen(name) + 1;
+  if (name_size >= LV2DYNPARAM_MAX_STRING_SIZE)
+  {
+    assert(0);
+    return false;
+  }
+
+  if (group == NULL)
+  {
+    group_ptr = &instance_ptr->root_group;
+  }
+  else
+  {
+    group_ptr = (struct lv2dynparam_plugin_group *)group;
+  }
+
+  name_hash = lv2dynparam_plugin_name_hash(name);
+
+  /* Search for same parameter in pending disappear state, and try to reuse it */
+  if (!lv2dynparam_plugin_param_find_reusable(group_ptr, name, name_hash, LV2DYNPARAM_PARAMETER_TYPE_FLOAT, &param_ptr))
+  {
+    assert(0);                  /* groups cannot contain two parameters with same names */
+    return false;
+  }
+
+  if (param_ptr != NULL)
+  {
+    param_ptr->data.fpoint.value = value;
+    param_ptr->data.fpoint.min = min;
+    param_ptr->data.fpoint.max = max;
+    param_ptr->plugin_callback.fpoint = callback;
+    param_ptr->plugin_callback_context = callback_context;
+    lv2dynparam_plugin_param_set_pending(instance_ptr, param_ptr, LV2DYNPARAM_PENDING_CHANGE);
+
+    *param_handle_ptr = (lv2dynparam_parameter_handle)param_ptr;
+
+    return true;
   }
 
   param_ptr = rtsafe_memory_pool_allocate(instance_ptr->parameters_pool);
@@ -358,47 +972,629 @@ lv2dynparam_plugin_param_boolean_add(
   }
 
   lv2dynparam_hints_init_empty(&param_ptr->hints);
+  param_ptr->static_node = false;
 
-  param_ptr->type = LV2DYNPARAM_PARAMETER_TYPE_BOOLEAN;
+  lv2dynparam_plugin_param_set_type(param_ptr, LV2DYNPARAM_PARAMETER_TYPE_FLOAT);
 
   memcpy(param_ptr->name, name, name_size);
 
   param_ptr->group_ptr = group_ptr;
-  param_ptr->data.boolean = value;
-  param_ptr->plugin_callback.boolean = callback;
+  param_ptr->data.fpoint.value = value;
+  param_ptr->data.fpoint.min = min;
+  param_ptr->data.fpoint.max = max;
+  param_ptr->plugin_callback.fpoint = callback;
   param_ptr->plugin_callback_context = callback_context;
 
-  param_ptr->pending = LV2DYNPARAM_PENDING_APPEAR;
-  instance_ptr->pending++;
+  param_ptr->pending = LV2DYNPARAM_PENDING_NOTHING;
+  lv2dynparam_plugin_param_set_pending(instance_ptr, param_ptr, LV2DYNPARAM_PENDING_APPEAR);
 
-  list_add_tail(&param_ptr->siblings, &group_ptr->child_parameters);
+  lv2dynparam_plugin_param_link(group_ptr, param_ptr, name_hash);
 
-  lv2dynparam_plugin_param_notify(instance_ptr, param_ptr);
+  lv2dynparam_plugin_instance_notify(instance_ptr);
+
+  *param_handle_ptr = (lv2dynparam_parameter_handle)param_ptr;
+
+  return true;
+}
+
+bool
+lv2dynparam_plugin_param_enum_add(
+  lv2dynparam_plugin_instance instance_handle,
+  lv2dynparam_plugin_group group,
+  const char * name,
+  const struct lv2dynparam_hints * hints_ptr,
+  const char ** values_ptr_ptr,
+  unsigned int values_count,
+  unsigned int initial_value_index,
+  lv2dynparam_plugin_param_enum_changed callback,
+  void * callback_context,
+  lv2dynparam_plugin_parameter * param_handle_ptr)
+{
+  struct lv2dynparam_plugin_parameter * param_ptr;
+  struct lv2dynparam_plugin_group * group_ptr;
+  size_t name_size;
+  unsigned int name_hash;
+  unsigned int i;
+  char ** values;
+
+  LOG_DEBUG("lv2dynparam_plugin_param_enum_add() called for \"%s\"", name);
+
+  for (i = 0 ; i < values_count ; i++)
+  {
+    LOG_DEBUG("[%u] possible value \"%s\"%s", i, values_ptr_ptr[i], i == initial_value_index ? " SELECTED" : "");
+  }
+
+  name_size = strlen(name) + 1;
+  if (name_size >= LV2DYNPARAM_MAX_STRING_SIZE)
+  {
+    assert(0);
+    goto fail;
+  }
+
+  values = lv2dynparam_enum_duplicate(instance_ptr->memory, values_ptr_ptr, values_count);
+  if (values == NULL)
+  {
+    LOG_DEBUG("Failed to duplicate enum array");
+    goto fail;
+  }
+
+  if (group == NULL)
+  {
+    group_ptr = &instance_ptr->root_group;
+  }
+  else
+  {
+    group_ptr = (struct lv2dynparam_plugin_group *)group;
+  }
+
+  name_hash = lv2dynparam_plugin_name_hash(name);
+
+  /* Search for same parameter in pending disappear state, and try to reuse it */
+  if (!lv2dynparam_plugin_param_find_reusable(group_ptr, name, name_hash, LV2DYNPARAM_PARAMETER_TYPE_ENUM, &param_ptr))
+  {
+    assert(0);                  /* groups cannot contain two parameters with same names */
+    goto fail_free_values;
+  }
+
+  if (param_ptr != NULL &&
+      !lv2dynparam_plugin_param_enum_values_equal(param_ptr, values_ptr_ptr, values_count))
+  {
+    /* host keeps pointer to the old values, appear as new parameter */
+    lv2dynparam_plugin_param_unindex(param_ptr);
+    param_ptr = NULL;
+  }
+
+  if (param_ptr != NULL)
+  {
+    /* values are same, old ones are kept because host may still reference them */
+    lv2dynparam_enum_free(instance_ptr->memory, values, values_count);
+
+    param_ptr->data.enumeration.selected_value = initial_value_index;
+
+    param_ptr->plugin_callback.enumeration = callback;
+    param_ptr->plugin_callback_context = callback_context;
+    lv2dynparam_plugin_param_set_pending(instance_ptr, param_ptr, LV2DYNPARAM_PENDING_CHANGE);
+
+    *param_handle_ptr = (lv2dynparam_parameter_handle)param_ptr;
+
+    return true;
+  }
+
+  param_ptr = rtsafe_memory_pool_allocate(instance_ptr->parameters_pool);
+  if (param_ptr == NULL)
+  {
+    goto fail_free_values;
+  }
+
+  lv2dynparam_hints_init_empty(&param_ptr->hints);
+  param_ptr->static_node = false;
+
+  lv2dynparam_plugin_param_set_type(param_ptr, LV2DYNPARAM_PARAMETER_TYPE_ENUM);
+
+  memcpy(param_ptr->name, name, name_size);
+
+  param_ptr->group_ptr = group_ptr;
+
+  param_ptr->data.enumeration.values = values;
+  param_ptr->data.enumeration.values_count = values_count;
+  param_ptr->data.enumeration.selected_value = initial_value_index;
+  param_ptr->data.enumeration.values_borrowed = false;
+
+  param_ptr->plugin_callback.enumeration = callback;
+  param_ptr->plugin_callback_context = callback_context;
+
+  param_ptr->pending = LV2DYNPARAM_PENDING_NOTHING;
+  lv2dynparam_plugin_param_set_pending(instance_ptr, param_ptr, LV2DYNPARAM_PENDING_APPEAR);
+
+  lv2dynparam_plugin_param_link(group_ptr, param_ptr, name_hash);
+
+  lv2dynparam_plugin_instance_notify(instance_ptr);
+
+  *param_handle_ptr = (lv2dynparam_parameter_handle)param_ptr;
+
+  return true;
+
+fail_free_values:
+  for (i = 0 ; i < values_count ; i++)
+  {
+    rtsafe_memory_deallocate(values[i]);
+  }
+
+  rtsafe_memory_deallocate(values);
+
+fail:
+  return false;
+}
+
+bool
+lv2dynparam_plugin_param_int_add(
+  lv2dynparam_plugin_instance instance_handle,
+  lv2dynparam_plugin_group group,
+  const char * name,
+  const struct lv2dynparam_hints * hints_ptr,
+  signed int value,
+  signed int min,
+  signed int max,
+  lv2dynparam_plugin_param_int_changed callback,
+  void * callback_context,
+  lv2dynparam_plugin_parameter * param_handle_ptr)
+{
+  struct lv2dynparam_plugin_parameter * param_ptr;
+  struct lv2dynparam_plugin_group * group_ptr;
+  size_t name_size;
+  unsigned int name_hash;
+
+  LOG_DEBUG("lv2dynparam_plugin_param_int_add() called for \"%s\" (%d,%d,%d)", name, value, min, max);
+
+  name_size = strlen(name) + 1;
+  if (name_size >= LV2DYNPARAM_MAX_STRING_SIZE)
+  {
+    assert(0);
+    return false;
+  }
+
+  if (group == NULL)
+  {
+    group_ptr = &instance_ptr->root_group;
+  }
+  else
+  {
+    group_ptr = (struct lv2dynparam_plugin_group *)group;
+  }
+
+  name_hash = lv2dynparam_plugin_name_hash(name);
+
+  /* Search for same parameter in pending disappear state, and try to reuse it */
+  if (!lv2dynparam_plugin_param_find_reusable(group_ptr, name, name_hash, LV2DYNPARAM_PARAMETER_TYPE_INT, &param_ptr))
+  {
+    assert(0);                  /* groups cannot contain two parameters with same names */
+    return false;
+  }
+
+  if (param_ptr != NULL)
+  {
+    param_ptr->data.integer.value = value;
+    param_ptr->data.integer.min = min;
+    param_ptr->data.integer.max = max;
+    param_ptr->plugin_callback.integer = callback;
+    param_ptr->plugin_callback_context = callback_context;
+    lv2dynparam_plugin_param_set_pending(instance_ptr, param_ptr, LV2DYNPARAM_PENDING_CHANGE);
+
+    *param_handle_ptr = (lv2dynparam_parameter_handle)param_ptr;
+
+    return true;
+  }
+
+  param_ptr = rtsafe_memory_pool_allocate(instance_ptr->parameters_pool);
+  if (param_ptr == NULL)
+  {
+    return false;
+  }
+
+  lv2dynparam_hints_init_empty(&param_ptr->hints);
+  param_ptr->static_node = false;
+
+  lv2dynparam_plugin_param_set_type(param_ptr, LV2DYNPARAM_PARAMETER_TYPE_INT);
+
+  memcpy(param_ptr->name, name, name_size);
+
+  param_ptr->group_ptr = group_ptr;
+  param_ptr->data.integer.value = value;
+  param_ptr->data.integer.min = min;
+  param_ptr->data.integer.max = max;
+  param_ptr->plugin_callback.integer = callback;
+  param_ptr->plugin_callback_context = callback_context;
+
+  param_ptr->pending = LV2DYNPARAM_PENDING_NOTHING;
+  lv2dynparam_plugin_param_set_pending(instance_ptr, param_ptr, LV2DYNPARAM_PENDING_APPEAR);
+
+  lv2dynparam_plugin_param_link(group_ptr, param_ptr, name_hash);
+
+  lv2dynparam_plugin_instance_notify(instance_ptr);
+
+  *param_handle_ptr = (lv2dynparam_parameter_handle)param_ptr;
+
+  return true;
+}
+
+bool
+lv2dynparam_plugin_param_note_add(
+  lv2dynparam_plugin_instance instance_handle,
+  lv2dynparam_plugin_group group,
+  const char * name,
+  const struct lv2dynparam_hints * hints_ptr,
+  unsigned char value,
+  unsigned char min,
+  unsigned char max,
+  lv2dynparam_plugin_param_note_changed callback,
+  void * callback_context,
+  lv2dynparam_plugin_parameter * param_handle_ptr)
+{
+  struct lv2dynparam_plugin_param_descriptor descriptor;
+  struct lv2dynparam_plugin_parameter * param_ptr;
+  struct lv2dynparam_plugin_group * group_ptr;
+
+  LOG_DEBUG("lv2dynparam_plugin_param_note_add() called for \"%s\" (%u,%u,%u)", name, value, min, max);
+
+  descriptor.type = LV2DYNPARAM_PARAMETER_TYPE_NOTE;
+  descriptor.name = name;
+  descriptor.data.note.value = value;
+  descriptor.data.note.min = min;
+  descriptor.data.note.max = max;
+  descriptor.data.note.callback = callback;
+
+  if (!lv2dynparam_plugin_param_descriptor_check(&descriptor))
+  {
+    return false;
+  }
+
+  if (group == NULL)
+  {
+    group_ptr = &instance_ptr->root_group;
+  }
+  else
+  {
+    group_ptr = (struct lv2dynparam_plugin_group *)group;
+  }
+
+  /* Search for same parameter in pending disappear state, and try to reuse it */
+  if (!lv2dynparam_plugin_param_find_reusable(group_ptr, name, lv2dynparam_plugin_name_hash(name), LV2DYNPARAM_PARAMETER_TYPE_NOTE, &param_ptr))
+  {
+    assert(0);                  /* groups cannot contain two parameters with same names */
+    return false;
+  }
+
+  if (param_ptr != NULL)
+  {
+    lv2dynparam_plugin_param_init_from_descriptor(param_ptr, &descriptor, callback_context);
+    lv2dynparam_plugin_param_set_pending(instance_ptr, param_ptr, LV2DYNPARAM_PENDING_CHANGE);
+
+    *param_handle_ptr = (lv2dynparam_parameter_handle)param_ptr;
+
+    return true;
+  }
+
+  param_ptr = rtsafe_memory_pool_allocate(instance_ptr->parameters_pool);
+  if (param_ptr == NULL)
+  {
+    return false;
+  }
+
+  lv2dynparam_plugin_param_init(instance_ptr, param_ptr, group_ptr, &descriptor, callback_context);
+
+  lv2dynparam_plugin_instance_notify(instance_ptr);
+
+  *param_handle_ptr = (lv2dynparam_parameter_handle)param_ptr;
+
+  return true;
+}
+
+bool
+lv2dynparam_plugin_param_string_add(
+  lv2dynparam_plugin_instance instance_handle,
+  lv2dynparam_plugin_group group,
+  const char * name,
+  const struct lv2dynparam_hints * hints_ptr,
+  const char * value,
+  unsigned int max_size,
+  lv2dynparam_plugin_param_string_changed callback,
+  void * callback_context,
+  lv2dynparam_plugin_parameter * param_handle_ptr)
+{
+  struct lv2dynparam_plugin_parameter * param_ptr;
+  struct lv2dynparam_plugin_group * group_ptr;
+  size_t name_size;
+  size_t value_size;
+  unsigned int name_hash;
+
+  LOG_DEBUG("lv2dynparam_plugin_param_string_add() called for \"%s\"", name);
+
+  name_size = strlen(name) + 1;
+  if (name_size >= LV2DYNPARAM_MAX_STRING_SIZE)
+  {
+    assert(0);
+    return false;
+  }
+
+  value_size = strlen(value) + 1;
+  if (max_size > LV2DYNPARAM_PLUGIN_STRING_MAX_SIZE || value_size > max_size)
+  {
+    LOG_ERROR("Invalid size %u of string parameter \"%s\"", max_size, name);
+    return false;
+  }
+
+  if (group == NULL)
+  {
+    group_ptr = &instance_ptr->root_group;
+  }
+  else
+  {
+    group_ptr = (struct lv2dynparam_plugin_group *)group;
+  }
+
+  name_hash = lv2dynparam_plugin_name_hash(name);
+
+  /* Search for same parameter in pending disappear state, and try to reuse it */
+  if (!lv2dynparam_plugin_param_find_reusable(group_ptr, name, name_hash, LV2DYNPARAM_PARAMETER_TYPE_STRING, &param_ptr))
+  {
+    assert(0);                  /* groups cannot contain two parameters with same names */
+    return false;
+  }
+
+  if (param_ptr != NULL && param_ptr->data.string.size != max_size)
+  {
+    /* host keeps buffers of the old size, appear as new parameter */
+    lv2dynparam_plugin_param_unindex(param_ptr);
+    param_ptr = NULL;
+  }
+
+  if (param_ptr != NULL)
+  {
+    memcpy(param_ptr->data.string.pending, value, value_size);
+    lv2dynparam_plugin_param_string_swap(&param_ptr->data.string);
+    param_ptr->plugin_callback.string = callback;
+    param_ptr->plugin_callback_context = callback_context;
+    lv2dynparam_plugin_param_set_pending(instance_ptr, param_ptr, LV2DYNPARAM_PENDING_CHANGE);
+
+    *param_handle_ptr = (lv2dynparam_parameter_handle)param_ptr;
+
+    return true;
+  }
+
+  param_ptr = rtsafe_memory_pool_allocate(instance_ptr->parameters_pool);
+  if (param_ptr == NULL)
+  {
+    goto fail;
+  }
+
+  param_ptr->data.string.value = rtsafe_memory_allocate(instance_ptr->memory, max_size);
+  if (param_ptr->data.string.value == NULL)
+  {
+    goto fail_deallocate_param;
+  }
+
+  param_ptr->data.string.pending = rtsafe_memory_allocate(instance_ptr->memory, max_size);
+  if (param_ptr->data.string.pending == NULL)
+  {
+    goto fail_deallocate_value;
+  }
+
+  memcpy(param_ptr->data.string.value, value, value_size);
+  param_ptr->data.string.pending[0] = 0;
+  param_ptr->data.string.size = max_size;
+
+  lv2dynparam_hints_init_empty(&param_ptr->hints);
+  param_ptr->static_node = false;
+
+  lv2dynparam_plugin_param_set_type(param_ptr, LV2DYNPARAM_PARAMETER_TYPE_STRING);
+
+  memcpy(param_ptr->name, name, name_size);
+
+  param_ptr->group_ptr = group_ptr;
+  param_ptr->plugin_callback.string = callback;
+  param_ptr->plugin_callback_context = callback_context;
+
+  param_ptr->pending = LV2DYNPARAM_PENDING_NOTHING;
+  lv2dynparam_plugin_param_set_pending(instance_ptr, param_ptr, LV2DYNPARAM_PENDING_APPEAR);
+
+  lv2dynparam_plugin_param_link(group_ptr, param_ptr, name_hash);
+
+  lv2dynparam_plugin_instance_notify(instance_ptr);
+
+  *param_handle_ptr = (lv2dynparam_parameter_handle)param_ptr;
+
+  return true;
+
+fail_deallocate_value:
+  rtsafe_memory_deallocate(param_ptr->data.string.value);
+
+fail_deallocate_param:
+  rtsafe_memory_pool_deallocate(instance_ptr->parameters_pool, param_ptr);
+
+fail:
+  return false;
+}
+
+bool
+lv2dynparam_plugin_param_filename_add(
+  lv2dynparam_plugin_instance instance_handle,
+  lv2dynparam_plugin_group group,
+  const char * name,
+  const struct lv2dynparam_hints * hints_ptr,
+  const char * value,
+  unsigned int max_size,
+  lv2dynparam_plugin_param_filename_load load,
+  lv2dynparam_plugin_param_filename_unload unload,
+  void * callback_context,
+  lv2dynparam_plugin_parameter * param_handle_ptr)
+{
+  struct lv2dynparam_plugin_parameter * param_ptr;
+  struct lv2dynparam_plugin_group * group_ptr;
+  struct lv2dynparam_plugin_filename * filename_ptr;
+  size_t name_size;
+  size_t value_size;
+  unsigned int name_hash;
+
+  LOG_DEBUG("lv2dynparam_plugin_param_filename_add() called for \"%s\"", name);
+
+  name_size = strlen(name) + 1;
+  if (name_size >= LV2DYNPARAM_MAX_STRING_SIZE)
+  {
+    assert(0);
+    return false;
+  }
+
+  value_size = strlen(value) + 1;
+  if (max_size > LV2DYNPARAM_PLUGIN_STRING_MAX_SIZE || value_size > max_size)
+  {
+    LOG_ERROR("Invalid size %u of filename parameter \"%s\"", max_size, name);
+    return false;
+  }
+
+  if (group == NULL)
+  {
+    group_ptr = &instance_ptr->root_group;
+  }
+  else
+  {
+    group_ptr = (struct lv2dynparam_plugin_group *)group;
+  }
+
+  if (instance_ptr->loader_ptr == NULL &&
+      !lv2dynparam_plugin_loader_create(&instance_ptr->loader_ptr))
+  {
+    return false;
+  }
+
+  /* loader state is not reused, load and unload callbacks may differ */
+  filename_ptr = lv2dynparam_plugin_loader_filename_create(instance_ptr->loader_ptr, max_size, load, unload, callback_context);
+  if (filename_ptr == NULL)
+  {
+    return false;
+  }
+
+  name_hash = lv2dynparam_plugin_name_hash(name);
+
+  /* Search for same parameter in pending disappear state, and try to reuse it */
+  if (!lv2dynparam_plugin_param_find_reusable(group_ptr, name, name_hash, LV2DYNPARAM_PARAMETER_TYPE_FILENAME, &param_ptr))
+  {
+    assert(0);                  /* groups cannot contain two parameters with same names */
+    goto fail_release;
+  }
+
+  if (param_ptr != NULL && param_ptr->data.filename.path.size != max_size)
+  {
+    /* host keeps buffers of the old size, appear as new parameter */
+    lv2dynparam_plugin_param_unindex(param_ptr);
+    param_ptr = NULL;
+  }
+
+  if (param_ptr != NULL)
+  {
+    lv2dynparam_plugin_loader_release(param_ptr->data.filename.loader_ptr);
+    param_ptr->data.filename.loader_ptr = filename_ptr;
+
+    memcpy(param_ptr->data.filename.path.pending, value, value_size);
+    lv2dynparam_plugin_param_string_swap(&param_ptr->data.filename.path);
+    lv2dynparam_plugin_loader_request(filename_ptr, value);
+    lv2dynparam_plugin_param_set_pending(instance_ptr, param_ptr, LV2DYNPARAM_PENDING_CHANGE);
+
+    *param_handle_ptr = (lv2dynparam_parameter_handle)param_ptr;
+
+    return true;
+  }
+
+  param_ptr = rtsafe_memory_pool_allocate(instance_ptr->parameters_pool);
+  if (param_ptr == NULL)
+  {
+    goto fail_release;
+  }
+
+  param_ptr->data.filename.path.value = rtsafe_memory_allocate(instance_ptr->memory, max_size);
+  if (param_ptr->data.filename.path.value == NULL)
+  {
+    goto fail_deallocate_param;
+  }
+
+  param_ptr->data.filename.path.pending = rtsafe_memory_allocate(instance_ptr->memory, max_size);
+  if (param_ptr->data.filename.path.pending == NULL)
+  {
+    goto fail_deallocate_value;
+  }
+
+  memcpy(param_ptr->data.filename.path.value, value, value_size);
+  param_ptr->data.filename.path.pending[0] = 0;
+  param_ptr->data.filename.path.size = max_size;
+  param_ptr->data.filename.loader_ptr = filename_ptr;
+  lv2dynparam_plugin_loader_request(filename_ptr, value);
+
+  lv2dynparam_hints_init_empty(&param_ptr->hints);
+  param_ptr->static_node = false;
+
+  lv2dynparam_plugin_param_set_type(param_ptr, LV2DYNPARAM_PARAMETER_TYPE_FILENAME);
+
+  memcpy(param_ptr->name, name, name_size);
+
+  param_ptr->group_ptr = group_ptr;
+  param_ptr->plugin_callback_context = callback_context;
+
+  param_ptr->pending = LV2DYNPARAM_PENDING_NOTHING;
+  lv2dynparam_plugin_param_set_pending(instance_ptr, param_ptr, LV2DYNPARAM_PENDING_APPEAR);
+
+  lv2dynparam_plugin_param_link(group_ptr, param_ptr, name_hash);
+
+  lv2dynparam_plugin_instance_notify(instance_ptr);
+
+  *param_handle_ptr = (lv2dynparam_parameter_handle)param_ptr;
+
+  return true;
+
+fail_deallocate_value:
+  rtsafe_memory_deallocate(param_ptr->data.filename.path.value);
+
+fail_deallocate_param:
+  rtsafe_memory_pool_deallocate(instance_ptr->parameters_pool, param_ptr);
+
+fail_release:
+  lv2dynparam_plugin_loader_release(filename_ptr);
+  return false;
+}
+
+bool
+lv2dynparam_plugin_param_remove(
+  lv2dynparam_plugin_instance instance_handle,
+  lv2dynparam_plugin_parameter parameter)
+{
+  /* If in pending appear - delete it right now */
+  if (parameter_ptr->pending == LV2DYNPARAM_PENDING_APPEAR)
+  {
+    list_del(&parameter_ptr->siblings);
+    lv2dynparam_plugin_parameter_free(instance_ptr, parameter_ptr);
+    return true;
+  }
 
-  *param_handle_ptr = (lv2dynparam_parameter_handle)param_ptr;
+  lv2dynparam_plugin_param_set_pending(instance_ptr, parameter_ptr, LV2DYNPARAM_PENDING_DISAPPEAR);
+  lv2dynparam_plugin_instance_notify(instance_ptr);
 
   return true;
 }
 
 bool
-lv2dynparam_plugin_param_float_add(
+lv2dynparam_plugin_command_add(
   lv2dynparam_plugin_instance instance_handle,
   lv2dynparam_plugin_group group,
   const char * name,
   const struct lv2dynparam_hints * hints_ptr,
-  float value,
-  float min,
-  float max,
-  lv2dynparam_plugin_param_float_changed callback,
+  lv2dynparam_plugin_command_executed callback,
   void * callback_context,
-  lv2dynparam_plugin_parameter * param_handle_ptr)
+  lv2dynparam_plugin_command * command_handle_ptr)
 {
   struct lv2dynparam_plugin_parameter * param_ptr;
   struct lv2dynparam_plugin_group * group_ptr;
-  struct list_head * node_ptr;
   size_t name_size;
+  unsigned int name_hash;
 
-  LOG_DEBUG("lv2dynparam_plugin_param_float_add() called for \"%s\"", name);
+  LOG_DEBUG("lv2dynparam_plugin_command_add() called for \"%s\"", name);
 
   name_size = strlen(name) + 1;
   if (name_size >= LV2DYNPARAM_MAX_STRING_SIZE)
@@ -416,38 +1612,25 @@ lv2dynparam_plugin_param_float_add(
     group_ptr = (struct lv2dynparam_plugin_group *)group;
   }
 
-  /* Search for same parameter in pending disappear state, and try to reuse it */
-  list_for_each(node_ptr, &group_ptr->child_parameters)
-  {
-    param_ptr = list_entry(node_ptr, struct lv2dynparam_plugin_parameter, siblings);
-
-    assert(param_ptr->group_ptr == group_ptr);
-
-    if (strcmp(param_ptr->name, name) == 0)
-    {
-      if (param_ptr->pending != LV2DYNPARAM_PENDING_DISAPPEAR)
-      {
-        assert(0);                /* groups cannot contain two parameters with same names */
-        return false;
-      }
+  name_hash = lv2dynparam_plugin_name_hash(name);
 
-      if (param_ptr->type != LV2DYNPARAM_PARAMETER_TYPE_FLOAT)
-      {
-        /* There is pending disappear of parameter with same name but of different type */
-        break;
-      }
+  /* Search for same command in pending disappear state, and try to reuse it */
+  if (!lv2dynparam_plugin_param_find_reusable(group_ptr, name, name_hash, LV2DYNPARAM_PARAMETER_TYPE_COMMAND, &param_ptr))
+  {
+    assert(0);                  /* groups cannot contain two children with same names */
+    return false;
+  }
 
-      param_ptr->data.fpoint.value = value;
-      param_ptr->data.fpoint.min = min;
-      param_ptr->data.fpoint.max = max;
-      param_ptr->plugin_callback.fpoint = callback;
-      param_ptr->plugin_callback_context = callback_context;
-      param_ptr->pending = LV2DYNPARAM_PENDING_CHANGE;
+  if (param_ptr != NULL)
+  {
+    /* host still has it, there is no value to update */
+    param_ptr->plugin_callback.command = callback;
+    param_ptr->plugin_callback_context = callback_context;
+    lv2dynparam_plugin_param_set_pending(instance_ptr, param_ptr, LV2DYNPARAM_PENDING_NOTHING);
 
-      *param_handle_ptr = (lv2dynparam_parameter_handle)param_ptr;
+    *command_handle_ptr = (lv2dynparam_plugin_command)param_ptr;
 
-      return true;
-    }
+    return true;
   }
 
   param_ptr = rtsafe_memory_pool_allocate(instance_ptr->parameters_pool);
@@ -456,71 +1639,68 @@ lv2dynparam_plugin_param_float_add(
     return false;
   }
 
-  lv2dynparam_hints_init_empty(&param_ptr->hints);
+  if (hints_ptr != NULL)
+  {
+    if (!lv2dynparam_hints_init_copy(instance_ptr->memory, hints_ptr, &param_ptr->hints))
+    {
+      rtsafe_memory_pool_deallocate(instance_ptr->parameters_pool, param_ptr);
+      return false;
+    }
+  }
+  else
+  {
+    lv2dynparam_hints_init_empty(&param_ptr->hints);
+  }
+
+  param_ptr->static_node = false;
 
-  param_ptr->type = LV2DYNPARAM_PARAMETER_TYPE_FLOAT;
+  lv2dynparam_plugin_param_set_type(param_ptr, LV2DYNPARAM_PARAMETER_TYPE_COMMAND);
 
   memcpy(param_ptr->name, name, name_size);
 
   param_ptr->group_ptr = group_ptr;
-  param_ptr->data.fpoint.value = value;
-  param_ptr->data.fpoint.min = min;
-  param_ptr->data.fpoint.max = max;
-  param_ptr->plugin_callback.fpoint = callback;
+  param_ptr->plugin_callback.command = callback;
   param_ptr->plugin_callback_context = callback_context;
 
-  param_ptr->pending = LV2DYNPARAM_PENDING_APPEAR;
-  instance_ptr->pending++;
+  param_ptr->pending = LV2DYNPARAM_PENDING_NOTHING;
+  lv2dynparam_plugin_param_set_pending(instance_ptr, param_ptr, LV2DYNPARAM_PENDING_APPEAR);
 
-  list_add_tail(&param_ptr->siblings, &group_ptr->child_parameters);
+  lv2dynparam_plugin_param_link(group_ptr, param_ptr, name_hash);
 
-  lv2dynparam_plugin_param_notify(instance_ptr, param_ptr);
+  lv2dynparam_plugin_instance_notify(instance_ptr);
 
-  *param_handle_ptr = (lv2dynparam_parameter_handle)param_ptr;
+  *command_handle_ptr = (lv2dynparam_plugin_command)param_ptr;
 
   return true;
 }
 
 bool
-lv2dynparam_plugin_param_enum_add(
+lv2dynparam_plugin_command_remove(
+  lv2dynparam_plugin_instance instance_handle,
+  lv2dynparam_plugin_command command)
+{
+  assert(((struct lv2dynparam_plugin_parameter *)command)->type == LV2DYNPARAM_PARAMETER_TYPE_COMMAND);
+
+  return lv2dynparam_plugin_param_remove(instance_handle, command);
+}
+
+bool
+lv2dynparam_plugin_params_add_batch(
   lv2dynparam_plugin_instance instance_handle,
   lv2dynparam_plugin_group group,
-  const char * name,
-  const struct lv2dynparam_hints * hints_ptr,
-  const char ** values_ptr_ptr,
-  unsigned int values_count,
-  unsigned int initial_value_index,
-  lv2dynparam_plugin_param_enum_changed callback,
+  const struct lv2dynparam_plugin_param_descriptor * descriptors,
+  unsigned int count,
   void * callback_context,
-  lv2dynparam_plugin_parameter * param_handle_ptr)
+  lv2dynparam_plugin_parameter * params)
 {
   struct lv2dynparam_plugin_parameter * param_ptr;
   struct lv2dynparam_plugin_group * group_ptr;
-  struct list_head * node_ptr;
-  size_t name_size;
+  struct list_head new_params;
+  unsigned int new_count;
   unsigned int i;
-  char ** values;
-
-  LOG_DEBUG("lv2dynparam_plugin_param_enum_add() called for \"%s\"", name);
-
-  for (i = 0 ; i < values_count ; i++)
-  {
-    LOG_DEBUG("[%u] possible value \"%s\"%s", i, values_ptr_ptr[i], i == initial_value_index ? " SELECTED" : "");
-  }
-
-  name_size = strlen(name) + 1;
-  if (name_size >= LV2DYNPARAM_MAX_STRING_SIZE)
-  {
-    assert(0);
-    goto fail;
-  }
+  unsigned int j;
 
-  values = lv2dynparam_enum_duplicate(instance_ptr->memory, values_ptr_ptr, values_count);
-  if (values == NULL)
-  {
-    LOG_DEBUG("Failed to duplicate enum array");
-    goto fail;
-  }
+  LOG_DEBUG("lv2dynparam_plugin_params_add_batch() called for %u parameters", count);
 
   if (group == NULL)
   {
@@ -531,213 +1711,276 @@ lv2dynparam_plugin_param_enum_add(
     group_ptr = (struct lv2dynparam_plugin_group *)group;
   }
 
-  /* Search for same parameter in pending disappear state, and try to reuse it */
-  list_for_each(node_ptr, &group_ptr->child_parameters)
+  /* validate and count parameters that cannot reuse ones pending disappear */
+  new_count = 0;
+  for (i = 0 ; i < count ; i++)
   {
-    param_ptr = list_entry(node_ptr, struct lv2dynparam_plugin_parameter, siblings);
-
-    assert(param_ptr->group_ptr == group_ptr);
-
-    if (strcmp(param_ptr->name, name) == 0)
+    if (!lv2dynparam_plugin_param_descriptor_check(descriptors + i))
     {
-      if (param_ptr->pending != LV2DYNPARAM_PENDING_DISAPPEAR)
-      {
-        assert(0);                /* groups cannot contain two parameters with same names */
-        goto fail_free_values;
-      }
-
-      if (param_ptr->type != LV2DYNPARAM_PARAMETER_TYPE_ENUM)
-      {
-        /* There is pending disappear of parameter with same name but of different type */
-        break;
-      }
-
-      /* free all values array.. */
+      return false;
+    }
 
-      for (i = 0 ; i < param_ptr->data.enumeration.values_count ; i++)
+    for (j = 0 ; j < i ; j++)
+    {
+      if (strcmp(descriptors[j].name, descriptors[i].name) == 0)
       {
-        rtsafe_memory_deallocate(param_ptr->data.enumeration.values[i]);
+        LOG_ERROR("Parameter \"%s\" is described twice", descriptors[i].name);
+        return false;
       }
+    }
 
-      rtsafe_memory_deallocate(param_ptr->data.enumeration.values);
-
-      /* update parameter data... */
-      param_ptr->data.enumeration.values = values;
-      param_ptr->data.enumeration.values_count = values_count;
-      param_ptr->data.enumeration.selected_value = initial_value_index;
-
-      param_ptr->plugin_callback.enumeration = callback;
-      param_ptr->plugin_callback_context = callback_context;
-      param_ptr->pending = LV2DYNPARAM_PENDING_CHANGE;
+    if (!lv2dynparam_plugin_param_find_reusable(
+          group_ptr,
+          descriptors[i].name,
+          lv2dynparam_plugin_name_hash(descriptors[i].name),
+          descriptors[i].type,
+          &param_ptr))
+    {
+      assert(0);                /* groups cannot contain two parameters with same names */
+      return false;
+    }
 
-      *param_handle_ptr = (lv2dynparam_parameter_handle)param_ptr;
+    if (param_ptr != NULL &&
+        param_ptr->type == LV2DYNPARAM_PARAMETER_TYPE_ENUM &&
+        !lv2dynparam_plugin_param_enum_values_equal(
+          param_ptr,
+          descriptors[i].data.enumeration.values,
+          descriptors[i].data.enumeration.values_count))
+    {
+      /* host keeps pointer to the old values, appear as new parameter */
+      lv2dynparam_plugin_param_unindex(param_ptr);
+      param_ptr = NULL;
+    }
 
-      return true;
+    if (param_ptr == NULL)
+    {
+      new_count++;
     }
   }
 
-  param_ptr = rtsafe_memory_pool_allocate(instance_ptr->parameters_pool);
-  if (param_ptr == NULL)
+  /* allocate all new parameters upfront, so batch is not added partially */
+  INIT_LIST_HEAD(&new_params);
+  for (i = 0 ; i < new_count ; i++)
   {
-    goto fail_free_values;
-  }
-
-  lv2dynparam_hints_init_empty(&param_ptr->hints);
+    param_ptr = rtsafe_memory_pool_allocate(instance_ptr->parameters_pool);
+    if (param_ptr == NULL)
+    {
+      goto fail_free;
+    }
 
-  param_ptr->type = LV2DYNPARAM_PARAMETER_TYPE_ENUM;
+    list_add_tail(&param_ptr->siblings, &new_params);
+  }
 
-  memcpy(param_ptr->name, name, name_size);
+  for (i = 0 ; i < count ; i++)
+  {
+    if (!lv2dynparam_plugin_param_find_reusable(
+          group_ptr,
+          descriptors[i].name,
+          lv2dynparam_plugin_name_hash(descriptors[i].name),
+          descriptors[i].type,
+          &param_ptr))
+    {
+      /* cannot happen, names were checked to be unique and not in use */
+      assert(0);
+      goto fail_free;
+    }
 
-  param_ptr->group_ptr = group_ptr;
+    if (param_ptr != NULL)
+    {
+      if (param_ptr->type == LV2DYNPARAM_PARAMETER_TYPE_ENUM)
+      {
+        /* values are same, old ones are kept because host may still reference them */
+        param_ptr->data.enumeration.selected_value = descriptors[i].data.enumeration.value_index;
+        param_ptr->plugin_callback.enumeration = descriptors[i].data.enumeration.callback;
+        param_ptr->plugin_callback_context = callback_context;
+      }
+      else
+      {
+        lv2dynparam_plugin_param_init_from_descriptor(param_ptr, descriptors + i, callback_context);
+      }
 
-  param_ptr->data.enumeration.values = values;
-  param_ptr->data.enumeration.values_count = values_count;
-  param_ptr->data.enumeration.selected_value = initial_value_index;
+      lv2dynparam_plugin_param_set_pending(instance_ptr, param_ptr, LV2DYNPARAM_PENDING_CHANGE);
+    }
+    else
+    {
+      if (list_empty(&new_params))
+      {
+        /* cannot happen, parameters that cannot be reused were counted */
+        assert(0);
+        goto fail_free;
+      }
 
-  param_ptr->plugin_callback.enumeration = callback;
-  param_ptr->plugin_callback_context = callback_context;
+      param_ptr = list_entry(new_params.next, struct lv2dynparam_plugin_parameter, siblings);
+      list_del(&param_ptr->siblings);
 
-  param_ptr->pending = LV2DYNPARAM_PENDING_APPEAR;
-  instance_ptr->pending++;
+      lv2dynparam_plugin_param_init(instance_ptr, param_ptr, group_ptr, descriptors + i, callback_context);
+    }
 
-  list_add_tail(&param_ptr->siblings, &group_ptr->child_parameters);
+    if (params != NULL)
+    {
+      params[i] = (lv2dynparam_plugin_parameter)param_ptr;
+    }
+  }
 
-  lv2dynparam_plugin_param_notify(instance_ptr, param_ptr);
+  assert(list_empty(&new_params));
 
-  *param_handle_ptr = (lv2dynparam_parameter_handle)param_ptr;
+  lv2dynparam_plugin_instance_notify(instance_ptr);
 
   return true;
 
-fail_free_values:
-  for (i = 0 ; i < values_count ; i++)
+fail_free:
+  while (!list_empty(&new_params))
   {
-    rtsafe_memory_deallocate(values[i]);
+    param_ptr = list_entry(new_params.next, struct lv2dynparam_plugin_parameter, siblings);
+    list_del(&param_ptr->siblings);
+    rtsafe_memory_pool_deallocate(instance_ptr->parameters_pool, param_ptr);
   }
 
-  rtsafe_memory_deallocate(values);
-
-fail:
   return false;
 }
 
 bool
-lv2dynparam_plugin_param_int_add(
+lv2dynparam_plugin_param_boolean_change(
   lv2dynparam_plugin_instance instance_handle,
-  lv2dynparam_plugin_group group,
-  const char * name,
-  const struct lv2dynparam_hints * hints_ptr,
-  signed int value,
-  signed int min,
-  signed int max,
-  lv2dynparam_plugin_param_int_changed callback,
-  void * callback_context,
-  lv2dynparam_plugin_parameter * param_handle_ptr)
+  lv2dynparam_plugin_parameter parameter,
+  bool value)
 {
-  struct lv2dynparam_plugin_parameter * param_ptr;
-  struct lv2dynparam_plugin_group * group_ptr;
-  struct list_head * node_ptr;
-  size_t name_size;
+  assert(parameter_ptr->type == LV2DYNPARAM_PARAMETER_TYPE_BOOLEAN);
 
-  LOG_DEBUG("lv2dynparam_plugin_param_int_add() called for \"%s\" (%d,%d,%d)", name, value, min, max);
+  parameter_ptr->data.boolean = value;
 
-  name_size = strlen(name) + 1;
-  if (name_size >= LV2DYNPARAM_MAX_STRING_SIZE)
+  return lv2dynparam_plugin_param_value_changed(instance_ptr, parameter_ptr);
+}
+
+bool
+lv2dynparam_plugin_param_float_change(
+  lv2dynparam_plugin_instance instance_handle,
+  lv2dynparam_plugin_parameter parameter,
+  float value)
+{
+  assert(parameter_ptr->type == LV2DYNPARAM_PARAMETER_TYPE_FLOAT);
+
+  if (value < parameter_ptr->data.fpoint.min || value > parameter_ptr->data.fpoint.max)
   {
-    assert(0);
+    LOG_ERROR("Value %f of float parameter \"%s\" is out of range", value, parameter_ptr->name);
     return false;
   }
 
-  if (group == NULL)
-  {
-    group_ptr = &instance_ptr->root_group;
-  }
-  else
+  parameter_ptr->data.fpoint.value = value;
+
+  return lv2dynparam_plugin_param_value_changed(instance_ptr, parameter_ptr);
+}
+
+bool
+lv2dynparam_plugin_param_int_change(
+  lv2dynparam_plugin_instance instance_handle,
+  lv2dynparam_plugin_parameter parameter,
+  signed int value)
+{
+  assert(parameter_ptr->type == LV2DYNPARAM_PARAMETER_TYPE_INT);
+
+  if (value < parameter_ptr->data.integer.min || value > parameter_ptr->data.integer.max)
   {
-    group_ptr = (struct lv2dynparam_plugin_group *)group;
+    LOG_ERROR("Value %d of integer parameter \"%s\" is out of range", value, parameter_ptr->name);
+    return false;
   }
 
-  /* Search for same parameter in pending disappear state, and try to reuse it */
-  list_for_each(node_ptr, &group_ptr->child_parameters)
-  {
-    param_ptr = list_entry(node_ptr, struct lv2dynparam_plugin_parameter, siblings);
+  parameter_ptr->data.integer.value = value;
 
-    assert(param_ptr->group_ptr == group_ptr);
+  return lv2dynparam_plugin_param_value_changed(instance_ptr, parameter_ptr);
+}
 
-    if (strcmp(param_ptr->name, name) == 0)
-    {
-      if (param_ptr->pending != LV2DYNPARAM_PENDING_DISAPPEAR)
-      {
-        assert(0);                /* groups cannot contain two parameters with same names */
-        return false;
-      }
+bool
+lv2dynparam_plugin_param_note_change(
+  lv2dynparam_plugin_instance instance_handle,
+  lv2dynparam_plugin_parameter parameter,
+  unsigned char value)
+{
+  assert(parameter_ptr->type == LV2DYNPARAM_PARAMETER_TYPE_NOTE);
 
-      if (param_ptr->type != LV2DYNPARAM_PARAMETER_TYPE_INT)
-      {
-        /* There is pending disappear of parameter with same name but of different type */
-        break;
-      }
+  if (value < parameter_ptr->data.note.min || value > parameter_ptr->data.note.max)
+  {
+    LOG_ERROR("Value %u of note parameter \"%s\" is out of range", value, parameter_ptr->name);
+    return false;
+  }
 
-      param_ptr->data.integer.value = value;
-      param_ptr->data.integer.min = min;
-      param_ptr->data.integer.max = max;
-      param_ptr->plugin_callback.integer = callback;
-      param_ptr->plugin_callback_context = callback_context;
-      param_ptr->pending = LV2DYNPARAM_PENDING_CHANGE;
+  parameter_ptr->data.note.value = value;
 
-      *param_handle_ptr = (lv2dynparam_parameter_handle)param_ptr;
+  return lv2dynparam_plugin_param_value_changed(instance_ptr, parameter_ptr);
+}
 
-      return true;
-    }
-  }
+bool
+lv2dynparam_plugin_param_enum_change(
+  lv2dynparam_plugin_instance instance_handle,
+  lv2dynparam_plugin_parameter parameter,
+  unsigned int value_index)
+{
+  assert(parameter_ptr->type == LV2DYNPARAM_PARAMETER_TYPE_ENUM);
 
-  param_ptr = rtsafe_memory_pool_allocate(instance_ptr->parameters_pool);
-  if (param_ptr == NULL)
+  if (value_index >= parameter_ptr->data.enumeration.values_count)
   {
+    LOG_ERROR("Value index %u of enum parameter \"%s\" is out of range", value_index, parameter_ptr->name);
     return false;
   }
 
-  lv2dynparam_hints_init_empty(&param_ptr->hints);
-
-  param_ptr->type = LV2DYNPARAM_PARAMETER_TYPE_INT;
+  parameter_ptr->data.enumeration.selected_value = value_index;
 
-  memcpy(param_ptr->name, name, name_size);
-
-  param_ptr->group_ptr = group_ptr;
-  param_ptr->data.integer.value = value;
-  param_ptr->data.integer.min = min;
-  param_ptr->data.integer.max = max;
-  param_ptr->plugin_callback.integer = callback;
-  param_ptr->plugin_callback_context = callback_context;
+  return lv2dynparam_plugin_param_value_changed(instance_ptr, parameter_ptr);
+}
 
-  param_ptr->pending = LV2DYNPARAM_PENDING_APPEAR;
-  instance_ptr->pending++;
+bool
+lv2dynparam_plugin_param_string_change(
+  lv2dynparam_plugin_instance instance_handle,
+  lv2dynparam_plugin_parameter parameter,
+  const char * value)
+{
+  size_t value_size;
 
-  list_add_tail(&param_ptr->siblings, &group_ptr->child_parameters);
+  assert(parameter_ptr->type == LV2DYNPARAM_PARAMETER_TYPE_STRING);
 
-  lv2dynparam_plugin_param_notify(instance_ptr, param_ptr);
+  value_size = strlen(value) + 1;
+  if (value_size > parameter_ptr->data.string.size)
+  {
+    LOG_ERROR("Value of string parameter \"%s\" is too long", parameter_ptr->name);
+    return false;
+  }
 
-  *param_handle_ptr = (lv2dynparam_parameter_handle)param_ptr;
+  memcpy(parameter_ptr->data.string.pending, value, value_size);
+  lv2dynparam_plugin_param_string_swap(&parameter_ptr->data.string);
 
-  return true;
+  return lv2dynparam_plugin_param_value_changed(instance_ptr, parameter_ptr);
 }
 
 bool
-lv2dynparam_plugin_param_remove(
+lv2dynparam_plugin_param_filename_change(
   lv2dynparam_plugin_instance instance_handle,
-  lv2dynparam_plugin_parameter parameter)
+  lv2dynparam_plugin_parameter parameter,
+  const char * filename)
 {
-  /* If in pending appear - delete it right now */
-  if (parameter_ptr->pending == LV2DYNPARAM_PENDING_APPEAR)
+  size_t value_size;
+
+  assert(parameter_ptr->type == LV2DYNPARAM_PARAMETER_TYPE_FILENAME);
+
+  value_size = strlen(filename) + 1;
+  if (value_size > parameter_ptr->data.filename.path.size)
   {
-    instance_ptr->pending--;
-    list_del(&parameter_ptr->siblings);
-    lv2dynparam_plugin_parameter_free(instance_ptr, parameter_ptr);
-    return true;
+    LOG_ERROR("Value of filename parameter \"%s\" is too long", parameter_ptr->name);
+    return false;
   }
 
-  parameter_ptr->pending = LV2DYNPARAM_PENDING_DISAPPEAR;
-  instance_ptr->pending++;
-  lv2dynparam_plugin_param_notify(instance_ptr, parameter_ptr);
+  memcpy(parameter_ptr->data.filename.path.pending, filename, value_size);
+  lv2dynparam_plugin_param_string_swap(&parameter_ptr->data.filename.path);
+  lv2dynparam_plugin_loader_request(parameter_ptr->data.filename.loader_ptr, filename);
 
-  return true;
+  return lv2dynparam_plugin_param_value_changed(instance_ptr, parameter_ptr);
+}
+
+void *
+lv2dynparam_plugin_param_filename_payload(
+  lv2dynparam_plugin_instance instance_handle,
+  lv2dynparam_plugin_parameter parameter)
+{
+  assert(parameter_ptr->type == LV2DYNPARAM_PARAMETER_TYPE_FILENAME);
+
+  return lv2dynparam_plugin_loader_payload(parameter_ptr->data.filename.loader_ptr);
 }
@@ -24,6 +24,8 @@
 #include <string.h>
 #include <assert.h>
 #include <stdbool.h>
+#include <stdint.h>
+#include <pthread.h>
 #include <lv2.h>
 
 #include "../lv2dynparam.h"
@@ -45,16 +47,51 @@ static struct lv2dynparam_plugin_callbacks g_lv2dynparam_plugin_callbacks =
   .parameter_get_name = lv2dynparam_plugin_parameter_get_name,
   .parameter_get_value = lv2dynparam_plugin_parameter_get_value,
   .parameter_get_range = lv2dynparam_plugin_parameter_get_range,
-  .parameter_change = lv2dynparam_plugin_parameter_change
+  .parameter_change = lv2dynparam_plugin_parameter_change,
+
+  .command_get_name = lv2dynparam_plugin_command_get_name,
+  .command_execute = lv2dynparam_plugin_command_execute
 };
 
-static struct list_head g_instances;
+/* Must be power of two */
+#define LV2DYNPARAM_PLUGIN_INSTANCES_HASH_SIZE 256
+
+/* Instances registry, keyed by LV2_Handle. Each bucket has its own lock,
+ * so instances can be created and attached from many threads in parallel. */
+static struct
+{
+  pthread_mutex_t lock;
+  struct list_head instances;
+} g_instances[LV2DYNPARAM_PLUGIN_INSTANCES_HASH_SIZE];
 
 void lv2dynparam_plugin_initialise() __attribute__((constructor));
 void lv2dynparam_plugin_initialise()
 {
+  unsigned int i;
+
   LOG_DEBUG("lv2dynparam_plugin_initialise() called");
-  INIT_LIST_HEAD(&g_instances);
+
+  for (i = 0 ; i < LV2DYNPARAM_PLUGIN_INSTANCES_HASH_SIZE ; i++)
+  {
+    pthread_mutex_init(&g_instances[i].lock, NULL);
+    INIT_LIST_HEAD(&g_instances[i].instances);
+  }
+}
+
+static
+unsigned int
+lv2dynparam_plugin_instance_hash(
+  LV2_Handle lv2instance)
+{
+  uintptr_t hash;
+
+  /* low bits of heap pointers are mostly zero, fold them with the higher ones */
+  hash = (uintptr_t)lv2instance;
+  hash ^= hash >> 4;
+  hash ^= hash >> 12;
+  hash ^= hash >> 20;
+
+  return hash & (LV2DYNPARAM_PLUGIN_INSTANCES_HASH_SIZE - 1);
 }
 
 const void *
@@ -139,6 +176,14 @@ lv2dynparam_plugin_instantiate(
 
   instance_ptr->lv2instance = lv2instance;
 
+  INIT_LIST_HEAD(&instance_ptr->pending_groups);
+  INIT_LIST_HEAD(&instance_ptr->pending_parameters);
+  instance_ptr->pending = 0;
+
+  instance_ptr->static_nodes = NULL;
+  instance_ptr->static_nodes_count = 0;
+  instance_ptr->loader_ptr = NULL;
+
   if (!lv2dynparam_plugin_group_init(
         instance_ptr,
         &instance_ptr->root_group,
@@ -150,11 +195,13 @@ lv2dynparam_plugin_instantiate(
     goto free_destroy_parameters_pool;
   }
 
-  list_add_tail(&instance_ptr->siblings, &g_instances);
-
   instance_ptr->host_callbacks = NULL;
 
-  instance_ptr->pending = 0;
+  instance_ptr->hash = lv2dynparam_plugin_instance_hash(lv2instance);
+
+  pthread_mutex_lock(&g_instances[instance_ptr->hash].lock);
+  list_add_tail(&instance_ptr->siblings, &g_instances[instance_ptr->hash].instances);
+  pthread_mutex_unlock(&g_instances[instance_ptr->hash].lock);
 
   *instance_handle_ptr = instance_ptr;
 
@@ -182,8 +229,13 @@ lv2dynparam_plugin_host_attach(
 {
   struct lv2dynparam_plugin_instance * instance_ptr;
   struct list_head * node_ptr;
+  unsigned int hash;
+
+  hash = lv2dynparam_plugin_instance_hash(instance);
 
-  list_for_each(node_ptr, &g_instances)
+  pthread_mutex_lock(&g_instances[hash].lock);
+
+  list_for_each(node_ptr, &g_instances[hash].instances)
   {
     instance_ptr = list_entry(node_ptr, struct lv2dynparam_plugin_instance, siblings);
     if (instance_ptr->lv2instance == instance)
@@ -192,17 +244,19 @@ lv2dynparam_plugin_host_attach(
     }
   }
 
+  pthread_mutex_unlock(&g_instances[hash].lock);
+
   return false;
 
 instance_found:
+  /* LV2 does not allow cleanup of an instance concurrently with its other functions */
+  pthread_mutex_unlock(&g_instances[hash].lock);
+
   instance_ptr->host_callbacks = host_callbacks;
   instance_ptr->host_context = instance_host_context;
 
-  //LOG_DEBUG("lv2dynparam_plugin_host_attach(): instance_ptr->pending is %u", instance_ptr->pending);
-  //if (instance_ptr->pending != 0) /* optimization */
-  {
-    lv2dynparam_plugin_group_notify(instance_ptr, &instance_ptr->root_group);
-  }
+  LOG_DEBUG("lv2dynparam_plugin_host_attach(): instance_ptr->pending is %u", instance_ptr->pending);
+  lv2dynparam_plugin_instance_notify(instance_ptr);
 
   /* switch to atomic memory mode */
   rtsafe_memory_atomic(instance_ptr->memory);
@@ -212,16 +266,170 @@ instance_found:
   return true;
 }
 
+bool
+lv2dynparam_plugin_instantiate_static(
+  LV2_Handle lv2instance,
+  const LV2_Feature * const * host_features_ptr_ptr,
+  const struct lv2dynparam_plugin_static_tree * tree_ptr,
+  void * callback_context,
+  lv2dynparam_plugin_instance * instance_handle_ptr)
+{
+  struct lv2dynparam_plugin_instance * instance_ptr;
+  const struct lv2dynparam_plugin_static_node * node_ptr;
+  struct lv2dynparam_plugin_group * group_ptr;
+  struct lv2dynparam_plugin_group * parent_group_ptr;
+  struct lv2dynparam_plugin_parameter * param_ptr;
+  unsigned int groups_count;
+  unsigned int params_count;
+  unsigned int i;
+  unsigned int j;
+
+  groups_count = 0;
+  params_count = 0;
+
+  for (i = 0 ; i < tree_ptr->count ; i++)
+  {
+    node_ptr = tree_ptr->nodes + i;
+
+    if (node_ptr->parent != LV2DYNPARAM_PLUGIN_STATIC_ROOT &&
+        (node_ptr->parent >= i || !tree_ptr->nodes[node_ptr->parent].group))
+    {
+      LOG_ERROR("Parent of static tree node \"%s\" is not group preceding it", node_ptr->descriptor.name);
+      return false;
+    }
+
+    if (node_ptr->group)
+    {
+      if (strlen(node_ptr->descriptor.name) + 1 >= LV2DYNPARAM_MAX_STRING_SIZE)
+      {
+        LOG_ERROR("Name of group \"%s\" is too long", node_ptr->descriptor.name);
+        return false;
+      }
+
+      groups_count++;
+    }
+    else
+    {
+      if (!lv2dynparam_plugin_param_descriptor_check(&node_ptr->descriptor))
+      {
+        return false;
+      }
+
+      params_count++;
+    }
+
+    for (j = 0 ; j < i ; j++)
+    {
+      if (tree_ptr->nodes[j].parent == node_ptr->parent &&
+          tree_ptr->nodes[j].group == node_ptr->group &&
+          strcmp(tree_ptr->nodes[j].descriptor.name, node_ptr->descriptor.name) == 0)
+      {
+        LOG_ERROR("Static tree node \"%s\" is declared twice in same group", node_ptr->descriptor.name);
+        return false;
+      }
+    }
+  }
+
+  if (!lv2dynparam_plugin_instantiate(lv2instance, host_features_ptr_ptr, tree_ptr->root_group_name, instance_handle_ptr))
+  {
+    return false;
+  }
+
+  instance_ptr = *instance_handle_ptr;
+
+  /* handles first, nodes follow */
+  instance_ptr->static_nodes = malloc(
+    tree_ptr->count * sizeof(void *) +
+    groups_count * sizeof(struct lv2dynparam_plugin_group) +
+    params_count * sizeof(struct lv2dynparam_plugin_parameter));
+  if (instance_ptr->static_nodes == NULL)
+  {
+    LOG_ERROR("Failed to allocate memory for static tree nodes");
+    lv2dynparam_plugin_cleanup(instance_ptr);
+    return false;
+  }
+
+  instance_ptr->static_nodes_count = tree_ptr->count;
+
+  group_ptr = (struct lv2dynparam_plugin_group *)(instance_ptr->static_nodes + tree_ptr->count);
+  param_ptr = (struct lv2dynparam_plugin_parameter *)(group_ptr + groups_count);
+
+  for (i = 0 ; i < tree_ptr->count ; i++)
+  {
+    node_ptr = tree_ptr->nodes + i;
+
+    if (node_ptr->parent == LV2DYNPARAM_PLUGIN_STATIC_ROOT)
+    {
+      parent_group_ptr = &instance_ptr->root_group;
+    }
+    else
+    {
+      parent_group_ptr = instance_ptr->static_nodes[node_ptr->parent];
+    }
+
+    if (node_ptr->group)
+    {
+      if (!lv2dynparam_plugin_group_init(instance_ptr, group_ptr, parent_group_ptr, NULL, node_ptr->descriptor.name))
+      {
+        /* cannot happen, name was checked and there are no hints to copy */
+        assert(0);
+        lv2dynparam_plugin_cleanup(instance_ptr);
+        return false;
+      }
+
+      group_ptr->static_node = true;
+      list_add_tail(&group_ptr->siblings, &parent_group_ptr->child_groups);
+      instance_ptr->static_nodes[i] = group_ptr++;
+    }
+    else
+    {
+      lv2dynparam_plugin_param_init(instance_ptr, param_ptr, parent_group_ptr, &node_ptr->descriptor, callback_context);
+      param_ptr->static_node = true;
+      instance_ptr->static_nodes[i] = param_ptr++;
+    }
+  }
+
+  return true;
+}
+
 #define instance_ptr ((struct lv2dynparam_plugin_instance *)instance_handle)
 
 void
 lv2dynparam_plugin_cleanup(
   lv2dynparam_plugin_instance instance_handle)
 {
+  pthread_mutex_lock(&g_instances[instance_ptr->hash].lock);
   list_del(&instance_ptr->siblings);
+  pthread_mutex_unlock(&g_instances[instance_ptr->hash].lock);
+
   lv2dynparam_plugin_group_clean(instance_ptr, &instance_ptr->root_group);
+
+  if (instance_ptr->loader_ptr != NULL)
+  {
+    lv2dynparam_plugin_loader_destroy(instance_ptr->loader_ptr);
+  }
+
   rtsafe_memory_pool_destroy(instance_ptr->parameters_pool);
   rtsafe_memory_pool_destroy(instance_ptr->groups_pool);
   rtsafe_memory_uninit(instance_ptr->memory);
+  free(instance_ptr->static_nodes);
   free(instance_ptr);
 }
+
+lv2dynparam_plugin_group
+lv2dynparam_plugin_static_group(
+  lv2dynparam_plugin_instance instance_handle,
+  unsigned int index)
+{
+  assert(index < instance_ptr->static_nodes_count);
+  return (lv2dynparam_plugin_group)instance_ptr->static_nodes[index];
+}
+
+lv2dynparam_plugin_parameter
+lv2dynparam_plugin_static_param(
+  lv2dynparam_plugin_instance instance_handle,
+  unsigned int index)
+{
+  assert(index < instance_ptr->static_nodes_count);
+  return (lv2dynparam_plugin_parameter)instance_ptr->static_nodes[index];
+}
@@ -37,6 +37,15 @@
 const void *
 get_lv2dynparam_plugin_extension_data(void);
 
+#define LV2DYNPARAM_PARAMETER_TYPE_COMMAND   0
+#define LV2DYNPARAM_PARAMETER_TYPE_FLOAT     1
+#define LV2DYNPARAM_PARAMETER_TYPE_INT       2
+#define LV2DYNPARAM_PARAMETER_TYPE_NOTE      3
+#define LV2DYNPARAM_PARAMETER_TYPE_STRING    4
+#define LV2DYNPARAM_PARAMETER_TYPE_FILENAME  5
+#define LV2DYNPARAM_PARAMETER_TYPE_BOOLEAN   6
+#define LV2DYNPARAM_PARAMETER_TYPE_ENUM      7
+
 /** handle to plugin helper library instance */
 typedef void * lv2dynparam_plugin_instance;
 
@@ -46,6 +55,9 @@ typedef void * lv2dynparam_plugin_parameter;
 /** handle to plugin helper library representation of group */
 typedef void * lv2dynparam_plugin_group;
 
+/** handle to plugin helper library representation of command */
+typedef void * lv2dynparam_plugin_command;
+
 /**
  * Call this function to instantiate LV2 dynparams extension for particular plugin.
  * This function should be called from LV2 instatiate() function.
@@ -141,6 +153,81 @@ typedef bool
   void * context,
   int value);
 
+/**
+ * Type for callback function to be called by helper library when note parameter value is changed by host.
+ * Callee is not allowed to sleep/lock in this callback.
+ *
+ * @param context context supplied by plugin when parameter was added to helper library
+ * @param value new value of changed parameter, MIDI note number
+ *
+ * @return Success status
+ * @retval true - success
+ * @retval false - error, try later
+ */
+typedef bool
+(*lv2dynparam_plugin_param_note_changed)(
+  void * context,
+  unsigned char value);
+
+/**
+ * Type for callback function to be called by helper library when string parameter value is changed by host.
+ * Callee is not allowed to sleep/lock in this callback.
+ *
+ * @param context context supplied by plugin when parameter was added to helper library
+ * @param value new value of changed parameter, valid until next change of the parameter
+ *
+ * @return Success status
+ * @retval true - success
+ * @retval false - error, try later
+ */
+typedef bool
+(*lv2dynparam_plugin_param_string_changed)(
+  void * context,
+  const char * value);
+
+/**
+ * Type for callback function to be called by helper library when filename parameter value is changed.
+ * It is called from the loader thread, so callee is allowed to sleep/lock and do file I/O.
+ *
+ * @param context context supplied by plugin when parameter was added to helper library
+ * @param filename name of the file to load, never empty
+ *
+ * @return Loaded payload, NULL on error (previous payload is kept)
+ */
+typedef void *
+(*lv2dynparam_plugin_param_filename_load)(
+  void * context,
+  const char * filename);
+
+/**
+ * Type for callback function to be called by helper library when payload of filename parameter is not used anymore.
+ * It is called from the loader thread.
+ *
+ * @param context context supplied by plugin when parameter was added to helper library
+ * @param payload payload previously returned by load callback
+ */
+typedef void
+(*lv2dynparam_plugin_param_filename_unload)(
+  void * context,
+  void * payload);
+
+/**
+ * Type for callback function to be called by helper library when command is executed by host.
+ * Callee is not allowed to sleep/lock in this callback.
+ *
+ * @param context context supplied by plugin when command was added to helper library
+ *
+ * @return Success status
+ * @retval true - success
+ * @retval false - error, try later
+ */
+typedef bool
+(*lv2dynparam_plugin_command_executed)(
+  void * context);
+
+/** Maximum size of string parameter value, including the terminating zero */
+#define LV2DYNPARAM_PLUGIN_STRING_MAX_SIZE 2048
+
 /**
  * Call this function to add new group.
  * This function will not sleep/lock. It is safe to call it from callbacks
@@ -164,6 +251,26 @@ lv2dynparam_plugin_group_add(
   const struct lv2dynparam_hints * hints_ptr,
   lv2dynparam_plugin_group * group_ptr);
 
+/**
+ * Call this function to remove group together with all its child
+ * groups, parameters and commands. Host is notified once, for the
+ * group only. Handles of removed group and of its children become
+ * invalid.
+ * This function will not sleep/lock. It is safe to call it from callbacks
+ * for parameter changes and command executions.
+ *
+ * @param instance Handle to instance received from lv2dynparam_plugin_instantiate()
+ * @param group handle to plugin helper library representation of group to remove
+ *
+ * @return Success status
+ * @retval true - success
+ * @retval false - error, try later
+ */
+bool
+lv2dynparam_plugin_group_remove(
+  lv2dynparam_plugin_instance instance,
+  lv2dynparam_plugin_group group);
+
 /**
  * Call this function to add new boolean parameter.
  * This function will not sleep/lock. It is safe to call it from callbacks
@@ -292,6 +399,331 @@ lv2dynparam_plugin_param_int_add(
   void * callback_context,
   lv2dynparam_plugin_parameter * param_ptr);
 
+/**
+ * Call this function to add new note parameter.
+ * This function will not sleep/lock. It is safe to call it from callbacks
+ * for parameter changes and command executions.
+ *
+ * @param instance Handle to instance received from lv2dynparam_plugin_instantiate()
+ * @param group Parent group, NULL for root group
+ * @param name Human readble name of group to add
+ * @param hints_ptr Pointer to group hints. Can be NULL (no hints).
+ * @param value initial value of the parameter, MIDI note number
+ * @param min minimum allowed value of the parameter
+ * @param max maximum allowed value of the parameter, not larger than 127
+ * @param callback callback to be called when host requests value change
+ * @param callback_context context to be supplied as parameter to function supplied by @c callback parameter
+ * @param param_ptr Pointer to variable receiving handle to plugin helper library representation of parameter
+ *
+ * @return Success status
+ * @retval true - success
+ * @retval false - error, try later
+ */
+bool
+lv2dynparam_plugin_param_note_add(
+  lv2dynparam_plugin_instance instance,
+  lv2dynparam_plugin_group group,
+  const char * name,
+  const struct lv2dynparam_hints * hints_ptr,
+  unsigned char value,
+  unsigned char min,
+  unsigned char max,
+  lv2dynparam_plugin_param_note_changed callback,
+  void * callback_context,
+  lv2dynparam_plugin_parameter * param_ptr);
+
+/**
+ * Call this function to add new string parameter.
+ * Storage for the value is preallocated, so changing it later does not allocate.
+ * This function will not sleep/lock. It is safe to call it from callbacks
+ * for parameter changes and command executions.
+ *
+ * @param instance Handle to instance received from lv2dynparam_plugin_instantiate()
+ * @param group Parent group, NULL for root group
+ * @param name Human readble name of group to add
+ * @param hints_ptr Pointer to group hints. Can be NULL (no hints).
+ * @param value initial value of the parameter
+ * @param max_size maximum size of the value, including the terminating zero,
+ * not larger than LV2DYNPARAM_PLUGIN_STRING_MAX_SIZE
+ * @param callback callback to be called when host requests value change
+ * @param callback_context context to be supplied as parameter to function supplied by @c callback parameter
+ * @param param_ptr Pointer to variable receiving handle to plugin helper library representation of parameter
+ *
+ * @return Success status
+ * @retval true - success
+ * @retval false - error, try later
+ */
+bool
+lv2dynparam_plugin_param_string_add(
+  lv2dynparam_plugin_instance instance,
+  lv2dynparam_plugin_group group,
+  const char * name,
+  const struct lv2dynparam_hints * hints_ptr,
+  const char * value,
+  unsigned int max_size,
+  lv2dynparam_plugin_param_string_changed callback,
+  void * callback_context,
+  lv2dynparam_plugin_parameter * param_ptr);
+
+/**
+ * Call this function to add new filename parameter.
+ * Files are loaded by helper library thread, started when first filename
+ * parameter is added. Payload of the current file is retrieved with
+ * lv2dynparam_plugin_param_filename_payload().
+ * Unlike other parameter add functions, this one allocates memory and may
+ * start a thread, so it must not be called from the audio thread.
+ *
+ * @param instance Handle to instance received from lv2dynparam_plugin_instantiate()
+ * @param group Parent group, NULL for root group
+ * @param name Human readble name of group to add
+ * @param hints_ptr Pointer to group hints. Can be NULL (no hints).
+ * @param value initial value of the parameter, empty string for no file
+ * @param max_size maximum size of the value, including the terminating zero,
+ * not larger than LV2DYNPARAM_PLUGIN_STRING_MAX_SIZE
+ * @param load callback to be called, from the loader thread, to load file
+ * @param unload callback to be called, from the loader thread, to free loaded payload
+ * @param callback_context context to be supplied as parameter to @c load and @c unload callbacks
+ * @param param_ptr Pointer to variable receiving handle to plugin helper library representation of parameter
+ *
+ * @return Success status
+ * @retval true - success
+ * @retval false - error, try later
+ */
+bool
+lv2dynparam_plugin_param_filename_add(
+  lv2dynparam_plugin_instance instance,
+  lv2dynparam_plugin_group group,
+  const char * name,
+  const struct lv2dynparam_hints * hints_ptr,
+  const char * value,
+  unsigned int max_size,
+  lv2dynparam_plugin_param_filename_load load,
+  lv2dynparam_plugin_param_filename_unload unload,
+  void * callback_context,
+  lv2dynparam_plugin_parameter * param_ptr);
+
+/**
+ * Descriptor of parameter to add with lv2dynparam_plugin_params_add_batch().
+ * Descriptor tables are meant to be static, member of @c data matching @c type is used.
+ */
+struct lv2dynparam_plugin_param_descriptor
+{
+  unsigned int type;            /**< LV2DYNPARAM_PARAMETER_TYPE_BOOLEAN, _FLOAT, _INT, _NOTE or _ENUM */
+  const char * name;            /**< Human readble name of parameter */
+  union
+  {
+    struct
+    {
+      bool value;               /**< initial value */
+      lv2dynparam_plugin_param_boolean_changed callback; /**< called when host requests value change */
+    } boolean;
+    struct
+    {
+      float value;              /**< initial value */
+      float min;                /**< minimum allowed value */
+      float max;                /**< maximum allowed value */
+      lv2dynparam_plugin_param_float_changed callback; /**< called when host requests value change */
+    } fpoint;
+    struct
+    {
+      signed int value;         /**< initial value */
+      signed int min;           /**< minimum allowed value */
+      signed int max;           /**< maximum allowed value */
+      lv2dynparam_plugin_param_int_changed callback; /**< called when host requests value change */
+    } integer;
+    struct
+    {
+      unsigned char value;      /**< initial value, MIDI note number */
+      unsigned char min;        /**< minimum allowed value */
+      unsigned char max;        /**< maximum allowed value, not larger than 127 */
+      lv2dynparam_plugin_param_note_changed callback; /**< called when host requests value change */
+    } note;
+    struct
+    {
+      const char * const * values; /**< valid values, not copied, must stay valid while parameter exists */
+      unsigned int values_count; /**< number of valid values */
+      unsigned int value_index; /**< index of initial value */
+      lv2dynparam_plugin_param_enum_changed callback; /**< called when host requests value change */
+    } enumeration;
+  } data;
+};
+
+/**
+ * Call this function to add many parameters to a group at once.
+ * Either all parameters are added or none is. All needed memory is allocated
+ * before any parameter is added and host is notified once, for all of them.
+ * Same as calling lv2dynparam_plugin_param_xxx_add() for each descriptor otherwise.
+ * This function will not sleep/lock. It is safe to call it from callbacks
+ * for parameter changes and command executions.
+ *
+ * @param instance Handle to instance received from lv2dynparam_plugin_instantiate()
+ * @param group Parent group, NULL for root group
+ * @param descriptors Array of parameter descriptors, names must be unique
+ * @param count Number of descriptors in the array pointed by the @c descriptors parameter
+ * @param callback_context context to be supplied as parameter to callbacks of all parameters
+ * @param params Array of @c count variables receiving handles to plugin helper library
+ * representation of parameters. Can be NULL.
+ *
+ * @return Success status
+ * @retval true - success
+ * @retval false - error, try later
+ */
+bool
+lv2dynparam_plugin_params_add_batch(
+  lv2dynparam_plugin_instance instance,
+  lv2dynparam_plugin_group group,
+  const struct lv2dynparam_plugin_param_descriptor * descriptors,
+  unsigned int count,
+  void * callback_context,
+  lv2dynparam_plugin_parameter * params);
+
+/** Parent index of static tree nodes that are children of the root group */
+#define LV2DYNPARAM_PLUGIN_STATIC_ROOT ((unsigned int)-1)
+
+/**
+ * Node of static parameter tree, see struct lv2dynparam_plugin_static_tree.
+ * Use LV2DYNPARAM_STATIC_XXX() macros to declare nodes.
+ */
+struct lv2dynparam_plugin_static_node
+{
+  unsigned int parent;          /**< index of parent group node, LV2DYNPARAM_PLUGIN_STATIC_ROOT for root group */
+  bool group;                   /**< whether node is group, only name in @c descriptor is used for groups */
+  struct lv2dynparam_plugin_param_descriptor descriptor; /**< parameter descriptor */
+};
+
+/**
+ * Static parameter tree, for plugins whose parameter layout is known at compile time.
+ * Nodes are in array, parent groups must precede their children.
+ * Tree is meant to be read-only data, shared by all plugin instances.
+ */
+struct lv2dynparam_plugin_static_tree
+{
+  const char * root_group_name; /**< name of the root group */
+  unsigned int count;           /**< number of nodes */
+  const struct lv2dynparam_plugin_static_node * nodes; /**< array of nodes */
+};
+
+/** Declare static tree group node */
+#define LV2DYNPARAM_STATIC_GROUP(parent, name) \
+  { (parent), true, { LV2DYNPARAM_PARAMETER_TYPE_COMMAND, (name) } }
+
+/** Declare static tree boolean parameter node */
+#define LV2DYNPARAM_STATIC_BOOLEAN(parent, name, value, callback) \
+  { (parent), false, { LV2DYNPARAM_PARAMETER_TYPE_BOOLEAN, (name), .data.boolean = { (value), (callback) } } }
+
+/** Declare static tree float parameter node */
+#define LV2DYNPARAM_STATIC_FLOAT(parent, name, value, min, max, callback) \
+  { (parent), false, { LV2DYNPARAM_PARAMETER_TYPE_FLOAT, (name), .data.fpoint = { (value), (min), (max), (callback) } } }
+
+/** Declare static tree integer parameter node */
+#define LV2DYNPARAM_STATIC_INT(parent, name, value, min, max, callback) \
+  { (parent), false, { LV2DYNPARAM_PARAMETER_TYPE_INT, (name), .data.integer = { (value), (min), (max), (callback) } } }
+
+/** Declare static tree note parameter node */
+#define LV2DYNPARAM_STATIC_NOTE(parent, name, value, min, max, callback) \
+  { (parent), false, { LV2DYNPARAM_PARAMETER_TYPE_NOTE, (name), .data.note = { (value), (min), (max), (callback) } } }
+
+/** Declare static tree enumeration parameter node, values array must be static too */
+#define LV2DYNPARAM_STATIC_ENUM(parent, name, values, values_count, value_index, callback) \
+  { (parent), false, { LV2DYNPARAM_PARAMETER_TYPE_ENUM, (name), .data.enumeration = { (values), (values_count), (value_index), (callback) } } }
+
+/** Initializer of struct lv2dynparam_plugin_static_tree for static array of nodes */
+#define LV2DYNPARAM_STATIC_TREE(root_group_name, nodes) \
+  { (root_group_name), sizeof(nodes) / sizeof((nodes)[0]), (nodes) }
+
+/**
+ * Call this function to instantiate LV2 dynparams extension for plugin with static parameter tree.
+ * Nodes of all groups and parameters of the tree are allocated in single block,
+ * RT-safe memory pools are not used for them.
+ * Same as lv2dynparam_plugin_instantiate() followed by adding groups and parameters of the tree otherwise.
+ * This function should be called from LV2 instatiate() function.
+ *
+ * @param instance Handle of LV2 plugin instance for which extension is being initialized.
+ * @param host_features_ptr_ptr host features as provided to LV2 instantiate() function
+ * @param tree_ptr Pointer to the static tree, must stay valid while instance exists.
+ * @param callback_context context to be supplied as parameter to callbacks of all parameters
+ * @param instance_ptr Pointer to variable receiving handle to plugin helper library instance.
+ *
+ * @return Success status
+ * @retval true - success
+ * @retval false - error
+ */
+bool
+lv2dynparam_plugin_instantiate_static(
+  LV2_Handle instance,
+  const LV2_Feature * const * host_features_ptr_ptr,
+  const struct lv2dynparam_plugin_static_tree * tree_ptr,
+  void * callback_context,
+  lv2dynparam_plugin_instance * instance_ptr);
+
+/**
+ * Call this function to get handle of group declared in static tree.
+ *
+ * @param instance Handle to instance received from lv2dynparam_plugin_instantiate_static()
+ * @param index Index of the group node in the static tree
+ *
+ * @return Handle to plugin helper library representation of group
+ */
+lv2dynparam_plugin_group
+lv2dynparam_plugin_static_group(
+  lv2dynparam_plugin_instance instance,
+  unsigned int index);
+
+/**
+ * Call this function to get handle of parameter declared in static tree.
+ *
+ * @param instance Handle to instance received from lv2dynparam_plugin_instantiate_static()
+ * @param index Index of the parameter node in the static tree
+ *
+ * @return Handle to plugin helper library representation of parameter
+ */
+lv2dynparam_plugin_parameter
+lv2dynparam_plugin_static_param(
+  lv2dynparam_plugin_instance instance,
+  unsigned int index);
+
+/**
+ * Call this function to add new command.
+ * This function will not sleep/lock. It is safe to call it from callbacks
+ * for parameter changes and command executions.
+ *
+ * @param instance Handle to instance received from lv2dynparam_plugin_instantiate()
+ * @param group Parent group, NULL for root group
+ * @param name Human readble name of command to add
+ * @param hints_ptr Pointer to command hints. Can be NULL (no hints).
+ * @param callback callback to be called when host executes the command
+ * @param callback_context context to be supplied as parameter to function supplied by @c callback parameter
+ * @param command_ptr Pointer to variable receiving handle to plugin helper library representation of command
+ *
+ * @return Success status
+ * @retval true - success
+ * @retval false - error, try later
+ */
+bool
+lv2dynparam_plugin_command_add(
+  lv2dynparam_plugin_instance instance,
+  lv2dynparam_plugin_group group,
+  const char * name,
+  const struct lv2dynparam_hints * hints_ptr,
+  lv2dynparam_plugin_command_executed callback,
+  void * callback_context,
+  lv2dynparam_plugin_command * command_ptr);
+
+/**
+ * Call this function to remove command
+ *
+ * @param instance Handle to instance received from lv2dynparam_plugin_instantiate()
+ * @param command handle to plugin helper library representation of command to remove
+ *
+ * @return Success status
+ * @retval true - success
+ * @retval false - error, try later
+ */
+bool
+lv2dynparam_plugin_command_remove(
+  lv2dynparam_plugin_instance instance,
+  lv2dynparam_plugin_command command);
+
 /**
  * Call this function to remove parameter
  *
@@ -308,7 +740,10 @@ lv2dynparam_plugin_param_remove(
   lv2dynparam_plugin_parameter param);
 
 /**
- * Call this function to change boolean parameter value
+ * Call this function to change boolean parameter value.
+ * This function will not sleep/lock. It is safe to call it from the audio thread.
+ * Host picks up the change asynchronously, several changes of same parameter
+ * made before that are seen by host as one.
  *
  * @param instance Handle to instance received from lv2dynparam_plugin_instantiate()
  * @param param handle to plugin helper library representation of parameter to change
@@ -324,4 +759,131 @@ lv2dynparam_plugin_param_boolean_change(
   lv2dynparam_plugin_parameter param,
   bool value);
 
+/**
+ * Call this function to change float parameter value.
+ * Same rules as for lv2dynparam_plugin_param_boolean_change() apply.
+ *
+ * @param instance Handle to instance received from lv2dynparam_plugin_instantiate()
+ * @param param handle to plugin helper library representation of parameter to change
+ * @param value new value, must be within parameter range
+ *
+ * @return Success status
+ * @retval true - success
+ * @retval false - error, try later
+ */
+bool
+lv2dynparam_plugin_param_float_change(
+  lv2dynparam_plugin_instance instance,
+  lv2dynparam_plugin_parameter param,
+  float value);
+
+/**
+ * Call this function to change integer parameter value.
+ * Same rules as for lv2dynparam_plugin_param_boolean_change() apply.
+ *
+ * @param instance Handle to instance received from lv2dynparam_plugin_instantiate()
+ * @param param handle to plugin helper library representation of parameter to change
+ * @param value new value, must be within parameter range
+ *
+ * @return Success status
+ * @retval true - success
+ * @retval false - error, try later
+ */
+bool
+lv2dynparam_plugin_param_int_change(
+  lv2dynparam_plugin_instance instance,
+  lv2dynparam_plugin_parameter param,
+  signed int value);
+
+/**
+ * Call this function to change note parameter value.
+ * Same rules as for lv2dynparam_plugin_param_boolean_change() apply.
+ *
+ * @param instance Handle to instance received from lv2dynparam_plugin_instantiate()
+ * @param param handle to plugin helper library representation of parameter to change
+ * @param value new value, must be within parameter range
+ *
+ * @return Success status
+ * @retval true - success
+ * @retval false - error, try later
+ */
+bool
+lv2dynparam_plugin_param_note_change(
+  lv2dynparam_plugin_instance instance,
+  lv2dynparam_plugin_parameter param,
+  unsigned char value);
+
+/**
+ * Call this function to change enumeration parameter value.
+ * Same rules as for lv2dynparam_plugin_param_boolean_change() apply.
+ *
+ * @param instance Handle to instance received from lv2dynparam_plugin_instantiate()
+ * @param param handle to plugin helper library representation of parameter to change
+ * @param value_index index of the new selected value
+ *
+ * @return Success status
+ * @retval true - success
+ * @retval false - error, try later
+ */
+bool
+lv2dynparam_plugin_param_enum_change(
+  lv2dynparam_plugin_instance instance,
+  lv2dynparam_plugin_parameter param,
+  unsigned int value_index);
+
+/**
+ * Call this function to change string parameter value.
+ * Same rules as for lv2dynparam_plugin_param_boolean_change() apply,
+ * and it must be called from the audio thread.
+ *
+ * @param instance Handle to instance received from lv2dynparam_plugin_instantiate()
+ * @param param handle to plugin helper library representation of parameter to change
+ * @param value new value, must fit in parameter maximum size
+ *
+ * @return Success status
+ * @retval true - success
+ * @retval false - error, try later
+ */
+bool
+lv2dynparam_plugin_param_string_change(
+  lv2dynparam_plugin_instance instance,
+  lv2dynparam_plugin_parameter param,
+  const char * value);
+
+/**
+ * Call this function to change filename parameter value.
+ * Same rules as for lv2dynparam_plugin_param_boolean_change() apply,
+ * and it must be called from the audio thread.
+ * New file is loaded asynchronously, current payload stays in use until then.
+ *
+ * @param instance Handle to instance received from lv2dynparam_plugin_instantiate()
+ * @param param handle to plugin helper library representation of parameter to change
+ * @param filename new value, must fit in parameter maximum size
+ *
+ * @return Success status
+ * @retval true - success
+ * @retval false - error, try later
+ */
+bool
+lv2dynparam_plugin_param_filename_change(
+  lv2dynparam_plugin_instance instance,
+  lv2dynparam_plugin_parameter param,
+  const char * filename);
+
+/**
+ * Call this function to get payload of the last loaded file of filename parameter.
+ * This function will not sleep/lock. It must be called from the audio thread.
+ * Returned payload stays valid until next call of this function for same parameter,
+ * payloads replaced before are unloaded by the loader thread.
+ *
+ * @param instance Handle to instance received from lv2dynparam_plugin_instantiate()
+ * @param param handle to plugin helper library representation of parameter
+ *
+ * @return Loaded payload, NULL if no file was loaded yet
+ */
+void *
+lv2dynparam_plugin_param_filename_payload(
+  lv2dynparam_plugin_instance instance,
+  lv2dynparam_plugin_parameter param);
+
 #endif /* #ifndef DYNPARAM_H__84DA2DA3_61BD_45AC_B202_6A08F27D56F5__INCLUDED */